@@ -27,10 +27,12 @@
  */
 
 #include <cassert>
+#include <cstring>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
 #include "src/common/strutil.h"
+#include "src/common/hash.h"
 #include "src/common/encoding.h"
 #include "src/common/readstream.h"
 #include "src/common/writefile.h"
@@ -46,83 +48,66 @@ static const uint32 kVersion2b = MKTAG('V', '2', '.', 'b');
 
 namespace Aurora {
 
-TwoDARow::TwoDARow(TwoDAFile &parent) : _parent(&parent) {
-}
-
-TwoDARow::~TwoDARow() {
+TwoDARow::TwoDARow(const TwoDAFile &parent, size_t row) : _parent(&parent), _row(row) {
 }
 
 const Common::UString &TwoDARow::getString(size_t column) const {
-	const Common::UString &cell = getCell(column);
-	if (cell.empty() || (cell == "****"))
+	const TwoDAFile::CellValue &cell = _parent->getCell(_row, column);
+	if (cell.empty)
 		return _parent->_defaultString;
 
-	return cell;
+	return cell.string;
 }
 
 const Common::UString &TwoDARow::getString(const Common::UString &column) const {
-	const Common::UString &cell = getCell(_parent->headerToColumn(column));
-	if (cell.empty() || (cell == "****"))
-		return _parent->_defaultString;
-
-	return cell;
+	return getString(_parent->headerToColumn(column));
 }
 
 int32 TwoDARow::getInt(size_t column) const {
-	const Common::UString &cell = getCell(column);
-	if (cell.empty() || (cell == "****"))
+	const TwoDAFile::CellValue &cell = _parent->getCell(_row, column);
+	if (cell.empty)
 		return _parent->_defaultInt;
 
-	return _parent->parseInt(cell);
+	return cell.intValue;
 }
 
 int32 TwoDARow::getInt(const Common::UString &column) const {
-	const Common::UString &cell = getCell(_parent->headerToColumn(column));
-	if (cell.empty() || (cell == "****"))
-		return _parent->_defaultInt;
-
-	return _parent->parseInt(cell);
+	return getInt(_parent->headerToColumn(column));
 }
 
 float TwoDARow::getFloat(size_t column) const {
-	const Common::UString &cell = getCell(column);
-	if (cell.empty() || (cell == "****"))
+	const TwoDAFile::CellValue &cell = _parent->getCell(_row, column);
+	if (cell.empty)
 		return _parent->_defaultFloat;
 
-	return _parent->parseFloat(cell);
+	return cell.floatValue;
 }
 
 float TwoDARow::getFloat(const Common::UString &column) const {
-	const Common::UString &cell = getCell(_parent->headerToColumn(column));
-	if (cell.empty() || (cell == "****"))
-		return _parent->_defaultFloat;
-
-	return _parent->parseFloat(cell);
+	return getFloat(_parent->headerToColumn(column));
 }
 
 bool TwoDARow::empty(size_t column) const {
-	const Common::UString &cell = getCell(column);
-	if (cell.empty() || (cell == "****"))
-		return true;
-
-	return false;
+	return _parent->getCell(_row, column).empty;
 }
 
 bool TwoDARow::empty(const Common::UString &column) const {
 	return empty(_parent->headerToColumn(column));
 }
 
-static const Common::UString kEmpty;
-const Common::UString &TwoDARow::getCell(size_t n) const {
-	if (n >= _data.size())
-		return kEmpty;
 
-	return _data[n];
+TwoDAFile::CellValue::CellValue(const Common::UString &str) : string(str) {
+	empty = str.empty() || (str == "****");
+
+	intValue   = TwoDAFile::parseInt(str);
+	floatValue = TwoDAFile::parseFloat(str);
 }
 
 
 TwoDAFile::TwoDAFile(Common::SeekableReadStream &twoda) :
-	_defaultInt(0), _defaultFloat(0.0f), _emptyRow(*this) {
+	_defaultInt(0), _defaultFloat(0.0f), _emptyRow(*this, SIZE_MAX) {
+
+	_values.push_back(CellValue(""));
 
 	load(twoda);
 }
@@ -136,9 +121,11 @@ void TwoDAFile::clear() {
 
 	_headers.clear();
 
-	for (std::vector<TwoDARow *>::iterator row = _rows.begin(); row != _rows.end(); ++row)
-		delete *row;
 	_rows.clear();
+	_cells.clear();
+
+	// Keep only the empty value
+	_values.erase(_values.begin() + 1, _values.end());
 
 	_headerMap.clear();
 
@@ -240,26 +227,32 @@ void TwoDAFile::readRows2a(Common::SeekableReadStream &twoda,
 
 	size_t columnCount = _headers.size();
 
-	while (!twoda.eos()) {
-		TwoDARow *row = new TwoDARow(*this);
+	ValueMap values;
+	std::vector<Common::UString> row;
+	std::vector<uint32> rowCells;
 
+	size_t rowCount = 0;
+	while (!twoda.eos()) {
 		// Skip the first token, which is the row index. It's implicit in the data anyway
 		tokenize.skipToken(twoda);
 
 		// Read all the cells in the row
-		size_t count = tokenize.getTokens(twoda, row->_data, columnCount, columnCount);
+		size_t count = tokenize.getTokens(twoda, row, columnCount, columnCount);
 
 		// And move to the next line
 		tokenize.nextChunk(twoda);
 
-		if (count == 0) {
+		if (count == 0)
 			// Ignore empty lines
-			delete row;
 			continue;
-		}
 
-		_rows.push_back(row);
+		for (size_t i = 0; i < columnCount; i++)
+			rowCells.push_back(addValue(values, row[i]));
+
+		rowCount++;
 	}
+
+	createCells(rowCells, rowCount);
 }
 
 void TwoDAFile::readHeaders2b(Common::SeekableReadStream &twoda) {
@@ -287,7 +280,7 @@ void TwoDAFile::skipRowNames2b(Common::SeekableReadStream &twoda) {
 	 */
 
 	const uint32 rowCount = twoda.readUint32LE();
-	_rows.resize(rowCount, 0);
+	_rows.resize(rowCount, _emptyRow);
 
 	Common::StreamTokenizer tokenize(Common::StreamTokenizer::kRuleHeed);
 
@@ -310,7 +303,7 @@ void TwoDAFile::readRows2b(Common::SeekableReadStream &twoda) {
 	size_t rowCount    = _rows.size();
 	size_t cellCount   = columnCount * rowCount;
 
-	uint32 *offsets = new uint32[cellCount];
+	std::vector<uint32> offsets(cellCount);
 
 	Common::StreamTokenizer tokenize(Common::StreamTokenizer::kRuleHeed);
 
@@ -323,28 +316,79 @@ void TwoDAFile::readRows2b(Common::SeekableReadStream &twoda) {
 
 	size_t dataOffset = twoda.pos();
 
-	for (size_t i = 0; i < rowCount; i++) {
-		_rows[i] = new TwoDARow(*this);
+	ValueMap values;
+	std::map<uint32, uint32> offsetValues;
 
-		_rows[i]->_data.resize(columnCount);
+	std::vector<uint32> rowCells(cellCount);
+	for (size_t i = 0; i < cellCount; i++) {
+		std::map<uint32, uint32>::const_iterator offsetValue = offsetValues.find(offsets[i]);
+		if (offsetValue != offsetValues.end()) {
+			rowCells[i] = offsetValue->second;
+			continue;
+		}
 
-		for (size_t j = 0; j < columnCount; j++) {
-			size_t offset = dataOffset + offsets[i * columnCount + j];
+		twoda.seek(dataOffset + offsets[i]);
 
-			try {
-				twoda.seek(offset);
-			} catch (...) {
-				delete[] offsets;
-				throw;
-			}
+		Common::UString cell = tokenize.getToken(twoda);
+		if (cell.empty())
+			cell = "****";
 
-			_rows[i]->_data[j] = tokenize.getToken(twoda);
-			if (_rows[i]->_data[j].empty())
-				_rows[i]->_data[j] = "****";
-		}
+		rowCells[i] = addValue(values, cell);
+		offsetValues.insert(std::make_pair(offsets[i], rowCells[i]));
 	}
 
-	delete[] offsets;
+	createCells(rowCells, rowCount);
+}
+
+size_t TwoDAFile::hashValue::operator()(const Common::UString &value) const {
+	uint32 hash = 0x811C9DC5;
+
+	for (const char *c = value.c_str(); *c; c++)
+		hash = Common::hashFNV32(hash, (byte) *c);
+
+	return hash;
+}
+
+bool TwoDAFile::equalValue::operator()(const Common::UString &a, const Common::UString &b) const {
+	return std::strcmp(a.c_str(), b.c_str()) == 0;
+}
+
+uint32 TwoDAFile::addValue(ValueMap &values, const Common::UString &str) {
+	if (str.empty())
+		return 0;
+
+	ValueMap::const_iterator value = values.find(str);
+	if (value != values.end())
+		return value->second;
+
+	const uint32 index = _values.size();
+
+	values.insert(std::make_pair(str, index));
+	_values.push_back(CellValue(str));
+
+	return index;
+}
+
+void TwoDAFile::createCells(const std::vector<uint32> &rowCells, size_t rowCount) {
+	const size_t columnCount = _headers.size();
+	assert(rowCells.size() == (rowCount * columnCount));
+
+	_rows.clear();
+	_rows.reserve(rowCount);
+	for (size_t i = 0; i < rowCount; i++)
+		_rows.push_back(TwoDARow(*this, i));
+
+	_cells.resize(rowCells.size());
+	for (size_t i = 0; i < rowCount; i++)
+		for (size_t j = 0; j < columnCount; j++)
+			_cells[j * rowCount + i] = rowCells[i * columnCount + j];
+}
+
+const TwoDAFile::CellValue &TwoDAFile::getCell(size_t row, size_t column) const {
+	if ((row >= _rows.size()) || (column >= _headers.size()))
+		return _values[0];
+
+	return _values[_cells[column * _rows.size() + row]];
 }
 
 void TwoDAFile::createHeaderMap() {
@@ -374,11 +418,11 @@ size_t TwoDAFile::headerToColumn(const Common::UString &header) const {
 }
 
 const TwoDARow &TwoDAFile::getRow(size_t row) const {
-	if ((row >= _rows.size()) || !_rows[row])
+	if (row >= _rows.size())
 		// No such row
 		return _emptyRow;
 
-	return *_rows[row];
+	return _rows[row];
 }
 
 void TwoDAFile::writeASCII(Common::WriteStream &out) const {
@@ -401,9 +445,11 @@ void TwoDAFile::writeASCII(Common::WriteStream &out) const {
 		colLength[i + 1] = _headers[i].size();
 
 	for (size_t i = 0; i < _rows.size(); i++) {
-		for (size_t j = 0; j < _rows[i]->_data.size(); j++) {
-			const bool   needQuote = _rows[i]->_data[j].contains(' ');
-			const size_t length    = needQuote ? _rows[i]->_data[j].size() + 2 : _rows[i]->_data[j].size();
+		for (size_t j = 0; j < _headers.size(); j++) {
+			const Common::UString &cell = getCell(i, j).string;
+
+			const bool   needQuote = cell.contains(' ');
+			const size_t length    = needQuote ? cell.size() + 2 : cell.size();
 
 			colLength[j + 1] = MAX<size_t>(colLength[j + 1], length);
 		}
@@ -423,14 +469,15 @@ void TwoDAFile::writeASCII(Common::WriteStream &out) const {
 	for (size_t i = 0; i < _rows.size(); i++) {
 		out.writeString(Common::UString::format("%*u", (int)colLength[0], (uint)i));
 
-		for (size_t j = 0; j < _rows[i]->_data.size(); j++) {
-			const bool needQuote = _rows[i]->_data[j].contains(' ');
+		for (size_t j = 0; j < _headers.size(); j++) {
+			const Common::UString &cell = getCell(i, j).string;
+			const bool needQuote = cell.contains(' ');
 
 			Common::UString cellString;
 			if (needQuote)
-				cellString = Common::UString::format("\"%s\"", _rows[i]->_data[j].c_str());
+				cellString = Common::UString::format("\"%s\"", cell.c_str());
 			else
-				cellString = _rows[i]->_data[j];
+				cellString = cell;
 
 			out.writeString(Common::UString::format(" %-*s", (int)colLength[j + 1], cellString.c_str()));
 
@@ -503,10 +550,8 @@ void TwoDAFile::writeBinary(Common::WriteStream &out) const {
 	cells.reserve(cellCount);
 
 	for (size_t i = 0; i < rowCount; i++) {
-		assert(_rows[i]);
-
 		for (size_t j = 0; j < columnCount; j++) {
-			const Common::UString cell = _rows[i]->getString(j);
+			const Common::UString cell = _rows[i].getString(j);
 
 			// Do we already know about this cell data string?
 			size_t foundCell = SIZE_MAX;
@@ -579,19 +624,20 @@ void TwoDAFile::writeCSV(Common::WriteStream &out) const {
 	// Write array
 
 	for (size_t i = 0; i < _rows.size(); i++) {
-		for (size_t j = 0; j < _rows[i]->_data.size(); j++) {
-			const bool needQuote = _rows[i]->_data[j].contains(',');
+		for (size_t j = 0; j < _headers.size(); j++) {
+			const Common::UString &cell = getCell(i, j).string;
+			const bool needQuote = cell.contains(',');
 
 			if (needQuote)
 				out.writeByte('"');
 
-			if (_rows[i]->_data[j] != "****")
-				out.writeString(_rows[i]->_data[j]);
+			if (cell != "****")
+				out.writeString(cell);
 
 			if (needQuote)
 				out.writeByte('"');
 
-			if (j < (_rows[i]->_data.size() - 1))
+			if (j < (_headers.size() - 1))
 				out.writeByte(',');
 		}
 
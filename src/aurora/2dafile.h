@@ -28,6 +28,8 @@
 #include <vector>
 #include <map>
 
+#include <boost/unordered/unordered_map.hpp>
+
 #include "src/common/types.h"
 #include "src/common/ustring.h"
 
@@ -49,8 +51,9 @@ class TwoDAFile;
  *  data, identified by either their column index or column header
  *  string.
  *
- *  For convenience's sake, there are also methods to directly parse
- *  the cell strings into integer or floating point values.
+ *  For convenience's sake, there are also methods to directly return
+ *  the cell strings as integer or floating point values. These values
+ *  are parsed once, when the 2DA is loaded.
  *
  *  See also class TwoDAFile.
  */
@@ -77,14 +80,11 @@ public:
 	bool empty(const Common::UString &column) const;
 
 private:
-	TwoDAFile *_parent; ///< The parent 2DA.
-
-	std::vector<Common::UString> _data;
+	const TwoDAFile *_parent; ///< The parent 2DA.
 
-	TwoDARow(TwoDAFile &parent);
-	~TwoDARow();
+	size_t _row; ///< The index of this row within the parent 2DA.
 
-	const Common::UString &getCell(size_t n) const;
+	TwoDARow(const TwoDAFile &parent, size_t row);
 
 	friend class TwoDAFile;
 };
@@ -112,6 +112,11 @@ private:
  *  be read and modified with a simple text editor. The binary
  *  version cannot.
  *
+ *  Internally, the cells are stored column by column, as indices into
+ *  a pool of all distinct cell values of the 2DA. Each value in this
+ *  pool already holds its integer and floating point interpretation,
+ *  so reading a cell never needs to parse or allocate anything.
+ *
  *  See also classes TwoDARow and TwoDARegistry.
  */
 class TwoDAFile : public AuroraBase {
@@ -154,6 +159,30 @@ public:
 private:
 	typedef std::map<Common::UString, size_t, Common::UString::iless> HeaderMap;
 
+	/** A distinct cell value. */
+	struct CellValue {
+		Common::UString string; ///< The raw contents of the cell.
+
+		bool  empty;      ///< Is the cell empty, i.e. "" or "****"?
+		int32 intValue;   ///< The contents parsed as an int.
+		float floatValue; ///< The contents parsed as a float.
+
+		CellValue(const Common::UString &str);
+	};
+
+	/** Hash a cell string byte-wise, without decoding it. */
+	struct hashValue {
+		size_t operator()(const Common::UString &value) const;
+	};
+
+	/** Compare two cell strings byte-wise, without decoding them. */
+	struct equalValue {
+		bool operator()(const Common::UString &a, const Common::UString &b) const;
+	};
+
+	/** Maps cell strings to their index in the value pool, while loading. */
+	typedef boost::unordered_map<Common::UString, uint32, hashValue, equalValue> ValueMap;
+
 	Common::UString _defaultString; ///< The default string to return should a cell not exist.
 	int32           _defaultInt;    ///< The default int to return should a cell not exist.
 	float           _defaultFloat;  ///< The default float to return should a cell not exist.
@@ -162,7 +191,12 @@ private:
 	HeaderMap _headerMap;
 
 	TwoDARow _emptyRow;
-	std::vector<TwoDARow *> _rows;
+	std::vector<TwoDARow> _rows;
+
+	/** All distinct cell values. The first one is always the empty string. */
+	std::vector<CellValue> _values;
+	/** The value pool index of each cell, stored column by column. */
+	std::vector<uint32> _cells;
 
 	// Loading helpers
 	void load(Common::SeekableReadStream &twoda);
@@ -182,6 +216,14 @@ private:
 
 	void createHeaderMap();
 
+	/** Add a cell string to the value pool, returning its index. */
+	uint32 addValue(ValueMap &values, const Common::UString &str);
+	/** Create the rows and the column-wise cells out of row-wise value indices. */
+	void createCells(const std::vector<uint32> &rowCells, size_t rowCount);
+
+	/** Return the value of a specific cell. */
+	const CellValue &getCell(size_t row, size_t column) const;
+
 	static int32 parseInt(const Common::UString &str);
 	static float parseFloat(const Common::UString &str);
 
@@ -32,6 +32,7 @@
 #include "src/common/strutil.h"
 #include "src/common/error.h"
 #include "src/common/memreadstream.h"
+#include "src/common/mappedfile.h"
 
 #include "src/aurora/biffile.h"
 #include "src/aurora/keyfile.h"
@@ -147,6 +148,11 @@ uint32 BIFFile::getResourceSize(uint32 index) const {
 Common::SeekableReadStream *BIFFile::getResource(uint32 index, bool tryNoCopy) const {
 	const IResource &res = getIResource(index);
 
+	// If the BIF is mapped into memory, we can just give out a view into it
+	const Common::MappedFile *mappedBIF = dynamic_cast<const Common::MappedFile *>(_bif);
+	if (mappedBIF)
+		return mappedBIF->readView(res.offset, res.size);
+
 	if (tryNoCopy)
 		return new Common::SeekableSubReadStream(_bif, res.offset, res.offset + res.size);
 
@@ -30,6 +30,7 @@
 
 #include "src/common/memreadstream.h"
 #include "src/common/readfile.h"
+#include "src/common/mappedfile.h"
 #include "src/common/util.h"
 #include "src/common/strutil.h"
 #include "src/common/error.h"
@@ -685,13 +686,22 @@ uint32 ERFFile::getResourceSize(uint32 index) const {
 Common::SeekableReadStream *ERFFile::getResource(uint32 index, bool tryNoCopy) const {
 	const IResource &res = getIResource(index);
 
-	if (tryNoCopy && (_header.encryption == kEncryptionNone) && (_header.compression == kCompressionNone))
-		return new Common::SeekableSubReadStream(_erf, res.offset, res.offset + res.packedSize);
+	/* If the ERF is mapped into memory, we can read the packed data as a view into
+	 * it. For unencrypted, uncompressed resources, that's already the result. */
+	const Common::MappedFile *mappedERF = dynamic_cast<const Common::MappedFile *>(_erf);
 
-	_erf->seek(res.offset);
+	if (!mappedERF && tryNoCopy &&
+	    (_header.encryption == kEncryptionNone) && (_header.compression == kCompressionNone))
+		return new Common::SeekableSubReadStream(_erf, res.offset, res.offset + res.packedSize);
 
 	// Read
-	Common::MemoryReadStream *stream = _erf->readStream(res.packedSize);
+	Common::MemoryReadStream *stream = 0;
+	if (mappedERF) {
+		stream = mappedERF->readView(res.offset, res.packedSize);
+	} else {
+		_erf->seek(res.offset);
+		stream = _erf->readStream(res.packedSize);
+	}
 
 	// Decrypt
 	if (_header.encryption != kEncryptionNone)
@@ -26,13 +26,17 @@
  * (<https://github.com/xoreos/xoreos-docs/tree/master/specs/bioware>)
  */
 
+#include "src/common/atomic.h"
+
 #include <cassert>
+#include <algorithm>
 
 #include "src/common/error.h"
 #include "src/common/memreadstream.h"
 #include "src/common/encoding.h"
 #include "src/common/ustring.h"
 #include "src/common/strutil.h"
+#include "src/common/hash.h"
 
 #include "src/aurora/gff3file.h"
 #include "src/aurora/util.h"
@@ -42,8 +46,25 @@
 static const uint32 kVersion32 = MKTAG('V', '3', '.', '2');
 static const uint32 kVersion33 = MKTAG('V', '3', '.', '3'); // Found in The Witcher, different language table
 
+static const uint32 kStructSize = 12;
+
 namespace Aurora {
 
+/** Source of the unique IDs identifying GFF3File instances. */
+static boost::atomic<uint32> gff3UID(0);
+
+
+GFF3FieldKey::GFF3FieldKey(const Common::UString &label) : _label(label), _gffUID(0), _labelID(0) {
+}
+
+GFF3FieldKey::GFF3FieldKey(const char *label) : _label(label), _gffUID(0), _labelID(0) {
+}
+
+const Common::UString &GFF3FieldKey::getLabel() const {
+	return _label;
+}
+
+
 GFF3File::Header::Header() {
 }
 
@@ -64,13 +85,15 @@ void GFF3File::Header::read(Common::SeekableReadStream &gff3) {
 
 
 GFF3File::GFF3File(Common::SeekableReadStream *gff3, uint32 id, bool repairNWNPremium) :
-	_stream(gff3), _repairNWNPremium(repairNWNPremium), _offsetCorrection(0) {
+	_stream(gff3), _data(0), _size(0), _repairNWNPremium(repairNWNPremium), _offsetCorrection(0),
+	_uid(++gff3UID) {
 
 	load(id);
 }
 
 GFF3File::GFF3File(const Common::UString &gff3, FileType type, uint32 id, bool repairNWNPremium) :
-	_stream(0), _repairNWNPremium(repairNWNPremium), _offsetCorrection(0) {
+	_stream(0), _data(0), _size(0), _repairNWNPremium(repairNWNPremium), _offsetCorrection(0),
+	_uid(++gff3UID) {
 
 	_stream = ResMan.getResource(gff3, type);
 	if (!_stream)
@@ -87,10 +110,19 @@ void GFF3File::clear() {
 	delete _stream;
 	_stream = 0;
 
+	_data = 0;
+	_size = 0;
+
 	for (StructArray::iterator strct = _structs.begin(); strct != _structs.end(); ++strct)
 		delete *strct;
+	for (ListArray::iterator list = _lists.begin(); list != _lists.end(); ++list)
+		delete *list;
 
 	_structs.clear();
+	_lists.clear();
+
+	_labelIDs.clear();
+	_labels.clear();
 }
 
 uint32 GFF3File::getType() const {
@@ -107,9 +139,14 @@ void GFF3File::load(uint32 id) {
 	try {
 
 		loadHeader(id);
+		loadData();
 		loadStructs();
 		loadLists();
 
+		// Create the top-level struct right away, so that a broken GFF3 is found early
+		if (_header.structCount > 0)
+			getTopLevel();
+
 	} catch (Common::Exception &e) {
 		clear();
 
@@ -180,68 +217,84 @@ void GFF3File::loadHeader(uint32 id) {
 		throw Common::Exception("GFF3 header broken: section offset points outside stream");
 }
 
-void GFF3File::loadStructs() {
-	static const uint32 kStructSize = 12;
-
-	_structs.reserve(_header.structCount);
-	for (uint32 i = 0; i < _header.structCount; i++)
-		_structs.push_back(new GFF3Struct(*this, _header.structOffset + i * kStructSize));
-}
-
-void GFF3File::loadLists() {
-	_stream->seek(_header.listIndicesOffset);
-
-	// Read list array
-	std::vector<uint32> rawLists;
-	rawLists.resize(_header.listIndicesCount / 4);
-	for (std::vector<uint32>::iterator it = rawLists.begin(); it != rawLists.end(); ++it)
-		*it = _stream->readUint32LE();
+void GFF3File::loadData() {
+	Common::MemoryReadStream *data = dynamic_cast<Common::MemoryReadStream *>(_stream);
+	if (!data) {
+		// Not in memory yet. Read it all at once, and keep only that copy around
+		_stream->seek(0);
+		data = _stream->readStream(_stream->size());
 
-	// Counting the actual amount of lists
-	uint32 listCount = 0;
-	for (size_t i = 0; i < rawLists.size(); i++) {
-		uint32 n = rawLists[i];
+		delete _stream;
+		_stream = data;
+	}
 
-		if ((i + n) > rawLists.size())
-			throw Common::Exception("GFF3: List indices broken");
+	_data = data->getData();
+	_size = data->size();
+}
 
-		i += n;
-		listCount++;
-	}
+void GFF3File::loadStructs() {
+	// Labels are interned on first use, the first time a field references them
+	const size_t maxLabelCount = (_size - _header.labelOffset) / 16;
+	_labelIDs.resize(MIN<size_t>(_header.labelCount, maxLabelCount), (uint32) kLabelInvalid);
 
-	_lists.resize(listCount);
-	_listOffsetToIndex.resize(rawLists.size(), 0xFFFFFFFF);
+	if (_header.structCount > ((_size - _header.structOffset) / kStructSize))
+		throw Common::Exception("GFF3 header broken: structs extend past the end of the stream");
 
-	// Converting the raw list array into real, useable lists
-	uint32 listIndex = 0;
-	for (size_t i = 0; i < rawLists.size(); listIndex++) {
-		_listOffsetToIndex[i] = listIndex;
+	_structs.resize(_header.structCount, 0);
+}
 
-		const uint32 n = rawLists[i++];
-		assert((i + n) <= rawLists.size());
+void GFF3File::loadLists() {
+	if (_header.listIndicesCount > (_size - _header.listIndicesOffset))
+		throw Common::Exception("GFF3 header broken: list indices extend past the end of the stream");
 
-		_lists[listIndex].resize(n);
-		for (uint32 j = 0; j < n; j++, i++)
-			_lists[listIndex][j] = _structs[rawLists[i]];
-	}
+	_lists.resize(_header.listIndicesCount / 4, 0);
 }
 
 // --- Helpers for GFF3Struct ---
 
 const GFF3Struct &GFF3File::getStruct(uint32 i) const {
-	assert(i < _structs.size());
+	if (i >= _structs.size())
+		throw Common::Exception("GFF3: Struct index out of range (%u/%u)", i, (uint)_structs.size());
+
+	if (!_structs[i])
+		_structs[i] = new GFF3Struct(*this, _header.structOffset + i * kStructSize);
 
 	return *_structs[i];
 }
 
 const GFF3List &GFF3File::getList(uint32 i) const {
-	assert(i < _listOffsetToIndex.size());
+	if (i >= _lists.size())
+		throw Common::Exception("GFF3: List index out of range (%u/%u)", i, (uint)_lists.size());
+
+	if (_lists[i])
+		return *_lists[i];
 
-	i = _listOffsetToIndex[i];
+	// The list indices are the struct count, followed by that many struct indices
+	const uint32 n = READ_LE_UINT32(getData(_header.listIndicesOffset + i * 4, 4));
+	if (n > (_lists.size() - i - 1))
+		throw Common::Exception("GFF3: List indices broken");
+
+	const byte *indices = getData(_header.listIndicesOffset + (i + 1) * 4, n * 4);
+
+	GFF3List *list = new GFF3List(n);
+
+	try {
+		for (uint32 j = 0; j < n; j++)
+			(*list)[j] = &getStruct(READ_LE_UINT32(indices + j * 4));
+	} catch (...) {
+		delete list;
+		throw;
+	}
+
+	_lists[i] = list;
+	return *list;
+}
 
-	assert(i < _lists.size());
+const byte *GFF3File::getData(size_t offset, size_t size) const {
+	if ((offset > _size) || (size > (_size - offset)))
+		throw Common::Exception(Common::kReadError);
 
-	return _lists[i];
+	return _data + offset;
 }
 
 Common::SeekableReadStream &GFF3File::getStream(uint32 offset) const {
@@ -254,11 +307,64 @@ Common::SeekableReadStream &GFF3File::getFieldData() const {
 	return getStream(_header.fieldDataOffset);
 }
 
+size_t GFF3File::hashLabel::operator()(const Common::UString &label) const {
+	uint32 hash = 0x811C9DC5;
 
-GFF3Struct::Field::Field() : type(kFieldTypeNone), data(0), extended(false) {
+	for (const char *c = label.c_str(); *c; c++)
+		hash = Common::hashFNV32(hash, (byte) *c);
+
+	return hash;
+}
+
+uint32 GFF3File::internLabel(uint32 index) const {
+	if ((index < _labelIDs.size()) && (_labelIDs[index] != kLabelInvalid))
+		return _labelIDs[index];
+
+	const size_t offset = _header.labelOffset + (size_t) index * 16;
+	if (offset > _size)
+		throw Common::Exception(Common::kReadError);
+
+	Common::MemoryReadStream labelData(_data + offset, MIN<size_t>(_size - offset, 16));
+	const Common::UString label = Common::readStringFixed(labelData, Common::kEncodingASCII, 16);
+
+	// Several label table entries might hold the same string. They all map onto the same ID
+	std::pair<LabelMap::iterator, bool> result = _labels.insert(std::make_pair(label, (uint32) _labels.size()));
+
+	if (index < _labelIDs.size())
+		_labelIDs[index] = result.first->second;
+
+	return result.first->second;
+}
+
+uint32 GFF3File::findLabel(const Common::UString &label) const {
+	LabelMap::const_iterator l = _labels.find(label);
+	if (l == _labels.end())
+		return kLabelInvalid;
+
+	return l->second;
+}
+
+uint32 GFF3File::findLabel(const GFF3FieldKey &key) const {
+	if (key._gffUID == _uid)
+		return key._labelID;
+
+	/* Labels are only interned once a struct using them is read. Don't remember
+	 * a miss, because a struct loaded later might still intern this label. */
+
+	const uint32 labelID = findLabel(key._label);
+	if (labelID != kLabelInvalid) {
+		key._labelID = labelID;
+		key._gffUID  = _uid;
+	}
+
+	return labelID;
+}
+
+
+GFF3Struct::Field::Field() : label(GFF3File::kLabelInvalid), type(kFieldTypeNone), data(0), extended(false) {
 }
 
-GFF3Struct::Field::Field(FieldType t, uint32 d) : type(t), data(d) {
+GFF3Struct::Field::Field(uint32 l, FieldType t, uint32 d) : label(l), type(t), data(d) {
 	// These field types need extended field data
 	extended = (type == kFieldTypeUint64     ) ||
 	           (type == kFieldTypeSint64     ) ||
@@ -272,6 +378,14 @@ GFF3Struct::Field::Field(FieldType t, uint32 d) : type(t), data(d) {
 	           (type == kFieldTypeStrRef     );
 }
 
+bool GFF3Struct::Field::operator<(const Field &right) const {
+	return label < right.label;
+}
+
+bool GFF3Struct::Field::operator<(uint32 right) const {
+	return label < right;
+}
+
 
 GFF3Struct::GFF3Struct(const GFF3File &parent, uint32 offset) : _parent(&parent) {
 	load(offset);
@@ -283,66 +397,66 @@ GFF3Struct::~GFF3Struct() {
 // --- Loader ---
 
 void GFF3Struct::load(uint32 offset) {
-	Common::SeekableReadStream &data = _parent->getStream(offset);
+	const byte *data = _parent->getData(offset, 12);
 
-	_id         = data.readUint32LE();
-	_fieldIndex = data.readUint32LE();
-	_fieldCount = data.readUint32LE();
+	_id         = READ_LE_UINT32(data + 0);
+	_fieldIndex = READ_LE_UINT32(data + 4);
+	_fieldCount = READ_LE_UINT32(data + 8);
 
 	// Read the field(s)
 	if      (_fieldCount == 1)
-		readField (data, _fieldIndex);
+		readField (_fieldIndex);
 	else if (_fieldCount > 1)
-		readFields(data, _fieldIndex, _fieldCount);
+		readFields(_fieldIndex, _fieldCount);
+
+	sortFields();
 }
 
-void GFF3Struct::readField(Common::SeekableReadStream &data, uint32 index) {
+void GFF3Struct::readField(uint32 index) {
 	// Sanity check
 	if (index > _parent->_header.fieldCount)
 		throw Common::Exception("GFF3: Field index out of range (%d/%d)",
 				index, _parent->_header.fieldCount);
 
-	// Seek
-	data.seek(_parent->_header.fieldOffset + index * 12);
+	const byte *data = _parent->getData(_parent->_header.fieldOffset + (size_t) index * 12, 12);
 
 	// Read the field data
-	const uint32 fieldType  = data.readUint32LE();
-	const uint32 fieldLabel = data.readUint32LE();
-	const uint32 fieldData  = data.readUint32LE();
+	const uint32 fieldType  = READ_LE_UINT32(data + 0);
+	const uint32 fieldLabel = READ_LE_UINT32(data + 4);
+	const uint32 fieldData  = READ_LE_UINT32(data + 8);
 
-	// And add it to the map
-	_fields[readLabel(data, fieldLabel)] = Field((FieldType) fieldType, fieldData);
+	// And add it to the field array
+	_fields.push_back(Field(_parent->internLabel(fieldLabel), (FieldType) fieldType, fieldData));
 }
 
-void GFF3Struct::readFields(Common::SeekableReadStream &data, uint32 index, uint32 count) {
+void GFF3Struct::readFields(uint32 index, uint32 count) {
 	// Sanity check
 	if (index > _parent->_header.fieldIndicesCount)
 		throw Common::Exception("GFF3: Field indices index out of range (%d/%d)",
 		                        index , _parent->_header.fieldIndicesCount);
 
-	// Seek
-	data.seek(_parent->_header.fieldIndicesOffset + index);
-
-	// Read the field indices
-	std::vector<uint32> indices;
-	readIndices(data, indices, count);
+	const byte *indices = _parent->getData(_parent->_header.fieldIndicesOffset + (size_t) index, (size_t) count * 4);
 
 	// Read the fields
-	for (std::vector<uint32>::const_iterator i = indices.begin(); i != indices.end(); ++i)
-		readField(data, *i);
+	_fields.reserve(count);
+	for (uint32 i = 0; i < count; i++)
+		readField(READ_LE_UINT32(indices + i * 4));
 }
 
-void GFF3Struct::readIndices(Common::SeekableReadStream &data,
-                             std::vector<uint32> &indices, uint32 count) const {
-	indices.reserve(count);
-	while (count-- > 0)
-		indices.push_back(data.readUint32LE());
-}
+void GFF3Struct::sortFields() {
+	std::stable_sort(_fields.begin(), _fields.end());
 
-Common::UString GFF3Struct::readLabel(Common::SeekableReadStream &data, uint32 index) const {
-	data.seek(_parent->_header.labelOffset + index * 16);
+	// If a label appears more than once, the last field with that label wins
+	FieldArray::iterator last = _fields.begin();
+	for (FieldArray::const_iterator f = _fields.begin(); f != _fields.end(); ++f) {
+		FieldArray::const_iterator next = f + 1;
+		if ((next != _fields.end()) && (next->label == f->label))
+			continue;
 
-	return Common::readStringFixed(data, Common::kEncodingASCII, 16);
+		*last++ = *f;
+	}
+
+	_fields.erase(last, _fields.end());
 }
 
 Common::SeekableReadStream &GFF3Struct::getData(const Field &field) const {
@@ -364,22 +478,152 @@ bool GFF3Struct::hasField(const Common::UString &field) const {
 	return getField(field) != 0;
 }
 
+bool GFF3Struct::hasField(const GFF3FieldKey &field) const {
+	return getField(field) != 0;
+}
+
 uint32 GFF3Struct::getID() const {
 	return _id;
 }
 
 // --- Field value reader helpers ---
 
-const GFF3Struct::Field *GFF3Struct::getField(const Common::UString &name) const {
-	FieldMap::const_iterator field = _fields.find(name);
-	if (field == _fields.end())
+const GFF3Struct::Field *GFF3Struct::getField(uint32 label) const {
+	if (label == GFF3File::kLabelInvalid)
+		return 0;
+
+	FieldArray::const_iterator field = std::lower_bound(_fields.begin(), _fields.end(), label);
+	if ((field == _fields.end()) || (field->label != label))
 		return 0;
 
-	return &field->second;
+	return &*field;
 }
 
+const GFF3Struct::Field *GFF3Struct::getField(const Common::UString &name) const {
+	return getField(_parent->findLabel(name));
+}
+
+const GFF3Struct::Field *GFF3Struct::getField(const GFF3FieldKey &key) const {
+	return getField(_parent->findLabel(key));
+}
+
+// --- Field value readers, by label string and by pre-resolved key ---
+
 char GFF3Struct::getChar(const Common::UString &field, char def) const {
-	const Field *f = getField(field);
+	return getChar(getField(field), def);
+}
+
+char GFF3Struct::getChar(const GFF3FieldKey &field, char def) const {
+	return getChar(getField(field), def);
+}
+
+uint64 GFF3Struct::getUint(const Common::UString &field, uint64 def) const {
+	return getUint(getField(field), def);
+}
+
+uint64 GFF3Struct::getUint(const GFF3FieldKey &field, uint64 def) const {
+	return getUint(getField(field), def);
+}
+
+int64 GFF3Struct::getSint(const Common::UString &field, int64 def) const {
+	return getSint(getField(field), def);
+}
+
+int64 GFF3Struct::getSint(const GFF3FieldKey &field, int64 def) const {
+	return getSint(getField(field), def);
+}
+
+bool GFF3Struct::getBool(const Common::UString &field, bool def) const {
+	return getUint(getField(field), def) != 0;
+}
+
+bool GFF3Struct::getBool(const GFF3FieldKey &field, bool def) const {
+	return getUint(getField(field), def) != 0;
+}
+
+double GFF3Struct::getDouble(const Common::UString &field, double def) const {
+	return getDouble(getField(field), def);
+}
+
+double GFF3Struct::getDouble(const GFF3FieldKey &field, double def) const {
+	return getDouble(getField(field), def);
+}
+
+Common::UString GFF3Struct::getString(const Common::UString &field, const Common::UString &def) const {
+	return getString(getField(field), def);
+}
+
+Common::UString GFF3Struct::getString(const GFF3FieldKey &field, const Common::UString &def) const {
+	return getString(getField(field), def);
+}
+
+bool GFF3Struct::getLocString(const Common::UString &field, LocString &str) const {
+	return getLocString(getField(field), str);
+}
+
+bool GFF3Struct::getLocString(const GFF3FieldKey &field, LocString &str) const {
+	return getLocString(getField(field), str);
+}
+
+Common::SeekableReadStream *GFF3Struct::getData(const Common::UString &field) const {
+	return getData(getField(field));
+}
+
+Common::SeekableReadStream *GFF3Struct::getData(const GFF3FieldKey &field) const {
+	return getData(getField(field));
+}
+
+void GFF3Struct::getVector(const Common::UString &field, float &x, float &y, float &z) const {
+	getVector(getField(field), x, y, z);
+}
+
+void GFF3Struct::getVector(const GFF3FieldKey &field, float &x, float &y, float &z) const {
+	getVector(getField(field), x, y, z);
+}
+
+void GFF3Struct::getOrientation(const Common::UString &field, float &a, float &b, float &c, float &d) const {
+	getOrientation(getField(field), a, b, c, d);
+}
+
+void GFF3Struct::getOrientation(const GFF3FieldKey &field, float &a, float &b, float &c, float &d) const {
+	getOrientation(getField(field), a, b, c, d);
+}
+
+void GFF3Struct::getVector(const Common::UString &field, double &x, double &y, double &z) const {
+	getVector(getField(field), x, y, z);
+}
+
+void GFF3Struct::getVector(const GFF3FieldKey &field, double &x, double &y, double &z) const {
+	getVector(getField(field), x, y, z);
+}
+
+void GFF3Struct::getOrientation(const Common::UString &field, double &a, double &b, double &c, double &d) const {
+	getOrientation(getField(field), a, b, c, d);
+}
+
+void GFF3Struct::getOrientation(const GFF3FieldKey &field, double &a, double &b, double &c, double &d) const {
+	getOrientation(getField(field), a, b, c, d);
+}
+
+const GFF3Struct &GFF3Struct::getStruct(const Common::UString &field) const {
+	return getStruct(getField(field));
+}
+
+const GFF3Struct &GFF3Struct::getStruct(const GFF3FieldKey &field) const {
+	return getStruct(getField(field));
+}
+
+const GFF3List &GFF3Struct::getList(const Common::UString &field) const {
+	return getList(getField(field));
+}
+
+const GFF3List &GFF3Struct::getList(const GFF3FieldKey &field) const {
+	return getList(getField(field));
+}
+
+// --- Field value readers ---
+
+char GFF3Struct::getChar(const Field *f, char def) const {
 	if (!f)
 		return def;
 	if (f->type != kFieldTypeChar)
@@ -388,8 +632,7 @@ char GFF3Struct::getChar(const Common::UString &field, char def) const {
 	return (char) f->data;
 }
 
-uint64 GFF3Struct::getUint(const Common::UString &field, uint64 def) const {
-	const Field *f = getField(field);
+uint64 GFF3Struct::getUint(const Field *f, uint64 def) const {
 	if (!f)
 		return def;
 
@@ -423,8 +666,7 @@ uint64 GFF3Struct::getUint(const Common::UString &field, uint64 def) const {
 	throw Common::Exception("GFF3: Field is not an int type");
 }
 
-int64 GFF3Struct::getSint(const Common::UString &field, int64 def) const {
-	const Field *f = getField(field);
+int64 GFF3Struct::getSint(const Field *f, int64 def) const {
 	if (!f)
 		return def;
 
@@ -458,12 +700,7 @@ int64 GFF3Struct::getSint(const Common::UString &field, int64 def) const {
 	throw Common::Exception("GFF3: Field is not an int type");
 }
 
-bool GFF3Struct::getBool(const Common::UString &field, bool def) const {
-	return getUint(field, def) != 0;
-}
-
-double GFF3Struct::getDouble(const Common::UString &field, double def) const {
-	const Field *f = getField(field);
+double GFF3Struct::getDouble(const Field *f, double def) const {
 	if (!f)
 		return def;
 
@@ -475,10 +712,9 @@ double GFF3Struct::getDouble(const Common::UString &field, double def) const {
 	throw Common::Exception("GFF3: Field is not a double type");
 }
 
-Common::UString GFF3Struct::getString(const Common::UString &field,
+Common::UString GFF3Struct::getString(const Field *f,
                                       const Common::UString &def) const {
 
-	const Field *f = getField(field);
 	if (!f)
 		return def;
 
@@ -498,7 +734,7 @@ Common::UString GFF3Struct::getString(const Common::UString &field,
 
 	if (f->type == kFieldTypeLocString) {
 		LocString locString;
-		getLocString(field, locString);
+		getLocString(f, locString);
 
 		return locString.getString();
 	}
@@ -509,7 +745,7 @@ Common::UString GFF3Struct::getString(const Common::UString &field,
 	    (f->type == kFieldTypeUint64) ||
 	    (f->type == kFieldTypeStrRef)) {
 
-		return Common::composeString(getUint(field));
+		return Common::composeString(getUint(f, 0));
 	}
 
 	if ((f->type == kFieldTypeChar  ) ||
@@ -517,19 +753,19 @@ Common::UString GFF3Struct::getString(const Common::UString &field,
 	    (f->type == kFieldTypeSint32) ||
 	    (f->type == kFieldTypeSint64)) {
 
-		return Common::composeString(getSint(field));
+		return Common::composeString(getSint(f, 0));
 	}
 
 	if ((f->type == kFieldTypeFloat) ||
 	    (f->type == kFieldTypeDouble)) {
 
-		return Common::composeString(getDouble(field));
+		return Common::composeString(getDouble(f, 0.0));
 	}
 
 	if (f->type == kFieldTypeVector) {
 		float x = 0.0, y = 0.0, z = 0.0;
 
-		getVector(field, x, y, z);
+		getVector(f, x, y, z);
 		return Common::composeString(x) + "/" +
 		       Common::composeString(y) + "/" +
 		       Common::composeString(z);
@@ -538,7 +774,7 @@ Common::UString GFF3Struct::getString(const Common::UString &field,
 	if (f->type == kFieldTypeOrientation) {
 		float a = 0.0, b = 0.0, c = 0.0, d = 0.0;
 
-		getOrientation(field, a, b, c, d);
+		getOrientation(f, a, b, c, d);
 		return Common::composeString(a) + "/" +
 		       Common::composeString(b) + "/" +
 		       Common::composeString(c) + "/" +
@@ -548,8 +784,7 @@ Common::UString GFF3Struct::getString(const Common::UString &field,
 	throw Common::Exception("GFF3: Field is not a string(able) type");
 }
 
-bool GFF3Struct::getLocString(const Common::UString &field, LocString &str) const {
-	const Field *f = getField(field);
+bool GFF3Struct::getLocString(const Field *f, LocString &str) const {
 	if (!f || (f->type != kFieldTypeLocString))
 		return false;
 
@@ -572,8 +807,7 @@ bool GFF3Struct::getLocString(const Common::UString &field, LocString &str) cons
 	return true;
 }
 
-Common::SeekableReadStream *GFF3Struct::getData(const Common::UString &field) const {
-	const Field *f = getField(field);
+Common::SeekableReadStream *GFF3Struct::getData(const Field *f) const {
 	if (!f)
 		return 0;
 
@@ -587,13 +821,12 @@ Common::SeekableReadStream *GFF3Struct::getData(const Common::UString &field) co
 	else
 		throw Common::Exception("GFF3: Field is not a data type");
 
-	return data.readStream(size);
+	return new Common::MemoryReadStream(_parent->getData(data.pos(), size), size);
 }
 
-void GFF3Struct::getVector(const Common::UString &field,
+void GFF3Struct::getVector(const Field *f,
                            float &x, float &y, float &z) const {
 
-	const Field *f = getField(field);
 	if (!f)
 		return;
 	if (f->type != kFieldTypeVector)
@@ -606,10 +839,9 @@ void GFF3Struct::getVector(const Common::UString &field,
 	z = data.readIEEEFloatLE();
 }
 
-void GFF3Struct::getOrientation(const Common::UString &field,
+void GFF3Struct::getOrientation(const Field *f,
                                 float &a, float &b, float &c, float &d) const {
 
-	const Field *f = getField(field);
 	if (!f)
 		return;
 	if (f->type != kFieldTypeOrientation)
@@ -623,10 +855,9 @@ void GFF3Struct::getOrientation(const Common::UString &field,
 	d = data.readIEEEFloatLE();
 }
 
-void GFF3Struct::getVector(const Common::UString &field,
+void GFF3Struct::getVector(const Field *f,
                            double &x, double &y, double &z) const {
 
-	const Field *f = getField(field);
 	if (!f)
 		return;
 	if (f->type != kFieldTypeVector)
@@ -639,10 +870,9 @@ void GFF3Struct::getVector(const Common::UString &field,
 	z = data.readIEEEFloatLE();
 }
 
-void GFF3Struct::getOrientation(const Common::UString &field,
+void GFF3Struct::getOrientation(const Field *f,
                                 double &a, double &b, double &c, double &d) const {
 
-	const Field *f = getField(field);
 	if (!f)
 		return;
 	if (f->type != kFieldTypeOrientation)
@@ -658,8 +888,7 @@ void GFF3Struct::getOrientation(const Common::UString &field,
 
 // --- Struct reader ---
 
-const GFF3Struct &GFF3Struct::getStruct(const Common::UString &field) const {
-	const Field *f = getField(field);
+const GFF3Struct &GFF3Struct::getStruct(const Field *f) const {
 	if (!f)
 		throw Common::Exception("GFF3: No such field");
 	if (f->type != kFieldTypeStruct)
@@ -671,8 +900,7 @@ const GFF3Struct &GFF3Struct::getStruct(const Common::UString &field) const {
 
 // --- Struct list reader ---
 
-const GFF3List &GFF3Struct::getList(const Common::UString &field) const {
-	const Field *f = getField(field);
+const GFF3List &GFF3Struct::getList(const Field *f) const {
 	if (!f)
 		throw Common::Exception("GFF3: No such field");
 	if (f->type != kFieldTypeList)
@@ -26,7 +26,8 @@
 #define AURORA_GFF3FILE_H
 
 #include <vector>
-#include <map>
+
+#include <boost/unordered/unordered_map.hpp>
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
@@ -41,11 +42,44 @@ namespace Common {
 namespace Aurora {
 
 class LocString;
+class GFF3File;
 class GFF3Struct;
 
+/** A pre-resolved GFF3 field label.
+ *
+ *  Looking up a field by its label string needs to hash that string
+ *  first. A GFF3FieldKey remembers which label ID its string maps to
+ *  within the last GFF3 it was used with, so that repeated lookups in
+ *  structs of the same GFF3 only need to compare an integer.
+ *
+ *  A key can be used with structs of any GFF3; it re-resolves itself
+ *  whenever it's used with a different file. Since it caches this
+ *  state, a key must not be shared between threads.
+ */
+class GFF3FieldKey {
+public:
+	explicit GFF3FieldKey(const Common::UString &label);
+	explicit GFF3FieldKey(const char *label);
+
+	/** Return the label string of this key. */
+	const Common::UString &getLabel() const;
+
+private:
+	Common::UString _label;
+
+	mutable uint32 _gffUID;  ///< The unique ID of the GFF3 the key was last successfully resolved in.
+	mutable uint32 _labelID; ///< The label ID within that GFF3.
+
+	friend class GFF3File;
+};
+
 /** A GFF (generic file format) V3.2/V3.3 file, found in all Aurora games
  *  except Sonic Chronicles: The Dark Brotherhood. Even games that have
  *  V4.0/V4.1 GFFs additionally use V3.2/V3.3 files as well.
+ *
+ *  The whole GFF3 is held as one contiguous buffer. If the stream it's
+ *  read from is already a memory stream, its data is used directly.
+ *  Structs and lists are only created when they're first accessed.
  */
 class GFF3File : public AuroraBase {
 public:
@@ -82,11 +116,23 @@ private:
 	};
 
 	typedef std::vector<GFF3Struct *> StructArray;
-	typedef std::vector<GFF3List> ListArray;
+	typedef std::vector<GFF3List *> ListArray;
+
+	/** Hash a GFF3 label. Labels are plain ASCII, so we can hash the bytes directly. */
+	struct hashLabel {
+		size_t operator()(const Common::UString &label) const;
+	};
+
+	typedef boost::unordered_map<Common::UString, uint32, hashLabel> LabelMap;
+
+	static const uint32 kLabelInvalid = 0xFFFFFFFF;
 
 
 	Common::SeekableReadStream *_stream;
 
+	const byte *_data; ///< The whole GFF3, owned by _stream.
+	size_t      _size; ///< The size of the whole GFF3.
+
 	Header _header; ///< The GFF's header
 
 	/** Should we try to read GFF files found in Neverwinter Nights premium modules? */
@@ -94,16 +140,24 @@ private:
 	/** The correctional value for offsets to repair Neverwinter Nights premium modules. */
 	uint32 _offsetCorrection;
 
-	StructArray _structs; ///< Our structs.
-	ListArray   _lists;   ///< Our lists.
+	/** Our structs, created on first access. */
+	mutable StructArray _structs;
+	/** Our lists, indexed by their offset into the list indices, created on first access. */
+	mutable ListArray _lists;
 
-	/** To convert list offsets found in GFF to real indices. */
-	std::vector<uint32> _listOffsetToIndex;
+	/** A unique ID of this GFF3 instance, to validate cached GFF3FieldKeys. */
+	uint32 _uid;
+
+	/** The interned label IDs, indexed by their position in the label table. */
+	mutable std::vector<uint32> _labelIDs;
+	/** All distinct labels, mapped to their interned label IDs. */
+	mutable LabelMap _labels;
 
 
 	// .--- Loading helpers
 	void load(uint32 id);
 	void loadHeader(uint32 id);
+	void loadData();
 	void loadStructs();
 	void loadLists();
 
@@ -116,10 +170,20 @@ private:
 	/** Return the GFF stream seeked to the start of the field data. */
 	Common::SeekableReadStream &getFieldData() const;
 
+	/** Return a pointer to size bytes of the GFF data, starting at offset. */
+	const byte *getData(size_t offset, size_t size) const;
+
 	/** Return a struct within the GFF. */
 	const GFF3Struct &getStruct(uint32 i) const;
 	/** Return a list within the GFF. */
 	const GFF3List   &getList  (uint32 i) const;
+
+	/** Read the label with this label table index and return its interned ID. */
+	uint32 internLabel(uint32 index) const;
+	/** Return the interned ID of this label, or kLabelInvalid if no field read so far uses it. */
+	uint32 findLabel(const Common::UString &label) const;
+	/** Return the interned ID of this key's label, using and updating the key's cache. */
+	uint32 findLabel(const GFF3FieldKey &key) const;
 	// '---
 
 	friend class GFF3Struct;
@@ -135,6 +199,7 @@ public:
 	size_t getFieldCount() const;
 	/** Does this specific field exist? */
 	bool hasField(const Common::UString &field) const;
+	bool hasField(const GFF3FieldKey &field) const;
 
 	// .--- Read field values
 	char   getChar(const Common::UString &field, char   def = '\0' ) const;
@@ -142,29 +207,57 @@ public:
 	 int64 getSint(const Common::UString &field,  int64 def = 0    ) const;
 	bool   getBool(const Common::UString &field, bool   def = false) const;
 
+	char   getChar(const GFF3FieldKey &field, char   def = '\0' ) const;
+	uint64 getUint(const GFF3FieldKey &field, uint64 def = 0    ) const;
+	 int64 getSint(const GFF3FieldKey &field,  int64 def = 0    ) const;
+	bool   getBool(const GFF3FieldKey &field, bool   def = false) const;
+
 	double getDouble(const Common::UString &field, double def = 0.0) const;
+	double getDouble(const GFF3FieldKey    &field, double def = 0.0) const;
 
 	Common::UString getString(const Common::UString &field,
 	                          const Common::UString &def = "") const;
+	Common::UString getString(const GFF3FieldKey &field,
+	                          const Common::UString &def = "") const;
 
 	bool getLocString(const Common::UString &field, LocString &str) const;
+	bool getLocString(const GFF3FieldKey    &field, LocString &str) const;
 
 	void getVector     (const Common::UString &field,
 	                    float &x, float &y, float &z          ) const;
 	void getOrientation(const Common::UString &field,
 	                    float &a, float &b, float &c, float &d) const;
 
+	void getVector     (const GFF3FieldKey &field,
+	                    float &x, float &y, float &z          ) const;
+	void getOrientation(const GFF3FieldKey &field,
+	                    float &a, float &b, float &c, float &d) const;
+
 	void getVector     (const Common::UString &field,
 	                    double &x, double &y, double &z           ) const;
 	void getOrientation(const Common::UString &field,
 	                    double &a, double &b, double &c, double &d) const;
 
+	void getVector     (const GFF3FieldKey &field,
+	                    double &x, double &y, double &z           ) const;
+	void getOrientation(const GFF3FieldKey &field,
+	                    double &a, double &b, double &c, double &d) const;
+
+	/** Return the raw data of a void, string or resref field.
+	 *
+	 *  The stream reads directly out of the GFF3's memory, without copying.
+	 *  It must not be used after the GFF3File has been destroyed.
+	 */
 	Common::SeekableReadStream *getData(const Common::UString &field) const;
+	Common::SeekableReadStream *getData(const GFF3FieldKey    &field) const;
 	// '---
 
 	// .--- Structs and lists of structs
 	const GFF3Struct &getStruct(const Common::UString &field) const;
 	const GFF3List   &getList  (const Common::UString &field) const;
+
+	const GFF3Struct &getStruct(const GFF3FieldKey &field) const;
+	const GFF3List   &getList  (const GFF3FieldKey &field) const;
 	// '---
 
 private:
@@ -194,15 +287,20 @@ private:
 
 	/** A field in the GFF3 struct. */
 	struct Field {
+		uint32    label;    ///< Interned label ID of the field.
 		FieldType type;     ///< Type of the field.
 		uint32    data;     ///< Data of the field.
 		bool      extended; ///< Does this field need extended data?
 
 		Field();
-		Field(FieldType t, uint32 d);
+		Field(uint32 l, FieldType t, uint32 d);
+
+		bool operator<(const Field &right) const;
+		bool operator<(uint32 right) const;
 	};
 
-	typedef std::map<Common::UString, Field> FieldMap;
+	/** The fields of a struct, sorted by their label ID. */
+	typedef std::vector<Field> FieldArray;
 
 
 	const GFF3File *_parent; ///< The parent GFF.
@@ -211,7 +309,7 @@ private:
 	uint32 _fieldIndex; ///< Field / Field indices index.
 	uint32 _fieldCount; ///< Field count.
 
-	FieldMap _fields; ///< The fields, indexed by their label.
+	FieldArray _fields; ///< The fields, sorted by their label ID.
 
 
 	// .--- Loader
@@ -220,21 +318,46 @@ private:
 
 	void load(uint32 offset);
 
-	void readField  (Common::SeekableReadStream &data, uint32 index);
-	void readFields (Common::SeekableReadStream &data, uint32 index, uint32 count);
-	void readIndices(Common::SeekableReadStream &data,
-	                 std::vector<uint32> &indices, uint32 count) const;
+	void readField (uint32 index);
+	void readFields(uint32 index, uint32 count);
 
-	Common::UString readLabel(Common::SeekableReadStream &data, uint32 index) const;
+	void sortFields();
 	// '---
 
 	// .--- Field and field data accessors
+	/** Returns the field with this interned label ID. */
+	const Field *getField(uint32 label) const;
 	/** Returns the field with this tag. */
 	const Field *getField(const Common::UString &name) const;
+	/** Returns the field with this pre-resolved tag. */
+	const Field *getField(const GFF3FieldKey &key) const;
 	/** Returns the extended field data for this field. */
 	Common::SeekableReadStream &getData(const Field &field) const;
 	// '---
 
+	// .--- Field value readers, shared by the by-name and the by-key accessors
+	char   getChar(const Field *f, char   def) const;
+	uint64 getUint(const Field *f, uint64 def) const;
+	 int64 getSint(const Field *f,  int64 def) const;
+
+	double getDouble(const Field *f, double def) const;
+
+	Common::UString getString(const Field *f, const Common::UString &def) const;
+
+	bool getLocString(const Field *f, LocString &str) const;
+
+	void getVector     (const Field *f, float &x, float &y, float &z) const;
+	void getOrientation(const Field *f, float &a, float &b, float &c, float &d) const;
+
+	void getVector     (const Field *f, double &x, double &y, double &z) const;
+	void getOrientation(const Field *f, double &a, double &b, double &c, double &d) const;
+
+	Common::SeekableReadStream *getData(const Field *f) const;
+
+	const GFF3Struct &getStruct(const Field *f) const;
+	const GFF3List   &getList  (const Field *f) const;
+	// '---
+
 	friend class GFF3File;
 };
 
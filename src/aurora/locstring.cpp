@@ -109,21 +109,21 @@ void LocString::setString(uint32 languageID, const Common::UString &str) {
 	_strings[languageID] = str;
 }
 
-const Common::UString &LocString::getStrRefString() const {
+Common::UString LocString::getStrRefString() const {
 	if (_id == kStrRefInvalid)
 		return kEmpty;
 
 	return TalkMan.getString(_id);
 }
 
-const Common::UString &LocString::getFirstString() const {
+Common::UString LocString::getFirstString() const {
 	if (_strings.empty())
 		return getStrRefString();
 
 	return _strings.begin()->second;
 }
 
-const Common::UString &LocString::getString() const {
+Common::UString LocString::getString() const {
 	uint32 languageID = LangMan.getLanguageID(LangMan.getCurrentLanguageText(), LangMan.getCurrentGender());
 
 	// Look whether we have an internal localized string
@@ -135,7 +135,7 @@ const Common::UString &LocString::getString() const {
 		return getString(LangMan.swapLanguageGender(languageID));
 
 	// Next, try the external localized one
-	const Common::UString &refString = getStrRefString();
+	const Common::UString refString = getStrRefString();
 	if (!refString.empty())
 		return refString;
 
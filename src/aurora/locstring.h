@@ -69,13 +69,13 @@ public:
 	void setString(Language language, const Common::UString &str);
 
 	/** Get the string the StrRef points to. */
-	const Common::UString &getStrRefString() const;
+	Common::UString getStrRefString() const;
 
 	/** Get the first available string. */
-	const Common::UString &getFirstString() const;
+	Common::UString getFirstString() const;
 
 	/** Try to get the most appropriate string. */
-	const Common::UString &getString() const;
+	Common::UString getString() const;
 
 	/** Read a string out of a stream. */
 	void readString(uint32 languageID, Common::SeekableReadStream &stream);
@@ -49,6 +49,8 @@ using Common::kDebugScripts;
 static const uint32 kNCSTag    = MKTAG('N', 'C', 'S', ' ');
 static const uint32 kVersion10 = MKTAG('V', '1', '.', '0');
 
+static const uint32 kCodeStart = 13; // 8 byte header + 5 byte program size dummy op
+
 static const uint32 kScriptObjectSelf        = 0x00000000;
 static const uint32 kScriptObjectInvalid     = 0x00000001;
 static const uint32 kScriptObjectInvalid2    = 0xFFFFFFFF;
@@ -58,11 +60,34 @@ namespace Aurora {
 
 namespace NWScript {
 
+Common::Mutex NCSStack::_poolMutex;
+std::vector< std::vector<Variable> > NCSStack::_pool;
+
 NCSStack::NCSStack() {
+	Common::StackLock lock(_poolMutex);
+
+	if (!_pool.empty()) {
+		swap(_pool.back());
+		_pool.pop_back();
+	}
+
 	reset();
 }
 
 NCSStack::~NCSStack() {
+	reset();
+
+	Common::StackLock lock(_poolMutex);
+
+	if (_pool.size() >= kMaxPoolSize)
+		return;
+
+	// Reserve the whole pool, so that the vectors are never copied
+	if (_pool.capacity() < kMaxPoolSize)
+		_pool.reserve(kMaxPoolSize);
+
+	_pool.push_back(std::vector<Variable>());
+	_pool.back().swap(*this);
 }
 
 void NCSStack::reset() {
@@ -83,7 +108,7 @@ Variable &NCSStack::top() {
 	return at(_stackPtr);
 }
 
-Variable NCSStack::pop() {
+Variable &NCSStack::pop() {
 	if (_stackPtr == -1)
 		throw Common::Exception("NCSStack: Stack underflow");
 
@@ -274,28 +299,48 @@ void NCSFile::setupOpcodes() {
 
 #undef OPCODE
 
-NCSFile::NCSFile(Common::SeekableReadStream *ncs) : _owner(0), _triggerer(0) {
-	_script = ncs;
+NCSFile::Instruction::Instruction() : address(0), opcode(0), type(kInstTypeNone), proc(0),
+	argFloat(0.0f), jump(SIZE_MAX) {
+
+	args[0] = 0;
+	args[1] = 0;
+	args[2] = 0;
+}
+
+
+Common::Mutex         NCSFile::_programCacheMutex;
+NCSFile::ProgramCache NCSFile::_programCache;
+uint32                NCSFile::_programCacheGeneration = 0;
+
+NCSFile::NCSFile(Common::SeekableReadStream *ncs) : _pc(0), _owner(0), _triggerer(0) {
+	assert(ncs);
+
+	setupOpcodes();
 
 	try {
-		load();
+		boost::shared_ptr<Program> program = boost::make_shared<Program>();
+		load(*ncs, *program);
+
+		_program = program;
 	} catch (...) {
-		delete _script;
+		delete ncs;
+		throw;
 	}
+
+	delete ncs;
+
+	reset();
 }
 
-NCSFile::NCSFile(const Common::UString &ncs) : _name(ncs), _script(0),
-	_owner(0), _triggerer(0) {
+NCSFile::NCSFile(const Common::UString &ncs) : _name(ncs), _pc(0), _owner(0), _triggerer(0) {
+	setupOpcodes();
 
-	_script = ResMan.getResource(ncs, kFileTypeNCS);
-	if (!_script)
-		throw Common::Exception("No such NCS \"%s\"", ncs.c_str());
+	_program = getProgram(ncs);
 
-	load();
+	reset();
 }
 
 NCSFile::~NCSFile() {
-	delete _script;
 }
 
 const Common::UString &NCSFile::getName() const {
@@ -313,13 +358,49 @@ void NCSFile::setEnvironment(const VariableContainer &env) {
 ScriptState NCSFile::getEmptyState() {
 	ScriptState state;
 
-	state.offset = 13; // 8 byte header + 5 byte program size dummy op
+	state.offset = kCodeStart;
 
 	return state;
 }
 
-void NCSFile::load() {
-	readHeader(*_script);
+NCSFile::ProgramPtr NCSFile::getProgram(const Common::UString &name) {
+	const Common::UString key = name.toLower();
+
+	Common::StackLock lock(_programCacheMutex);
+
+	// If the resources changed since we cached the scripts, the scripts might have too
+	const uint32 generation = ResMan.getGeneration();
+	if (generation != _programCacheGeneration) {
+		_programCache.clear();
+		_programCacheGeneration = generation;
+	}
+
+	ProgramCache::const_iterator cached = _programCache.find(key);
+	if (cached != _programCache.end())
+		return cached->second;
+
+	Common::SeekableReadStream *ncs = ResMan.getResource(name, kFileTypeNCS);
+	if (!ncs)
+		throw Common::Exception("No such NCS \"%s\"", name.c_str());
+
+	boost::shared_ptr<Program> program = boost::make_shared<Program>();
+
+	try {
+		load(*ncs, *program);
+	} catch (...) {
+		delete ncs;
+		throw;
+	}
+
+	delete ncs;
+
+	_programCache.insert(std::make_pair(key, program));
+
+	return program;
+}
+
+void NCSFile::load(Common::SeekableReadStream &ncs, Program &program) {
+	readHeader(ncs);
 
 	if (_id != kNCSTag)
 		throw Common::Exception("Try to load non-NCS file");
@@ -327,19 +408,205 @@ void NCSFile::load() {
 	if (_version != kVersion10)
 		throw Common::Exception("Unsupported NCS file version %08X", _version);
 
-	byte lengthOpcode = _script->readByte();
+	byte lengthOpcode = ncs.readByte();
 	if (lengthOpcode != 0x42)
 		throw Common::Exception("Script size opcode != 0x42 (0x%02X)", lengthOpcode);
 
-	uint32 length = _script->readUint32BE();
-	if (length > ((uint32) _script->size()))
-		throw Common::Exception("Script size %u > stream size %u", length, (uint)_script->size());
-	if (length < ((uint32) _script->size()))
-		warning("TODO: NCSFile::load(): Script size %u < stream size %u", length, (uint)_script->size());
+	uint32 length = ncs.readUint32BE();
+	if (length > ((uint32) ncs.size()))
+		throw Common::Exception("Script size %u > stream size %u", length, (uint)ncs.size());
+	if (length < ((uint32) ncs.size()))
+		warning("TODO: NCSFile::load(): Script size %u < stream size %u", length, (uint)ncs.size());
 
-	setupOpcodes();
+	decode(ncs, program);
+}
 
-	reset();
+void NCSFile::decode(Common::SeekableReadStream &ncs, Program &program) const {
+	/* We decode the script by following its control flow, from the start
+	 * and from every jump target on. Like this, anything we can't decode
+	 * only breaks the script once execution actually reaches it. */
+
+	typedef std::map<uint32, std::pair<Instruction, uint32> > DecodedInstructions;
+
+	const uint32 size = ncs.size();
+
+	DecodedInstructions decoded;
+	std::vector<uint32> targets(1, kCodeStart);
+
+	while (!targets.empty()) {
+		uint32 address = targets.back();
+		targets.pop_back();
+
+		while ((address >= kCodeStart) && (address < size) && (decoded.find(address) == decoded.end())) {
+			ncs.seek(address);
+
+			Instruction instr;
+			const uint32 next = decodeInstruction(ncs, instr, program, targets);
+
+			decoded.insert(std::make_pair(address, std::make_pair(instr, next)));
+			address = next;
+		}
+	}
+
+	program.instructions.reserve(decoded.size());
+
+	uint32 fallThrough = 0;
+	for (DecodedInstructions::const_iterator d = decoded.begin(); d != decoded.end(); ++d) {
+		if ((fallThrough != 0) && (fallThrough != d->first)) {
+			// The previous instruction continues into the middle of this one
+
+			program.instructions.push_back(Instruction());
+			program.instructions.back().address = fallThrough;
+			program.instructions.back().proc    = &NCSFile::o_illegal;
+		}
+
+		program.addresses[d->first] = program.instructions.size();
+		program.instructions.push_back(d->second.first);
+
+		fallThrough = d->second.second;
+	}
+
+	// Jumping to the very end stops the script
+	program.addresses.insert(std::make_pair(size, program.instructions.size()));
+
+	// Resolve the jump targets
+	for (std::vector<Instruction>::iterator i = program.instructions.begin(); i != program.instructions.end(); ++i) {
+		if ((i->opcode != kOpcodeJMP) && (i->opcode != kOpcodeJSR) &&
+		    (i->opcode != kOpcodeJZ ) && (i->opcode != kOpcodeJNZ))
+			continue;
+
+		std::map<uint32, size_t>::const_iterator target = program.addresses.find(i->address + i->args[0]);
+		if (target != program.addresses.end())
+			i->jump = target->second;
+	}
+}
+
+uint32 NCSFile::decodeInstruction(Common::SeekableReadStream &ncs, Instruction &instr,
+                                  Program &program, std::vector<uint32> &targets) const {
+
+	instr.address = ncs.pos();
+	instr.proc    = &NCSFile::o_illegal;
+
+	try {
+		instr.opcode = ncs.readByte();
+		instr.type   = (InstructionType) ncs.readByte();
+
+		if ((instr.opcode >= _opcodeListSize) || (!_opcodes[instr.opcode].proc))
+			return 0;
+
+		switch (instr.opcode) {
+			case kOpcodeCONST:
+				switch (instr.type) {
+					case kInstTypeInt:
+						instr.args[0] = ncs.readSint32BE();
+						break;
+
+					case kInstTypeFloat:
+						instr.argFloat = ncs.readIEEEFloatBE();
+						break;
+
+					case kInstTypeString:
+					case kInstTypeResource:
+						instr.args[0] = program.strings.size();
+						program.strings.push_back(Common::readStringFixed(ncs, Common::kEncodingASCII, ncs.readUint16BE()));
+						break;
+
+					case kInstTypeObject:
+						instr.args[0] = (int32) ncs.readUint32BE();
+						break;
+
+					default:
+						// We don't know how long this instruction is. o_const() throws when it's executed
+						instr.proc = &NCSFile::o_const;
+						return 0;
+				}
+				break;
+
+			case kOpcodeACTION:
+				instr.args[0] = ncs.readUint16BE();
+				instr.args[1] = ncs.readByte();
+				break;
+
+			case kOpcodeEQ:
+			case kOpcodeNEQ:
+				if (instr.type == kInstTypeStructStruct)
+					instr.args[0] = ncs.readUint16BE();
+				break;
+
+			case kOpcodeMOVSP:
+			case kOpcodeDECSP:
+			case kOpcodeINCSP:
+			case kOpcodeDECBP:
+			case kOpcodeINCBP:
+				instr.args[0] = ncs.readSint32BE();
+				break;
+
+			case kOpcodeJMP:
+			case kOpcodeJSR:
+			case kOpcodeJZ:
+			case kOpcodeJNZ:
+				instr.args[0] = ncs.readSint32BE();
+
+				targets.push_back(instr.address + instr.args[0]);
+				break;
+
+			case kOpcodeCPDOWNSP:
+			case kOpcodeCPTOPSP:
+			case kOpcodeCPDOWNBP:
+			case kOpcodeCPTOPBP:
+			case kOpcodeWRITEARRAY:
+			case kOpcodeREADARRAY:
+			case kOpcodeGETREF:
+			case kOpcodeGETREFARRAY:
+				instr.args[0] = ncs.readSint32BE();
+				instr.args[1] = ncs.readSint16BE();
+				break;
+
+			case kOpcodeDESTRUCT:
+				instr.args[0] = ncs.readSint16BE();
+				instr.args[1] = ncs.readSint16BE();
+				instr.args[2] = ncs.readSint16BE();
+				break;
+
+			case kOpcodeSTORESTATE:
+				instr.args[0] = (int32) ncs.readUint32BE();
+				instr.args[1] = (int32) ncs.readUint32BE();
+
+				// The stored state continues at an offset given by the type
+				targets.push_back(instr.address + (uint8) instr.type);
+				break;
+
+			default:
+				break;
+		}
+
+	} catch (...) {
+		// Cut off at the end of the script
+		return 0;
+	}
+
+	instr.proc = _opcodes[instr.opcode].proc;
+
+	if ((instr.opcode == kOpcodeJMP) || (instr.opcode == kOpcodeRETN))
+		return 0;
+
+	return ncs.pos();
+}
+
+size_t NCSFile::findInstruction(uint32 address) const {
+	std::map<uint32, size_t>::const_iterator index = _program->addresses.find(address);
+	if (index == _program->addresses.end())
+		throw Common::Exception("NCSFile::findInstruction(): No instruction at offset %u", address);
+
+	return index->second;
+}
+
+void NCSFile::jump(const Instruction &instr) {
+	if (instr.jump == SIZE_MAX)
+		throw Common::Exception("NCSFile::jump(): Invalid jump from %u to %u",
+		                        instr.address, instr.address + instr.args[0]);
+
+	_pc = instr.jump;
 }
 
 void NCSFile::reset() {
@@ -351,7 +618,7 @@ void NCSFile::reset() {
 	_storedState.setType(kTypeVoid);
 	_return.setType(kTypeVoid);
 
-	_script->seek(13); // 8 byte header + 5 byte program size dummy op
+	_pc = findInstruction(kCodeStart);
 }
 
 const Variable &NCSFile::run(Object *owner, Object *triggerer) {
@@ -364,7 +631,7 @@ const Variable &NCSFile::run(const ScriptState &state, Object *owner, Object *tr
 
 	reset();
 
-	_script->seek(state.offset);
+	_pc = findInstruction(state.offset);
 
 	// Push global variables
 	std::vector<class Variable>::const_reverse_iterator var;
@@ -384,8 +651,20 @@ const Variable &NCSFile::execute(Object *owner, Object *triggerer) {
 	_owner     = owner;
 	_triggerer = triggerer;
 
-	while (executeStep())
-		;
+	const std::vector<Instruction> &instructions = _program->instructions;
+
+	while (_pc < instructions.size()) {
+		const Instruction &instr = instructions[_pc++];
+
+		debugC(1, kDebugScripts, "NWScript opcode %s [0x%02X]",
+		       (instr.opcode < _opcodeListSize) ? _opcodes[instr.opcode].desc : "", instr.opcode);
+
+		(this->*(instr.proc))(instr);
+
+		_stack.print();
+		debugC(2, kDebugScripts, "[RETURN: %d]",
+		       _returnOffsets.empty() ? -1 : (int) _returnOffsets.top());
+	}
 
 	if (!_stack.empty())
 		_return = _stack.top();
@@ -400,47 +679,14 @@ const Variable &NCSFile::execute(Object *owner, Object *triggerer) {
 	return _return;
 }
 
-bool NCSFile::executeStep() {
-	byte opcode, type;
-
-	try {
-		opcode = _script->readByte();
-		type   = _script->readByte();
-	} catch (...) {
-		return false;
-	}
-
-	if ((opcode >= _opcodeListSize) || (!_opcodes[opcode].proc))
-		throw Common::Exception("NCSFile::executeStep(): Illegal instruction 0x%02x", opcode);
-
-	debugC(1, kDebugScripts, "NWScript opcode %s [0x%02X]", _opcodes[opcode].desc, opcode);
-
-	try {
-		(this->*(_opcodes[opcode].proc))((InstructionType)type);
-	} catch (Common::Exception &UNUSED(e)) {
-		throw;
-	}
-
-	_stack.print();
-	debugC(2, kDebugScripts, "[RETURN: %d]",
-	       _returnOffsets.empty() ? -1 : _returnOffsets.top());
-
-	return true;
-}
-
 void NCSFile::decompile() {
-	uint32 oldScriptPos = _script->pos();
-	_script->seek(13); // 8 byte header + 5 byte program size dummy op
-
 	// TODO
-
-	_script->seek(oldScriptPos);
 }
 
 // OPCODES!
 
-void NCSFile::o_rsadd(InstructionType type) {
-	switch (type) {
+void NCSFile::o_rsadd(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeInt:
 			_stack.push(kTypeInt);
 			break;
@@ -476,28 +722,28 @@ void NCSFile::o_rsadd(InstructionType type) {
 			_stack.push(kTypeArray);
 			break;
 		default:
-			throw Common::Exception("NCSFile::o_rsadd(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_rsadd(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_const(InstructionType type) {
-	switch (type) {
+void NCSFile::o_const(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeInt:
-			_stack.push(_script->readSint32BE());
+			_stack.push(instr.args[0]);
 			break;
 
 		case kInstTypeFloat:
-			_stack.push(_script->readIEEEFloatBE());
+			_stack.push(instr.argFloat);
 			break;
 
 		case kInstTypeString:
 		case kInstTypeResource: {
-			_stack.push(Common::readStringFixed(*_script, Common::kEncodingASCII, _script->readUint16BE()));
+			_stack.push(_program->strings[instr.args[0]]);
 			break;
 		}
 
 		case kInstTypeObject: {
-			uint32 objectID = _script->readUint32BE();
+			uint32 objectID = (uint32) instr.args[0];
 
 			if      (objectID == kScriptObjectSelf)
 				_stack.push(_owner);
@@ -514,7 +760,7 @@ void NCSFile::o_const(InstructionType type) {
 		}
 
 		default:
-			throw Common::Exception("NCSFile::o_const(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_const(): Illegal type %d", instr.type);
 	}
 }
 
@@ -545,7 +791,7 @@ void NCSFile::callEngine(Aurora::NWScript::FunctionContext &ctx,
 			case kTypeEngineType:
 			case kTypeReference:
 			case kTypeArray:
-				param = _stack.pop();
+				param.swap(_stack.pop());
 				break;
 
 			case kTypeVector: {
@@ -605,12 +851,12 @@ void NCSFile::callEngine(Aurora::NWScript::FunctionContext &ctx,
 	}
 }
 
-void NCSFile::o_action(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_action(): Illegal type %d", type);
+void NCSFile::o_action(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_action(): Illegal type %d", instr.type);
 
-	uint16 routineNumber = _script->readUint16BE();
-	uint8  argCount      = _script->readByte();
+	uint16 routineNumber = instr.args[0];
+	uint8  argCount      = instr.args[1];
 
 	Aurora::NWScript::FunctionContext ctx = FunctionMan.createContext(routineNumber);
 
@@ -623,9 +869,9 @@ void NCSFile::o_action(InstructionType type) {
 	}
 }
 
-void NCSFile::o_logand(InstructionType type) {
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_logand(): Illegal type %d", type);
+void NCSFile::o_logand(const Instruction &instr) {
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_logand(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -636,9 +882,9 @@ void NCSFile::o_logand(InstructionType type) {
 	}
 }
 
-void NCSFile::o_logor(InstructionType type) {
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_logor(): Illegal type %d", type);
+void NCSFile::o_logor(const Instruction &instr) {
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_logor(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -649,9 +895,9 @@ void NCSFile::o_logor(InstructionType type) {
 	}
 }
 
-void NCSFile::o_incor(InstructionType type) {
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_incor(): Illegal type %d", type);
+void NCSFile::o_incor(const Instruction &instr) {
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_incor(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -662,9 +908,9 @@ void NCSFile::o_incor(InstructionType type) {
 	}
 }
 
-void NCSFile::o_excor(InstructionType type) {
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_excor(): Illegal type %d", type);
+void NCSFile::o_excor(const Instruction &instr) {
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_excor(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -675,9 +921,9 @@ void NCSFile::o_excor(InstructionType type) {
 	}
 }
 
-void NCSFile::o_booland(InstructionType type) {
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_booland(): Illegal type %d", type);
+void NCSFile::o_booland(const Instruction &instr) {
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_booland(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -688,13 +934,13 @@ void NCSFile::o_booland(InstructionType type) {
 	}
 }
 
-void NCSFile::o_eq(InstructionType type) {
+void NCSFile::o_eq(const Instruction &instr) {
 	size_t n = 1;
 
-	if (type == kInstTypeStructStruct) {
+	if (instr.type == kInstTypeStructStruct) {
 		// Comparisons between two structs (or two vectors) come with the size of the type
 
-		const size_t size = _script->readUint16BE();
+		const size_t size = instr.args[0];
 
 		if ((size % 4) != 0)
 			throw Common::Exception("NCSFile::o_eq(): size %% 4 != 0");
@@ -716,13 +962,13 @@ void NCSFile::o_eq(InstructionType type) {
 	_stack.push(args1 == args2);
 }
 
-void NCSFile::o_neq(InstructionType type) {
+void NCSFile::o_neq(const Instruction &instr) {
 	size_t n = 1;
 
-	if (type == kInstTypeStructStruct) {
+	if (instr.type == kInstTypeStructStruct) {
 		// Comparisons between two structs (or two vectors) come with the size of the type
 
-		const size_t size = _script->readUint16BE();
+		const size_t size = instr.args[0];
 
 		if ((size % 4) != 0)
 			throw Common::Exception("NCSFile::o_eq(): size %% 4 != 0");
@@ -744,8 +990,8 @@ void NCSFile::o_neq(InstructionType type) {
 	_stack.push(args1 != args2);
 }
 
-void NCSFile::o_geq(InstructionType type) {
-	switch (type) {
+void NCSFile::o_geq(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt:
 			try {
 				int32 arg1 = _stack.pop().getInt();
@@ -767,12 +1013,12 @@ void NCSFile::o_geq(InstructionType type) {
 			break;
 
 		default:
-			throw Common::Exception("NCSFile::o_geq(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_geq(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_gt(InstructionType type) {
-	switch (type) {
+void NCSFile::o_gt(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt:
 			try {
 				int32 arg1 = _stack.pop().getInt();
@@ -794,12 +1040,12 @@ void NCSFile::o_gt(InstructionType type) {
 			break;
 
 		default:
-			throw Common::Exception("NCSFile::o_gt(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_gt(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_lt(InstructionType type) {
-	switch (type) {
+void NCSFile::o_lt(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt:
 			try {
 				int32 arg1 = _stack.pop().getInt();
@@ -821,12 +1067,12 @@ void NCSFile::o_lt(InstructionType type) {
 			break;
 
 		default:
-			throw Common::Exception("NCSFile::o_lt(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_lt(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_leq(InstructionType type) {
-	switch (type) {
+void NCSFile::o_leq(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt:
 			try {
 				int32 arg1 = _stack.pop().getInt();
@@ -848,13 +1094,13 @@ void NCSFile::o_leq(InstructionType type) {
 			break;
 
 		default:
-			throw Common::Exception("NCSFile::o_leq(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_leq(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_shleft(InstructionType type) {
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_shleft(): Illegal type %d", type);
+void NCSFile::o_shleft(const Instruction &instr) {
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_shleft(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -865,15 +1111,15 @@ void NCSFile::o_shleft(InstructionType type) {
 	}
 }
 
-void NCSFile::o_shright(InstructionType type) {
+void NCSFile::o_shright(const Instruction &instr) {
 	/* According to Skywing's NWNScriptLib
 	 * (<https://github.com/SkywingvL/nwn2dev-public/blob/master/NWNScriptLib/NWScriptVM.cpp#L2233>):
 	 * "The operation implemented here is actually a complex sequence that, if
 	 *  the amount to be shifted is negative, involves both a front-loaded and
 	 *  end-loaded negate built on top of a signed shift." */
 
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_shright(): Illegal type %d", type);
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_shright(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -890,14 +1136,14 @@ void NCSFile::o_shright(InstructionType type) {
 	}
 }
 
-void NCSFile::o_ushright(InstructionType type) {
+void NCSFile::o_ushright(const Instruction &instr) {
 	/* According to Skywing's NWNScriptLib
 	 * (<https://github.com/SkywingvL/nwn2dev-public/blob/master/NWNScriptLib/NWScriptVM.cpp#L2272>):
 	 * "While this operator may have originally been intended to implement
 	 *  an unsigned shift, it actually performs an arithmetic (signed) shift." */
 
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_ushright(): Illegal type %d", type);
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_ushright(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -908,9 +1154,9 @@ void NCSFile::o_ushright(InstructionType type) {
 	}
 }
 
-void NCSFile::o_mod(InstructionType type) {
-	if (type != kInstTypeIntInt)
-		throw Common::Exception("NCSFile::o_mod(): Illegal type %d", type);
+void NCSFile::o_mod(const Instruction &instr) {
+	if (instr.type != kInstTypeIntInt)
+		throw Common::Exception("NCSFile::o_mod(): Illegal type %d", instr.type);
 
 	try {
 		int32 arg1 = _stack.pop().getInt();
@@ -927,8 +1173,8 @@ void NCSFile::o_mod(InstructionType type) {
 	}
 }
 
-void NCSFile::o_neg(InstructionType type) {
-	switch (type) {
+void NCSFile::o_neg(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeInt:
 			try {
 				_stack.push(-_stack.pop().getInt());
@@ -946,13 +1192,13 @@ void NCSFile::o_neg(InstructionType type) {
 			break;
 
 		default:
-			throw Common::Exception("NCSFile::o_neg(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_neg(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_comp(InstructionType type) {
-	if (type != kInstTypeInt)
-		throw Common::Exception("NCSFile::o_comp(): Illegal type %d", type);
+void NCSFile::o_comp(const Instruction &instr) {
+	if (instr.type != kInstTypeInt)
+		throw Common::Exception("NCSFile::o_comp(): Illegal type %d", instr.type);
 
 	try {
 		_stack.push(~_stack.pop().getInt());
@@ -961,109 +1207,104 @@ void NCSFile::o_comp(InstructionType type) {
 	}
 }
 
-void NCSFile::o_movsp(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_movsp(): Illegal type %d", type);
+void NCSFile::o_movsp(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_movsp(): Illegal type %d", instr.type);
 
-	_stack.setStackPtr(_stack.getStackPtr() - _script->readSint32BE());
+	_stack.setStackPtr(_stack.getStackPtr() - instr.args[0]);
 }
 
-void NCSFile::o_jmp(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_jmp(): Illegal type %d", type);
+void NCSFile::o_jmp(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_jmp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
-	_script->skip(offset - 6);
+	jump(instr);
 }
 
-void NCSFile::o_jz(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_jz(): Illegal type %d", type);
-
-	int32 offset = _script->readSint32BE();
+void NCSFile::o_jz(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_jz(): Illegal type %d", instr.type);
 
 	if (!_stack.pop().getInt())
-		_script->skip(offset - 6);
+		jump(instr);
 }
 
-void NCSFile::o_not(InstructionType type) {
-	if (type != kInstTypeInt)
-		throw Common::Exception("NCSFile::o_not(): Illegal type %d", type);
+void NCSFile::o_not(const Instruction &instr) {
+	if (instr.type != kInstTypeInt)
+		throw Common::Exception("NCSFile::o_not(): Illegal type %d", instr.type);
 
 	_stack.push(!_stack.pop().getInt());
 }
 
-void NCSFile::o_decsp(InstructionType type) {
-	if (type != kInstTypeInt)
-		throw Common::Exception("NCSFile::o_decsp(): Illegal type %d", type);
+void NCSFile::o_decsp(const Instruction &instr) {
+	if (instr.type != kInstTypeInt)
+		throw Common::Exception("NCSFile::o_decsp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = instr.args[0];
 
 	_stack.setRelSP(offset, _stack.getRelSP(offset).getInt() - 1);
 }
 
-void NCSFile::o_incsp(InstructionType type) {
-	if (type != kInstTypeInt)
-		throw Common::Exception("NCSFile::o_incsp(): Illegal type %d", type);
+void NCSFile::o_incsp(const Instruction &instr) {
+	if (instr.type != kInstTypeInt)
+		throw Common::Exception("NCSFile::o_incsp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = instr.args[0];
 
 	_stack.setRelSP(offset, _stack.getRelSP(offset).getInt() + 1);
 }
 
-void NCSFile::o_jnz(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_jnz(): Illegal type %d", type);
-
-	int32 offset = _script->readSint32BE();
+void NCSFile::o_jnz(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_jnz(): Illegal type %d", instr.type);
 
 	if (_stack.pop().getInt())
-		_script->skip(offset - 6);
+		jump(instr);
 }
 
-void NCSFile::o_decbp(InstructionType type) {
-	if (type != kInstTypeInt)
-		throw Common::Exception("NCSFile::o_decbp(): Illegal type %d", type);
+void NCSFile::o_decbp(const Instruction &instr) {
+	if (instr.type != kInstTypeInt)
+		throw Common::Exception("NCSFile::o_decbp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = instr.args[0];
 
 	_stack.setRelBP(offset, _stack.getRelBP(offset).getInt() - 1);
 }
 
-void NCSFile::o_incbp(InstructionType type) {
-	if (type != kInstTypeInt)
-		throw Common::Exception("NCSFile::o_incbp(): Illegal type %d", type);
+void NCSFile::o_incbp(const Instruction &instr) {
+	if (instr.type != kInstTypeInt)
+		throw Common::Exception("NCSFile::o_incbp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
+	int32 offset = instr.args[0];
 
 	_stack.setRelBP(offset, _stack.getRelBP(offset).getInt() + 1);
 }
 
-void NCSFile::o_savebp(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_savebp(): Illegal type %d", type);
+void NCSFile::o_savebp(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_savebp(): Illegal type %d", instr.type);
 
 	_stack.push(_stack.getBasePtr());
 	_stack.setBasePtr(_stack.getStackPtr());
 }
 
-void NCSFile::o_restorebp(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_restorebp(): Illegal type %d", type);
+void NCSFile::o_restorebp(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_restorebp(): Illegal type %d", instr.type);
 
 	_stack.setBasePtr(_stack.pop().getInt());
 }
 
-void NCSFile::o_nop(InstructionType UNUSED(type)) {
+void NCSFile::o_nop(const Instruction &UNUSED(instr)) {
 	// Nothing! Yay!
 }
 
-void NCSFile::o_cpdownsp(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_cpdownsp(): Illegal type %d", type);
+void NCSFile::o_cpdownsp(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_cpdownsp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0];
+	int16 size   = instr.args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cpdownsp(): Illegal size %d", size);
@@ -1078,12 +1319,12 @@ void NCSFile::o_cpdownsp(InstructionType type) {
 	}
 }
 
-void NCSFile::o_cptopsp(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_cptopsp(): Illegal type %d", type);
+void NCSFile::o_cptopsp(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_cptopsp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0];
+	int16 size   = instr.args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cptopsp(): Illegal size %d", size);
@@ -1095,43 +1336,43 @@ void NCSFile::o_cptopsp(InstructionType type) {
 	}
 }
 
-void NCSFile::o_add(InstructionType type) {
-	switch (type) {
+void NCSFile::o_add(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push((int32) (op1.getInt() + op2.getInt()));
 			break;
 		}
 
 		case kInstTypeFloatFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(op1.getFloat() + op2.getFloat());
 			break;
 		}
 
 		case kInstTypeIntFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(((float) op1.getInt()) + op2.getFloat());
 			break;
 		}
 
 		case kInstTypeFloatInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(op1.getFloat() + ((float) op2.getInt()));
 			break;
 		}
 
 		case kInstTypeStringString: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(op1.getString() + op2.getString());
 			break;
@@ -1152,39 +1393,39 @@ void NCSFile::o_add(InstructionType type) {
 		}
 
 		default:
-			throw Common::Exception("NCSFile::o_add(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_add(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_sub(InstructionType type) {
-	switch (type) {
+void NCSFile::o_sub(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push((int32) (op1.getInt() - op2.getInt()));
 			break;
 		}
 
 		case kInstTypeFloatFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(op1.getFloat() - op2.getFloat());
 			break;
 		}
 
 		case kInstTypeIntFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(((float) op1.getInt()) - op2.getFloat());
 			break;
 		}
 
 		case kInstTypeFloatInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(op1.getFloat() - ((float) op2.getInt()));
 			break;
@@ -1205,39 +1446,39 @@ void NCSFile::o_sub(InstructionType type) {
 		}
 
 		default:
-			throw Common::Exception("NCSFile::o_sub(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_sub(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_mul(InstructionType type) {
-	switch (type) {
+void NCSFile::o_mul(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push((int32) (op1.getInt() * op2.getInt()));
 			break;
 		}
 
 		case kInstTypeFloatFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(op1.getFloat() * op2.getFloat());
 			break;
 		}
 
 		case kInstTypeIntFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(((float) op1.getInt()) * op2.getFloat());
 			break;
 		}
 
 		case kInstTypeFloatInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			_stack.push(op1.getFloat() * ((float) op2.getInt()));
 			break;
@@ -1268,15 +1509,15 @@ void NCSFile::o_mul(InstructionType type) {
 		}
 
 		default:
-			throw Common::Exception("NCSFile::o_mul(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_mul(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_div(InstructionType type) {
-	switch (type) {
+void NCSFile::o_div(const Instruction &instr) {
+	switch (instr.type) {
 		case kInstTypeIntInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			if (op2.getInt() == 0)
 				throw Common::Exception("NCSFile::o_div(): Divide by zero");
@@ -1289,8 +1530,8 @@ void NCSFile::o_div(InstructionType type) {
 		}
 
 		case kInstTypeFloatFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			if (op2.getFloat() == 0.0f)
 				throw Common::Exception("NCSFile::o_div(): Divide by zero");
@@ -1300,8 +1541,8 @@ void NCSFile::o_div(InstructionType type) {
 		}
 
 		case kInstTypeIntFloat: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			if (op2.getFloat() == 0.0f)
 				throw Common::Exception("NCSFile::o_div(): Divide by zero");
@@ -1311,8 +1552,8 @@ void NCSFile::o_div(InstructionType type) {
 		}
 
 		case kInstTypeFloatInt: {
-			Variable op2 = _stack.pop();
-			Variable op1 = _stack.pop();
+			const Variable &op2 = _stack.pop();
+			const Variable &op1 = _stack.pop();
 
 			if (op2.getInt() == 0)
 				throw Common::Exception("NCSFile::o_div(): Divide by zero");
@@ -1352,44 +1593,42 @@ void NCSFile::o_div(InstructionType type) {
 		}
 
 		default:
-			throw Common::Exception("NCSFile::o_div(): Illegal type %d", type);
+			throw Common::Exception("NCSFile::o_div(): Illegal type %d", instr.type);
 	}
 }
 
-void NCSFile::o_storestateall(InstructionType type) {
-	uint8  offset = (uint8) type;
+void NCSFile::o_storestateall(const Instruction &instr) {
+	uint8  offset = (uint8) instr.type;
 
 	// TODO: NCSFile::o_storestateall(): See o_storestate.
 	//       Supposedly obsolete. Whether it's used anywhere remains to be seen.
 	warning("TODO: NCSFile::o_storestateall(): %d", offset);
 }
 
-void NCSFile::o_jsr(InstructionType type) {
-	if (type != kInstTypeNone)
-		throw Common::Exception("NCSFile::o_jsr(): Illegal type %d", type);
-
-	int32 offset = _script->readSint32BE();
+void NCSFile::o_jsr(const Instruction &instr) {
+	if (instr.type != kInstTypeNone)
+		throw Common::Exception("NCSFile::o_jsr(): Illegal type %d", instr.type);
 
-	// Push the current script position
-	_returnOffsets.push(_script->pos());
+	// Push the position after this instruction
+	_returnOffsets.push(_pc);
 
-	_script->skip(offset - 6);
+	jump(instr);
 }
 
-void NCSFile::o_retn(InstructionType UNUSED(type)) {
-	uint32 returnAddress = _script->size();
+void NCSFile::o_retn(const Instruction &UNUSED(instr)) {
+	size_t returnAddress = _program->instructions.size();
 	if (!_returnOffsets.empty()) {
 		returnAddress = _returnOffsets.top();
 		_returnOffsets.pop();
 	}
 
-	_script->seek(returnAddress);
+	_pc = returnAddress;
 }
 
-void NCSFile::o_destruct(InstructionType UNUSED(type)) {
-	int16 stackSize        = _script->readSint16BE();
-	int16 dontRemoveOffset = _script->readSint16BE();
-	int16 dontRemoveSize   = _script->readSint16BE();
+void NCSFile::o_destruct(const Instruction &instr) {
+	int16 stackSize        = instr.args[0];
+	int16 dontRemoveOffset = instr.args[1];
+	int16 dontRemoveSize   = instr.args[2];
 
 	if ((stackSize % 4) != 0)
 		throw Common::Exception("NCSFile::o_destruct(): Illegal stack size %d", stackSize);
@@ -1416,12 +1655,12 @@ void NCSFile::o_destruct(InstructionType UNUSED(type)) {
 		_stack.push(*t);
 }
 
-void NCSFile::o_cpdownbp(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_cpdownbp(): Illegal type %d", type);
+void NCSFile::o_cpdownbp(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_cpdownbp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE() - 4;
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0] - 4;
+	int16 size   = instr.args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cpdownbp(): Illegal size %d", size);
@@ -1436,12 +1675,12 @@ void NCSFile::o_cpdownbp(InstructionType type) {
 	}
 }
 
-void NCSFile::o_cptopbp(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_cptopbp(): Illegal type %d", type);
+void NCSFile::o_cptopbp(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_cptopbp(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE() - 4;
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0] - 4;
+	int16 size   = instr.args[1];
 
 	if ((size % 4) != 0)
 		throw Common::Exception("NCSFile::o_cptopbp(): Illegal size %d", size);
@@ -1454,10 +1693,10 @@ void NCSFile::o_cptopbp(InstructionType type) {
 	}
 }
 
-void NCSFile::o_storestate(InstructionType type) {
-	uint8  offset = (uint8) type;
-	uint32 sizeBP = _script->readUint32BE();
-	uint32 sizeSP = _script->readUint32BE();
+void NCSFile::o_storestate(const Instruction &instr) {
+	uint8  offset = (uint8) instr.type;
+	uint32 sizeBP = (uint32) instr.args[0];
+	uint32 sizeSP = (uint32) instr.args[1];
 
 	if ((sizeBP % 4) != 0)
 		throw Common::Exception("NCSFile::o_storestate(): Illegal BP size %d", sizeBP);
@@ -1467,7 +1706,7 @@ void NCSFile::o_storestate(InstructionType type) {
 	_storedState.setType(kTypeScriptState);
 	ScriptState &state = _storedState.getScriptState();
 
-	state.offset = _script->pos() - 10 + offset;
+	state.offset = instr.address + offset;
 
 	sizeBP /= 4;
 	sizeSP /= 4;
@@ -1479,12 +1718,12 @@ void NCSFile::o_storestate(InstructionType type) {
 		state.locals.push_back(_stack.getRelSP(posSP));
 }
 
-void NCSFile::o_writearray(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_writearray(): Illegal type %d", type);
+void NCSFile::o_writearray(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_writearray(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0];
+	int16 size   = instr.args[1];
 
 	if (size != 4)
 		throw Common::Exception("NCSFile::o_writearray(): Invalid size %d", size);
@@ -1502,12 +1741,12 @@ void NCSFile::o_writearray(InstructionType type) {
 	arrayVar.getArray()[index] = boost::make_shared<Variable>(Variable(valueVar));
 }
 
-void NCSFile::o_readarray(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_readarray(): Illegal type %d", type);
+void NCSFile::o_readarray(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_readarray(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0];
+	int16 size   = instr.args[1];
 
 	if (size != 4)
 		throw Common::Exception("NCSFile::o_readarray(): Invalid size %d", size);
@@ -1524,12 +1763,12 @@ void NCSFile::o_readarray(InstructionType type) {
 	_stack.push(*array[index]);
 }
 
-void NCSFile::o_getref(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_getref(): Illegal type %d", type);
+void NCSFile::o_getref(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_getref(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0];
+	int16 size   = instr.args[1];
 
 	if (size != 4)
 		throw Common::Exception("NCSFile::o_getref(): Invalid size %d", size);
@@ -1540,12 +1779,12 @@ void NCSFile::o_getref(InstructionType type) {
 	_stack.top().setReference(&var);
 }
 
-void NCSFile::o_getrefarray(InstructionType type) {
-	if (type != kInstTypeDirect)
-		throw Common::Exception("NCSFile::o_getrefarray(): Illegal type %d", type);
+void NCSFile::o_getrefarray(const Instruction &instr) {
+	if (instr.type != kInstTypeDirect)
+		throw Common::Exception("NCSFile::o_getrefarray(): Illegal type %d", instr.type);
 
-	int32 offset = _script->readSint32BE();
-	int16 size   = _script->readSint16BE();
+	int32 offset = instr.args[0];
+	int16 size   = instr.args[1];
 
 	if (size != 4)
 		throw Common::Exception("NCSFile::o_getrefarray(): Invalid size %d", size);
@@ -1563,6 +1802,11 @@ void NCSFile::o_getrefarray(InstructionType type) {
 	_stack.top().setReference(&*array[index]);
 }
 
+void NCSFile::o_illegal(const Instruction &instr) {
+	throw Common::Exception("NCSFile::o_illegal(): Illegal instruction 0x%02x at offset %u",
+	                        instr.opcode, instr.address);
+}
+
 } // End of namespace NWScript
 
 } // End of namespace Aurora
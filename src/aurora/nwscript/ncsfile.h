@@ -27,8 +27,13 @@
 
 #include <vector>
 #include <stack>
+#include <map>
+
+#include <boost/shared_ptr.hpp>
 
 #include "src/common/types.h"
+#include "src/common/ustring.h"
+#include "src/common/mutex.h"
 
 #include "src/aurora/types.h"
 #include "src/aurora/aurorafile.h"
@@ -38,7 +43,6 @@
 #include "src/aurora/nwscript/variablecontainer.h"
 
 namespace Common {
-	class UString;
 	class SeekableReadStream;
 }
 
@@ -46,6 +50,12 @@ namespace Aurora {
 
 namespace NWScript {
 
+/** The stack of a running script.
+ *
+ *  The storage of stacks that are destroyed is kept around in a pool and
+ *  handed to new stacks, so that running a script usually doesn't need to
+ *  allocate any memory for the stack.
+ */
 class NCSStack : public std::vector<Variable> {
 public:
 	NCSStack();
@@ -56,7 +66,13 @@ public:
 	bool empty() const;
 
 	Variable &top();
-	Variable pop();
+
+	/** Pop the top variable off the stack.
+	 *
+	 *  The returned reference points into the stack and is only valid
+	 *  until the next push.
+	 */
+	Variable &pop();
 	void push(const Variable &obj);
 
 	Variable &getRelSP(int32 pos);
@@ -74,13 +90,27 @@ public:
 	void print() const;
 
 private:
+	/** The maximum number of stack storages kept in the pool. */
+	static const size_t kMaxPoolSize = 16;
+
+	static Common::Mutex _poolMutex; ///< Guards the storage pool.
+	/** Storage of destroyed stacks, for reuse. */
+	static std::vector< std::vector<Variable> > _pool;
+
 	int32 _stackPtr;
 	int32 _basePtr;
 };
 
-#define DECLARE_OPCODE(x) void x(InstructionType type)
+#define DECLARE_OPCODE(x) void x(const Instruction &instr)
 
-/** An NCS, BioWare's NWN Compile Script. */
+/** An NCS, BioWare's NWN Compile Script.
+ *
+ *  The bytecode of a script is decoded once, into an array of instructions
+ *  with their arguments read and their jump targets resolved. Scripts loaded
+ *  out of the resource manager by name are kept in a cache, so running the
+ *  same script again doesn't need to read or decode it again. The cache is
+ *  dropped whenever the resource manager's index changes.
+ */
 class NCSFile : public AuroraBase {
 public:
 	NCSFile(Common::SeekableReadStream *ncs);
@@ -157,10 +187,82 @@ private:
 		kInstTypeFloatVector            = 60
 	};
 
+	enum OpcodeNumber {
+		kOpcodeCPDOWNSP    = 0x01,
+		kOpcodeCPTOPSP     = 0x03,
+		kOpcodeCONST       = 0x04,
+		kOpcodeACTION      = 0x05,
+		kOpcodeEQ          = 0x0B,
+		kOpcodeNEQ         = 0x0C,
+		kOpcodeMOVSP       = 0x1B,
+		kOpcodeJMP         = 0x1D,
+		kOpcodeJSR         = 0x1E,
+		kOpcodeJZ          = 0x1F,
+		kOpcodeRETN        = 0x20,
+		kOpcodeDESTRUCT    = 0x21,
+		kOpcodeDECSP       = 0x23,
+		kOpcodeINCSP       = 0x24,
+		kOpcodeJNZ         = 0x25,
+		kOpcodeCPDOWNBP    = 0x26,
+		kOpcodeCPTOPBP     = 0x27,
+		kOpcodeDECBP       = 0x28,
+		kOpcodeINCBP       = 0x29,
+		kOpcodeSTORESTATE  = 0x2C,
+		kOpcodeWRITEARRAY  = 0x30,
+		kOpcodeREADARRAY   = 0x32,
+		kOpcodeGETREF      = 0x37,
+		kOpcodeGETREFARRAY = 0x39
+	};
+
+	struct Instruction;
+
+	typedef void (NCSFile::*OpcodeProc)(const Instruction &instr);
+	struct Opcode {
+		OpcodeProc proc;
+		const char *desc;
+	};
+
+	/** A decoded instruction. */
+	struct Instruction {
+		uint32 address;       ///< The offset of the instruction within the NCS file.
+		uint8  opcode;        ///< The opcode.
+		InstructionType type; ///< The type of the instruction.
+		OpcodeProc proc;      ///< The method executing the instruction.
+
+		int32 args[3];  ///< The integer arguments, in the order they appear in the file.
+		float argFloat; ///< The argument of a float constant.
+
+		/** The index of the instruction to jump to, for jumps. */
+		size_t jump;
+
+		Instruction();
+	};
+
+	/** A decoded script. */
+	struct Program {
+		/** All instructions, ordered by address. */
+		std::vector<Instruction> instructions;
+		/** The string arguments of string constants. */
+		std::vector<Common::UString> strings;
+
+		/** Instruction indices by address. */
+		std::map<uint32, size_t> addresses;
+	};
+
+	typedef boost::shared_ptr<const Program> ProgramPtr;
+	typedef std::map<Common::UString, ProgramPtr> ProgramCache;
+
+	static Common::Mutex _programCacheMutex; ///< Guards the program cache.
+	static ProgramCache  _programCache;      ///< All decoded scripts, by name.
+	/** The resource manager generation the program cache is valid for. */
+	static uint32 _programCacheGeneration;
+
 	Common::UString _name;
 
 	NCSStack _stack;
-	Common::SeekableReadStream *_script;
+
+	ProgramPtr _program; ///< The decoded script.
+	size_t     _pc;      ///< The index of the next instruction to execute.
 
 	Variable _return;
 
@@ -169,29 +271,42 @@ private:
 
 	VariableContainer _env;
 
-	std::stack<uint32> _returnOffsets;
+	/** The instruction indices to return to, pushed by JSR. */
+	std::stack<size_t> _returnOffsets;
 
 	Variable _storedState;
 
-	typedef void (NCSFile::*OpcodeProc)(InstructionType type);
-	struct Opcode {
-		OpcodeProc proc;
-		const char *desc;
-	};
 	const Opcode *_opcodes;
 	size_t _opcodeListSize;
 	void setupOpcodes();
 
-	void load();
+	/** Read the script's header and decode it. */
+	void load(Common::SeekableReadStream &ncs, Program &program);
+
+	/** Return the decoded script of this name, out of the cache if possible. */
+	ProgramPtr getProgram(const Common::UString &name);
+
+	/** Read and decode a whole script. */
+	void decode(Common::SeekableReadStream &ncs, Program &program) const;
+	/** Decode the instruction at the current position of the stream.
+	 *
+	 *  @return The address of the instruction following this one, or 0 if
+	 *          execution doesn't continue with the following instruction.
+	 */
+	uint32 decodeInstruction(Common::SeekableReadStream &ncs, Instruction &instr,
+	                         Program &program, std::vector<uint32> &targets) const;
+
+	/** Return the index of the instruction at this address. */
+	size_t findInstruction(uint32 address) const;
+
+	/** Continue execution at the jump target of this instruction. */
+	void jump(const Instruction &instr);
 
 	/** Reset the script for another execution. */
 	void reset();
 
 	const Variable &execute(Object *owner = 0, Object *triggerer = 0);
 
-	/** Execute one script step. */
-	bool executeStep();
-
 	void decompile(); // TODO
 
 	void callEngine(Aurora::NWScript::FunctionContext &ctx, uint32 function, uint8 argCount);
@@ -246,6 +361,8 @@ private:
 	DECLARE_OPCODE(o_readarray);
 	DECLARE_OPCODE(o_getref);
 	DECLARE_OPCODE(o_getrefarray);
+
+	DECLARE_OPCODE(o_illegal);
 };
 
 #undef DECLARE_OPCODE
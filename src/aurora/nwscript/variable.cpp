@@ -22,6 +22,9 @@
  *  NWScript variable.
  */
 
+#include <new>
+#include <algorithm>
+
 #include <boost/make_shared.hpp>
 
 #include "src/common/error.h"
@@ -88,11 +91,30 @@ Variable::~Variable() {
 	setType(kTypeVoid);
 }
 
+bool Variable::isPlain(Type type) {
+	return (type == kTypeVoid) || (type == kTypeInt)   || (type == kTypeFloat) ||
+	       (type == kTypeObject) || (type == kTypeVector) || (type == kTypeReference);
+}
+
+Common::UString &Variable::string() {
+	return *reinterpret_cast<Common::UString *>(_value._string);
+}
+
+const Common::UString &Variable::string() const {
+	return *reinterpret_cast<const Common::UString *>(_value._string);
+}
+
 void Variable::setType(Type type) {
+	// A string staying a string can keep its storage
+	if ((_type == kTypeString) && (type == kTypeString)) {
+		string().clear();
+		return;
+	}
+
 	_array.reset();
 
 	if      (_type == kTypeString)
-		delete _value._string;
+		string().~UString();
 	else if (_type == kTypeEngineType)
 		delete _value._engineType;
 	else if (_type == kTypeScriptState)
@@ -118,7 +140,7 @@ void Variable::setType(Type type) {
 			break;
 
 		case kTypeString:
-			_value._string = new Common::UString;
+			new (_value._string) Common::UString;
 			break;
 
 		case kTypeObject:
@@ -153,10 +175,18 @@ Variable &Variable::operator=(const Variable &var) {
 	if (&var == this)
 		return *this;
 
+	// Fast path for variables that are just their value
+	if (isPlain(_type) && isPlain(var._type)) {
+		_type  = var._type;
+		_value = var._value;
+
+		return *this;
+	}
+
 	setType(var._type);
 
 	if      (_type == kTypeString)
-		*_value._string = *var._value._string;
+		string() = var.string();
 	else if (_type == kTypeEngineType)
 		*this = var._value._engineType;
 	else if (_type == kTypeScriptState)
@@ -169,6 +199,39 @@ Variable &Variable::operator=(const Variable &var) {
 	return *this;
 }
 
+void Variable::swap(Variable &var) {
+	if (&var == this)
+		return;
+
+	if ((_type == kTypeString) && (var._type == kTypeString)) {
+		string().swap(var.string());
+		return;
+	}
+
+	if ((_type == kTypeString) || (var._type == kTypeString)) {
+		// The string has to be moved into the other variable's storage
+		Variable &str   = (_type == kTypeString) ? *this : var;
+		Variable &other = (_type == kTypeString) ? var   : *this;
+
+		Common::UString tmp;
+		tmp.swap(str.string());
+		str.string().~UString();
+
+		str._type  = other._type;
+		str._value = other._value;
+		str._array.swap(other._array);
+
+		other._type = kTypeString;
+		new (other._value._string) Common::UString;
+		other.string().swap(tmp);
+		return;
+	}
+
+	std::swap(_type , var._type);
+	std::swap(_value, var._value);
+	_array.swap(var._array);
+}
+
 Variable &Variable::operator=(int32 value) {
 	if (_type != kTypeInt)
 		throw Common::Exception("Can't assign an int value to a non-int variable");
@@ -191,7 +254,7 @@ Variable &Variable::operator=(const Common::UString &value) {
 	if (_type != kTypeString)
 		throw Common::Exception("Can't assign a string value to a non-string variable");
 
-	*_value._string = value;
+	string() = value;
 
 	return *this;
 }
@@ -242,7 +305,7 @@ bool Variable::operator==(const Variable &var) const {
 			return _value._float == var._value._float;
 
 		case kTypeString:
-			return *_value._string == *var._value._string;
+			return string() == var.string();
 
 		case kTypeObject:
 			return _value._object == var._value._object;
@@ -288,14 +351,14 @@ const Common::UString &Variable::getString() const {
 	if (_type != kTypeString)
 		throw Common::Exception("Can't get a string value from a non-string variable");
 
-	return *_value._string;
+	return string();
 }
 
 Common::UString &Variable::getString() {
 	if (_type != kTypeString)
 		throw Common::Exception("Can't get a string value from a non-string variable");
 
-	return *_value._string;
+	return string();
 }
 
 Object *Variable::getObject() const {
@@ -30,15 +30,12 @@
 #include <boost/shared_ptr.hpp>
 
 #include "src/common/types.h"
+#include "src/common/ustring.h"
 
 #include "src/aurora/types.h"
 
 #include "src/aurora/nwscript/types.h"
 
-namespace Common {
-	class UString;
-}
-
 namespace Aurora {
 
 namespace NWScript {
@@ -52,6 +49,11 @@ struct ScriptState {
 	std::vector<class Variable> locals;
 };
 
+/** A variable in a script.
+ *
+ *  Strings are held directly inside the variable, so that an int, float,
+ *  object or (short) string variable doesn't need any heap allocations.
+ */
 class Variable {
 public:
 	typedef std::vector< boost::shared_ptr<Variable> > Array;
@@ -71,6 +73,9 @@ public:
 
 	Variable &operator=(const Variable &var);
 
+	/** Exchange the contents of two variables, without copying them. */
+	void swap(Variable &var);
+
 	Variable &operator=(int32 value);
 	Variable &operator=(float value);
 	Variable &operator=(const Common::UString &value);
@@ -109,10 +114,10 @@ public:
 private:
 	Type _type;
 
-	union {
+	union Value {
 		int32 _int;
 		float _float;
-		Common::UString *_string;
+		byte _string[sizeof(Common::UString)]; ///< Storage for a UString, constructed in place.
 		Object *_object;
 		float _vector[3];
 		ScriptState *_scriptState;
@@ -121,6 +126,12 @@ private:
 	} _value;
 
 	boost::shared_ptr<Array> _array;
+
+	/** Is this a type that needs no other storage besides the value itself? */
+	static bool isPlain(Type type);
+
+	Common::UString &string();
+	const Common::UString &string() const;
 };
 
 } // End of namespace NWScript
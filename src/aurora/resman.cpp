@@ -23,16 +23,28 @@
  */
 
 #include <cassert>
+#include <cstring>
+
+#include <algorithm>
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "src/common/util.h"
 #include "src/common/error.h"
+#include "src/common/debug.h"
+#include "src/common/debugman.h"
+#include "src/common/threadpool.h"
 #include "src/common/readstream.h"
 #include "src/common/filepath.h"
 #include "src/common/readfile.h"
+#include "src/common/mappedfile.h"
 #include "src/common/writefile.h"
+#include "src/common/encoding.h"
 
 #include "src/aurora/resman.h"
 #include "src/aurora/util.h"
+#include "src/aurora/language.h"
 
 #include "src/aurora/keyfile.h"
 #include "src/aurora/biffile.h"
@@ -48,10 +60,35 @@
 // Check for hash collisions (if possible)
 #define CHECK_HASH_COLLISION 1
 
+static const uint32 kIndexCacheID      = MKTAG('X', 'I', 'D', 'X');
+static const uint32 kIndexCacheVersion = MKTAG('V', '1', '.', '0');
+
 DECLARE_SINGLETON(Aurora::ResourceManager)
 
 namespace Aurora {
 
+/** Return the number of seconds passed since this point in time. */
+static double getSecondsSince(const boost::posix_time::ptime &start) {
+	const boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+
+	return (now - start).total_microseconds() / 1000000.0;
+}
+
+static Common::UString readCacheString(Common::SeekableReadStream &stream) {
+	const uint32 length = stream.readUint32LE();
+	if (length > (stream.size() - stream.pos()))
+		throw Common::Exception(Common::kReadError);
+
+	return Common::readStringFixed(stream, Common::kEncodingUTF8, length);
+}
+
+static void writeCacheString(Common::WriteStream &stream, const Common::UString &string) {
+	const uint32 length = std::strlen(string.c_str());
+
+	stream.writeUint32LE(length);
+	stream.write(string.c_str(), length);
+}
+
 ResourceManager::KnownArchive::KnownArchive() :
 	type(kArchiveMAX), resource(0), opened(0) {
 
@@ -66,8 +103,29 @@ ResourceManager::KnownArchive::KnownArchive(ArchiveType t, const Common::UString
 ResourceManager::OpenedArchive::OpenedArchive() : archive(0), known(0), parent(0) {
 }
 
-void ResourceManager::OpenedArchive::set(KnownArchive &kA, Archive &a) {
-	archive = &a;
+ResourceManager::PendingArchive::PendingArchive() : known(0), stream(0), password(0),
+	key(0), keyIndex(0), archive(0), cached(0), failed(false) {
+
+}
+
+ResourceManager::CachedArchive::CachedArchive() : size(0), time(0), hashAlgo(Common::kHashNone) {
+}
+
+void ResourceManager::CachedArchive::swap(CachedArchive &cached) {
+	name.swap(cached.name);
+	path.swap(cached.path);
+
+	std::swap(size, cached.size);
+	std::swap(time, cached.time);
+	std::swap(hashAlgo, cached.hashAlgo);
+
+	resources.swap(cached.resources);
+	bifs.swap(cached.bifs);
+}
+
+
+void ResourceManager::OpenedArchive::set(KnownArchive &kA, Archive *a) {
+	archive = a;
 	known   = &kA;
 
 	if (known->opened)
@@ -101,8 +159,164 @@ bool ResourceManager::Resource::operator<(const Resource &right) const {
 }
 
 
+ResourceManager::ResourceMap::Slot::Slot() : hash(0) {
+}
+
+ResourceManager::ResourceMap::ResourceMap() : _size(0), _mask(0) {
+}
+
+void ResourceManager::ResourceMap::clear() {
+	std::vector<Slot>().swap(_slots);
+
+	_size = 0;
+	_mask = 0;
+}
+
+bool ResourceManager::ResourceMap::empty() const {
+	return _size == 0;
+}
+
+size_t ResourceManager::ResourceMap::size() const {
+	return _size;
+}
+
+size_t ResourceManager::ResourceMap::getHome(uint64 hash) const {
+	/* Fibonacci hashing. Some of the hash algorithms we use only produce
+	 * 32 bits, so we need to properly spread those over the whole table. */
+
+	return (size_t) ((hash * 0x9E3779B97F4A7C15ULL) >> 32) & _mask;
+}
+
+size_t ResourceManager::ResourceMap::findSlot(uint64 hash) const {
+	assert(!_slots.empty());
+
+	size_t i = getHome(hash);
+	while (!_slots[i].resources.empty() && (_slots[i].hash != hash))
+		i = (i + 1) & _mask;
+
+	return i;
+}
+
+const ResourceManager::ResourceCandidates *ResourceManager::ResourceMap::find(uint64 hash) const {
+	if (_size == 0)
+		return 0;
+
+	const Slot &slot = _slots[findSlot(hash)];
+	if (slot.resources.empty())
+		return 0;
+
+	return &slot.resources;
+}
+
+ResourceManager::ResourceCandidates *ResourceManager::ResourceMap::find(uint64 hash) {
+	if (_size == 0)
+		return 0;
+
+	Slot &slot = _slots[findSlot(hash)];
+	if (slot.resources.empty())
+		return 0;
+
+	return &slot.resources;
+}
+
+void ResourceManager::ResourceMap::insert(uint64 hash, Resource *resource) {
+	// Keep the load factor at or below 3/4
+	if (((_size + 1) * 4) > (_slots.size() * 3))
+		grow();
+
+	Slot &slot = _slots[findSlot(hash)];
+	if (slot.resources.empty()) {
+		slot.hash = hash;
+		_size++;
+	}
+
+	/* Keep the candidates sorted by priority. Among resources with the
+	 * same priority, the one added last wins, so it goes last. */
+
+	ResourceCandidates::iterator pos = slot.resources.end();
+	while ((pos != slot.resources.begin()) && (*resource < **(pos - 1)))
+		--pos;
+
+	slot.resources.insert(pos, resource);
+}
+
+void ResourceManager::ResourceMap::erase(uint64 hash, Resource *resource) {
+	if (_size == 0)
+		return;
+
+	size_t i = findSlot(hash);
+
+	ResourceCandidates &resources = _slots[i].resources;
+
+	ResourceCandidates::iterator res = std::find(resources.begin(), resources.end(), resource);
+	if (res == resources.end())
+		return;
+
+	resources.erase(res);
+	if (!resources.empty())
+		return;
+
+	// That was the last candidate, so the slot is now free
+
+	ResourceCandidates().swap(resources);
+	_size--;
+
+	/* Backward-shift deletion: move every following entry of this run
+	 * that would be reachable from the now empty slot into it. */
+
+	size_t j = i;
+	while (true) {
+		j = (j + 1) & _mask;
+		if (_slots[j].resources.empty())
+			break;
+
+		const size_t home = getHome(_slots[j].hash);
+
+		// Is the home of slot j cyclically within (i, j]? Then it has to stay
+		if ((i <= j) ? ((i < home) && (home <= j)) : ((i < home) || (home <= j)))
+			continue;
+
+		_slots[i].hash = _slots[j].hash;
+		_slots[i].resources.swap(_slots[j].resources);
+
+		i = j;
+	}
+}
+
+void ResourceManager::ResourceMap::getHashes(std::vector<uint64> &hashes) const {
+	hashes.reserve(hashes.size() + _size);
+
+	for (std::vector<Slot>::const_iterator s = _slots.begin(); s != _slots.end(); ++s)
+		if (!s->resources.empty())
+			hashes.push_back(s->hash);
+
+	std::sort(hashes.begin(), hashes.end());
+}
+
+void ResourceManager::ResourceMap::grow() {
+	std::vector<Slot> oldSlots;
+	oldSlots.swap(_slots);
+
+	const size_t newSize = oldSlots.empty() ? 1024 : (oldSlots.size() * 2);
+
+	_slots.resize(newSize);
+	_mask = newSize - 1;
+
+	for (std::vector<Slot>::iterator s = oldSlots.begin(); s != oldSlots.end(); ++s) {
+		if (s->resources.empty())
+			continue;
+
+		Slot &slot = _slots[findSlot(s->hash)];
+
+		slot.hash = s->hash;
+		slot.resources.swap(s->resources);
+	}
+}
+
+
 ResourceManager::ResourceManager() : _hasSmall(false),
-	_hashAlgo(Common::kHashFNV64) {
+	_hashAlgo(Common::kHashFNV64), _indexThreads(0), _indexCacheDirty(false),
+	_generation(0) {
 
 	// These file types are archives
 
@@ -165,15 +379,22 @@ ResourceManager::ResourceManager() : _hasSmall(false),
 }
 
 ResourceManager::~ResourceManager() {
+	clearIndexCache();
 	clearResources();
 }
 
 void ResourceManager::clear() {
+	Common::StackLock lock(_mutex);
+
+	clearIndexCache();
+
 	_typeAliases.clear();
 
 	_hasSmall = false;
 	_hashAlgo = Common::kHashFNV64;
 
+	_indexThreads = 0;
+
 	setRIMsAreERFs(false);
 	clearResources();
 }
@@ -192,11 +413,16 @@ void ResourceManager::clearResources() {
 	_openedArchives.clear();
 
 	_resources.clear();
+	_resourceList.clear();
 
 	_changes.clear();
+
+	_generation++;
 }
 
 void ResourceManager::setRIMsAreERFs(bool rimsAreERFs) {
+	Common::StackLock lock(_mutex);
+
 	// Treat RIM and RIMP as either RIM or ERF
 
 	_archiveTypeTypes[kArchiveRIM].erase(kFileTypeRIM);
@@ -214,21 +440,295 @@ void ResourceManager::setRIMsAreERFs(bool rimsAreERFs) {
 }
 
 void ResourceManager::setHasSmall(bool hasSmall) {
+	Common::StackLock lock(_mutex);
+
 	_hasSmall = hasSmall;
+
+	_generation++;
 }
 
 void ResourceManager::setHashAlgo(Common::HashAlgo algo) {
+	Common::StackLock lock(_mutex);
+
 	if ((algo != _hashAlgo) && !_resources.empty())
 		throw Common::Exception("ResourceManager::setHashAlgo(): We already have resources!");
 
 	_hashAlgo = algo;
 }
 
+void ResourceManager::setIndexThreads(size_t threads) {
+	Common::StackLock lock(_mutex);
+
+	_indexThreads = threads;
+}
+
+void ResourceManager::setIndexCache(const Common::UString &file) {
+	Common::StackLock lock(_mutex);
+
+	clearIndexCache();
+
+	_indexCacheFile = file;
+
+	try {
+		loadIndexCache();
+	} catch (Common::Exception &e) {
+		e.add("Failed to read the index cache \"%s\"", _indexCacheFile.c_str());
+		Common::printException(e, "WARNING: ");
+
+		_indexCache.clear();
+	}
+}
+
+void ResourceManager::saveIndexCache() {
+	Common::StackLock lock(_mutex);
+
+	if (_indexCacheFile.empty() || !_indexCacheDirty)
+		return;
+
+	Common::FilePath::createDirectories(Common::FilePath::getDirectory(_indexCacheFile));
+
+	Common::WriteFile file(_indexCacheFile);
+
+	file.writeUint32BE(kIndexCacheID);
+	file.writeUint32BE(kIndexCacheVersion);
+
+	file.writeUint32LE(_indexCache.size());
+	for (IndexCache::const_iterator c = _indexCache.begin(); c != _indexCache.end(); ++c)
+		writeCachedArchive(file, c->second);
+
+	file.flush();
+	file.close();
+
+	_indexCacheDirty = false;
+
+	debugC(1, Common::kDebugResources, "Wrote %u archives to the index cache \"%s\"",
+	       (uint) _indexCache.size(), _indexCacheFile.c_str());
+}
+
+void ResourceManager::loadIndexCache() {
+	_indexCache.clear();
+	_indexCacheDirty = false;
+
+	if (_indexCacheFile.empty() || !Common::FilePath::isRegularFile(_indexCacheFile))
+		return;
+
+	Common::SeekableReadStream *cache = 0;
+	{
+		Common::ReadFile file(_indexCacheFile);
+		cache = file.readStream(file.size());
+	}
+
+	try {
+		const uint32 id      = cache->readUint32BE();
+		const uint32 version = cache->readUint32BE();
+
+		if ((id != kIndexCacheID) || (version != kIndexCacheVersion)) {
+			// An index cache of a different version, we just replace it
+			delete cache;
+
+			_indexCacheDirty = true;
+			return;
+		}
+
+		const uint32 count = cache->readUint32LE();
+		for (uint32 i = 0; i < count; i++) {
+			CachedArchive cached;
+			readCachedArchive(*cache, cached);
+
+			// Forget about archives that vanished
+			if (!Common::FilePath::isRegularFile(cached.path)) {
+				_indexCacheDirty = true;
+				continue;
+			}
+
+			_indexCache[cached.path].swap(cached);
+		}
+
+	} catch (...) {
+		delete cache;
+		throw;
+	}
+
+	delete cache;
+
+	debugC(1, Common::kDebugResources, "Read %u archives from the index cache \"%s\"",
+	       (uint) _indexCache.size(), _indexCacheFile.c_str());
+}
+
+void ResourceManager::clearIndexCache() {
+	try {
+		saveIndexCache();
+	} catch (Common::Exception &e) {
+		e.add("Failed to write the index cache \"%s\"", _indexCacheFile.c_str());
+		Common::printException(e, "WARNING: ");
+	}
+
+	_indexCacheFile.clear();
+	_indexCache.clear();
+
+	_indexCacheDirty = false;
+}
+
+void ResourceManager::readCachedArchive(Common::SeekableReadStream &stream, CachedArchive &cached) {
+	cached.name = readCacheString(stream);
+	cached.path = readCacheString(stream);
+
+	cached.size     = stream.readUint64LE();
+	cached.time     = stream.readUint64LE();
+	cached.hashAlgo = (Common::HashAlgo) stream.readUint32LE();
+
+	const uint32 resourceCount = stream.readUint32LE();
+	if (resourceCount > (stream.size() - stream.pos()))
+		throw Common::Exception(Common::kReadError);
+
+	for (uint32 i = 0; i < resourceCount; i++) {
+		cached.resources.push_back(Archive::Resource());
+		Archive::Resource &resource = cached.resources.back();
+
+		resource.name  = readCacheString(stream);
+		resource.type  = (FileType) stream.readUint32LE();
+		resource.hash  = stream.readUint64LE();
+		resource.index = stream.readUint32LE();
+	}
+
+	const uint32 bifCount = stream.readUint32LE();
+	if (bifCount > (stream.size() - stream.pos()))
+		throw Common::Exception(Common::kReadError);
+
+	cached.bifs.resize(bifCount);
+	for (std::vector<CachedArchive>::iterator b = cached.bifs.begin(); b != cached.bifs.end(); ++b)
+		readCachedArchive(stream, *b);
+}
+
+void ResourceManager::writeCachedArchive(Common::WriteStream &stream, const CachedArchive &cached) {
+	writeCacheString(stream, cached.name);
+	writeCacheString(stream, cached.path);
+
+	stream.writeUint64LE(cached.size);
+	stream.writeUint64LE(cached.time);
+	stream.writeUint32LE((uint32) cached.hashAlgo);
+
+	stream.writeUint32LE(cached.resources.size());
+	for (Archive::ResourceList::const_iterator r = cached.resources.begin(); r != cached.resources.end(); ++r) {
+		writeCacheString(stream, r->name);
+		stream.writeUint32LE((uint32) r->type);
+		stream.writeUint64LE(r->hash);
+		stream.writeUint32LE(r->index);
+	}
+
+	stream.writeUint32LE(cached.bifs.size());
+	for (std::vector<CachedArchive>::const_iterator b = cached.bifs.begin(); b != cached.bifs.end(); ++b)
+		writeCachedArchive(stream, *b);
+}
+
+bool ResourceManager::initCachedArchive(CachedArchive &cached, const KnownArchive &archive) const {
+	/* We can only cache archives that are files on their own. And we don't cache
+	 * executables, since the names of their resources depend on the cursor remap. */
+	if ((archive.resource->source != kSourceFile) || (archive.type == kArchiveEXE))
+		return false;
+
+	cached.name = archive.name;
+	cached.path = archive.resource->path;
+
+	cached.size = Common::FilePath::getFileSize(cached.path);
+	cached.time = Common::FilePath::getModificationTime(cached.path);
+
+	return (cached.size != Common::kFileInvalid) && (cached.time != 0);
+}
+
+bool ResourceManager::isCachedArchiveValid(const CachedArchive &cached, const KnownArchive &archive) const {
+	CachedArchive current;
+	if (!initCachedArchive(current, archive))
+		return false;
+
+	return (current.path == cached.path) && (current.size == cached.size) && (current.time == cached.time);
+}
+
+const ResourceManager::CachedArchive *ResourceManager::getCachedArchive(const KnownArchive &archive) {
+	if (_indexCacheFile.empty() || (archive.resource->source != kSourceFile))
+		return 0;
+
+	IndexCache::const_iterator cached = _indexCache.find(archive.resource->path);
+	if ((cached == _indexCache.end()) || !isCachedArchiveValid(cached->second, archive))
+		return 0;
+
+	// For a KEY, all the BIFs need to be unchanged as well
+	for (std::vector<CachedArchive>::const_iterator b = cached->second.bifs.begin();
+	     b != cached->second.bifs.end(); ++b) {
+
+		const KnownArchive *bif = findArchive(b->name, _knownArchives[kArchiveBIF]);
+		if (!bif || !isCachedArchiveValid(*b, *bif))
+			return 0;
+	}
+
+	return &cached->second;
+}
+
+void ResourceManager::indexCachedArchive(KnownArchive &archive, const CachedArchive &cached,
+                                         uint32 priority, Change *change) {
+
+	// The archives themselves are only opened once we need a resource out of them
+
+	if (archive.type != kArchiveKEY) {
+		indexArchive(archive, 0, cached.resources, cached.hashAlgo, priority, change);
+		return;
+	}
+
+	for (std::vector<CachedArchive>::const_iterator b = cached.bifs.begin(); b != cached.bifs.end(); ++b) {
+		KnownArchive *bif = findArchive(b->name, _knownArchives[kArchiveBIF]);
+		assert(bif);
+
+		indexArchive(*bif, 0, b->resources, b->hashAlgo, priority, change);
+	}
+}
+
+void ResourceManager::addCachedArchive(const KnownArchive &knownArchive, const Archive &archive) {
+	if (_indexCacheFile.empty())
+		return;
+
+	CachedArchive cached;
+	if (!initCachedArchive(cached, knownArchive))
+		return;
+
+	cached.hashAlgo  = archive.getNameHashAlgo();
+	cached.resources = archive.getResources();
+
+	_indexCache[cached.path].swap(cached);
+	_indexCacheDirty = true;
+}
+
+void ResourceManager::addCachedKEY(const KnownArchive &key, const std::vector<KnownArchive *> &bifs,
+                                   const std::vector<BIFFile *> &bifFiles) {
+
+	if (_indexCacheFile.empty())
+		return;
+
+	CachedArchive cached;
+	if (!initCachedArchive(cached, key))
+		return;
+
+	cached.bifs.resize(bifs.size());
+	for (size_t i = 0; i < bifs.size(); i++) {
+		if (!initCachedArchive(cached.bifs[i], *bifs[i]))
+			return;
+
+		cached.bifs[i].hashAlgo  = bifFiles[i]->getNameHashAlgo();
+		cached.bifs[i].resources = bifFiles[i]->getResources();
+	}
+
+	_indexCache[cached.path].swap(cached);
+	_indexCacheDirty = true;
+}
+
 void ResourceManager::setCursorRemap(const std::vector<Common::UString> &remap) {
+	Common::StackLock lock(_mutex);
+
 	_cursorRemap = remap;
 }
 
 void ResourceManager::registerDataBase(const Common::UString &path) {
+	Common::StackLock lock(_mutex);
+
 	clearResources();
 
 	Common::UString base = Common::FilePath::canonicalize(path);
@@ -278,6 +778,8 @@ ResourceManager::KnownArchive *ResourceManager::findArchive(Common::UString file
 }
 
 bool ResourceManager::hasArchive(const Common::UString &file) {
+	Common::StackLock lock(_mutex);
+
 	return findArchive(file) != 0;
 }
 
@@ -285,12 +787,149 @@ Common::SeekableReadStream *ResourceManager::openArchiveStream(const KnownArchiv
 	if (!archive.resource)
 		throw Common::Exception("Archive without resource reference");
 
-	return getResource(*archive.resource, true);
+	/* If the archive is a plain file, try to map it into memory. The archive
+	 * classes can then hand out resources as views into the mapping, without
+	 * any reading or copying. Since we keep all archives of a game open, we
+	 * only do that where we have enough address space to spare. */
+	const Resource &res = *archive.resource;
+	const bool tryMapping = sizeof(void *) >= 8;
+
+	return getResource(res, tryMapping || (res.source != kSourceFile));
+}
+
+Archive *ResourceManager::openArchive(ArchiveType type, Common::SeekableReadStream *stream,
+                                      const std::vector<byte> &password) const {
+
+	switch (type) {
+		case kArchiveNDS:
+			return new NDSFile(stream);
+
+		case kArchiveHERF:
+			return new HERFFile(stream);
+
+		case kArchiveERF:
+			return new ERFFile(stream, password);
+
+		case kArchiveRIM:
+			return new RIMFile(stream);
+
+		case kArchiveZIP:
+			return new ZIPFile(stream);
+
+		case kArchiveEXE:
+			return new PEFile(stream, _cursorRemap);
+
+		case kArchiveNSBTX:
+			return new NSBTXFile(stream);
+
+		default:
+			break;
+	}
+
+	delete stream;
+	throw Common::Exception("Invalid archive type %d", type);
+}
+
+void ResourceManager::openPendingArchive(PendingArchive &pending) const {
+	/* This might run in a worker thread, so we may only touch the pending
+	 * archive itself, and read what doesn't change while indexing. */
+
+	try {
+		// The archive takes over the stream, even if it throws
+		Common::SeekableReadStream *stream = pending.stream;
+		pending.stream = 0;
+
+		if (pending.key) {
+			BIFFile *bif = new BIFFile(stream);
+			pending.archive = bif;
+
+			bif->mergeKEY(*pending.key, pending.keyIndex);
+		} else
+			pending.archive = openArchive(pending.known->type, stream, *pending.password);
+
+	} catch (Common::Exception &e) {
+		pending.failed = true;
+		pending.error  = e;
+	} catch (std::exception &e) {
+		pending.failed = true;
+		pending.error  = Common::Exception(e);
+	} catch (...) {
+		pending.failed = true;
+		pending.error  = Common::Exception("Unknown error opening archive \"%s\"",
+		                                   pending.known->name.c_str());
+	}
+}
+
+void ResourceManager::openPendingArchives(PendingArchives &pending) const {
+	/* Archives found inside other archives are read out of the parent's stream,
+	 * which can't be shared between threads. Only direct files go in parallel. */
+
+	std::vector<PendingArchive *> parallel;
+	for (PendingArchives::iterator p = pending.begin(); p != pending.end(); ++p) {
+		// Nothing to open here
+		if (!p->stream)
+			continue;
+
+		if (p->known->resource->source == kSourceFile)
+			parallel.push_back(&*p);
+		else
+			openPendingArchive(*p);
+	}
+
+	size_t threads = (_indexThreads > 0) ? _indexThreads : Common::ThreadPool::getCPUCount();
+	threads = MIN(threads, parallel.size());
+
+	if (threads <= 1) {
+		for (std::vector<PendingArchive *>::iterator p = parallel.begin(); p != parallel.end(); ++p)
+			openPendingArchive(**p);
+
+		return;
+	}
+
+	/* Archives might convert strings while loading, for example ERF descriptions.
+	 * The singletons involved need to exist before the workers start. */
+	Common::initEncodings();
+	LangMan;
+
+	Common::ThreadPool pool(threads);
+
+	for (std::vector<PendingArchive *>::iterator p = parallel.begin(); p != parallel.end(); ++p)
+		pool.addJob(boost::bind(&ResourceManager::openPendingArchive, this, boost::ref(**p)));
+
+	pool.wait();
+}
+
+void ResourceManager::closePendingArchives(PendingArchives &pending) const {
+	for (PendingArchives::iterator p = pending.begin(); p != pending.end(); ++p) {
+		delete p->stream;
+		delete p->archive;
+
+		p->stream  = 0;
+		p->archive = 0;
+	}
+}
+
+Archive *ResourceManager::getArchive(OpenedArchive &archive) const {
+	if (archive.archive)
+		return archive.archive;
+
+	// This archive was indexed out of the index cache. Open it now
+
+	Common::SeekableReadStream *stream = openArchiveStream(*archive.known);
+
+	if (archive.known->type == kArchiveBIF)
+		archive.archive = new BIFFile(stream);
+	else
+		archive.archive = openArchive(archive.known->type, stream, std::vector<byte>());
+
+	return archive.archive;
 }
 
 void ResourceManager::indexArchive(const Common::UString &file, uint32 priority,
                                    const std::vector<byte> &password, Common::ChangeID *changeID) {
 
+	Common::StackLock lock(_mutex);
+
 	KnownArchive *knownArchive = findArchive(file);
 	if (!knownArchive)
 		throw Common::Exception("No such archive file \"%s\"", file.c_str());
@@ -302,111 +941,193 @@ void ResourceManager::indexArchive(const Common::UString &file, uint32 priority,
 	if (changeID)
 		change = newChangeSet(*changeID);
 
-	Archive *archive = 0;
+	// Encrypted archives are never cached
+	if (password.empty()) {
+		const CachedArchive *cached = getCachedArchive(*knownArchive);
+		if (cached) {
+			indexCachedArchive(*knownArchive, *cached, priority, change);
+			return;
+		}
+	}
+
+	Common::SeekableReadStream *archiveStream = openArchiveStream(*knownArchive);
+
+	if (knownArchive->type == kArchiveKEY) {
+		indexKEY(*knownArchive, archiveStream, priority, change);
+		return;
+	}
+
+	Archive *archive = openArchive(knownArchive->type, archiveStream, password);
+
 	try {
-		Common::SeekableReadStream *archiveStream = openArchiveStream(*knownArchive);
+		indexArchive(*knownArchive, archive, priority, change);
+	} catch (...) {
+		delete archive;
+		throw;
+	}
+
+	if (password.empty())
+		addCachedArchive(*knownArchive, *archive);
+}
+
+void ResourceManager::indexArchive(const Common::UString &file, uint32 priority, Common::ChangeID *changeID) {
+	std::vector<byte> password;
+
+	indexArchive(file, priority, password, changeID);
+}
 
-		switch (knownArchive->type) {
-			case kArchiveKEY:
-				indexKEY(archiveStream, priority, change);
-				break;
+void ResourceManager::indexArchives(const std::vector<Common::UString> &files, uint32 priority,
+                                    Common::ChangeID *changeID) {
 
-			case kArchiveNDS:
-				archive = new NDSFile(archiveStream);
-				break;
+	Common::StackLock lock(_mutex);
 
-			case kArchiveHERF:
-				archive = new HERFFile(archiveStream);
-				break;
+	const boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::universal_time();
 
-			case kArchiveERF:
-				archive = new ERFFile(archiveStream, password);
-				break;
+	PendingArchives pending(files.size());
+	for (size_t i = 0; i < files.size(); i++) {
+		pending[i].known = findArchive(files[i]);
+		if (!pending[i].known)
+			throw Common::Exception("No such archive file \"%s\"", files[i].c_str());
 
-			case kArchiveRIM:
-				archive = new RIMFile(archiveStream);
-				break;
+		if (pending[i].known->type == kArchiveBIF)
+			throw Common::Exception("Attempted to index a lone BIF");
+	}
 
-			case kArchiveZIP:
-				archive = new ZIPFile(archiveStream);
-				break;
+	Change *change = 0;
+	if (changeID)
+		change = newChangeSet(*changeID);
 
-			case kArchiveEXE:
-				archive = new PEFile(archiveStream, _cursorRemap);
-				break;
+	const std::vector<byte> password;
 
-			case kArchiveNSBTX:
-				archive = new NSBTXFile(archiveStream);
-				break;
+	try {
+		// Reading the archive data is done here, since it might come out of another archive
+		for (PendingArchives::iterator p = pending.begin(); p != pending.end(); ++p) {
+			p->password = &password;
 
-			default:
-				throw Common::Exception("Invalid archive type %d", knownArchive->type);
+			p->cached = getCachedArchive(*p->known);
+			if (!p->cached && (p->known->type != kArchiveKEY))
+				p->stream = openArchiveStream(*p->known);
 		}
 
-		if (archive)
-			indexArchive(*knownArchive, archive, priority, change);
+		openPendingArchives(pending);
+
+		// Add the resources in order, so that the result doesn't depend on the timing
+		for (size_t i = 0; i < pending.size(); i++) {
+			if (pending[i].cached) {
+				indexCachedArchive(*pending[i].known, *pending[i].cached, priority + i, change);
+				continue;
+			}
+
+			if (pending[i].known->type == kArchiveKEY) {
+				indexKEY(*pending[i].known, openArchiveStream(*pending[i].known), priority + i, change);
+				continue;
+			}
+
+			if (pending[i].failed)
+				throw pending[i].error;
+
+			Archive *archive = pending[i].archive;
+
+			indexArchive(*pending[i].known, archive, priority + i, change);
+			pending[i].archive = 0;
+
+			addCachedArchive(*pending[i].known, *archive);
+		}
 
 	} catch (...) {
-		delete archive;
+		closePendingArchives(pending);
 		throw;
 	}
-}
 
-void ResourceManager::indexArchive(const Common::UString &file, uint32 priority, Common::ChangeID *changeID) {
-	std::vector<byte> password;
-
-	indexArchive(file, priority, password, changeID);
+	debugC(1, Common::kDebugResources, "Indexed %u archives in %.3fs",
+	       (uint) files.size(), getSecondsSince(startTime));
 }
 
 uint32 ResourceManager::openKEYBIFs(Common::SeekableReadStream *keyStream,
                                     std::vector<KnownArchive *> &archives,
                                     std::vector<BIFFile *> &bifs) {
+	PendingArchives pending;
+
 	try {
 
 		KEYFile key(*keyStream);
 
 		const KEYFile::BIFList &keyBIFs = key.getBIFs();
-		archives.resize(keyBIFs.size(), 0);
-		bifs.resize(keyBIFs.size(), 0);
+		pending.resize(keyBIFs.size());
 
 		for (uint32 i = 0; i < keyBIFs.size(); i++) {
-			archives[i] = findArchive(keyBIFs[i], _knownArchives[kArchiveBIF]);
-			if (!archives[i])
+			pending[i].known = findArchive(keyBIFs[i], _knownArchives[kArchiveBIF]);
+			if (!pending[i].known)
 				throw Common::Exception("BIF \"%s\" not found", keyBIFs[i].c_str());
 
-			bifs[i] = new BIFFile(openArchiveStream(*archives[i]));
-			bifs[i]->mergeKEY(key, i);
+			pending[i].key      = &key;
+			pending[i].keyIndex = i;
+			pending[i].stream   = openArchiveStream(*pending[i].known);
 		}
 
+		// Parse the BIFs and merge the KEY information into them
+		openPendingArchives(pending);
+
+		for (PendingArchives::iterator p = pending.begin(); p != pending.end(); ++p)
+			if (p->failed)
+				throw p->error;
+
 	} catch (...) {
 		delete keyStream;
 
-		for (std::vector<BIFFile *>::iterator b = bifs.begin(); b != bifs.end(); ++b)
-			delete *b;
-
-		bifs.clear();
-		archives.clear();
+		closePendingArchives(pending);
 		throw;
 	}
 
 	delete keyStream;
+
+	archives.resize(pending.size(), 0);
+	bifs.resize(pending.size(), 0);
+
+	for (size_t i = 0; i < pending.size(); i++) {
+		archives[i] = pending[i].known;
+		bifs[i]     = static_cast<BIFFile *>(pending[i].archive);
+	}
+
 	return archives.size();
 }
 
-void ResourceManager::indexKEY(Common::SeekableReadStream *stream, uint32 priority, Change *change) {
+void ResourceManager::indexKEY(KnownArchive &key, Common::SeekableReadStream *stream,
+                               uint32 priority, Change *change) {
+
+	const boost::posix_time::ptime startTime = boost::posix_time::microsec_clock::universal_time();
+
 	std::vector<KnownArchive *> archives;
 	std::vector<BIFFile *> bifs;
 
 	const uint32 count = openKEYBIFs(stream, archives, bifs);
 
-	for (uint32 i = 0; i < count; i++)
-		indexArchive(*archives[i], bifs[i], priority, change);
+	for (uint32 i = 0; i < count; i++) {
+		try {
+			indexArchive(*archives[i], bifs[i], priority, change);
+		} catch (...) {
+			for (uint32 j = i; j < count; j++)
+				delete bifs[j];
+
+			throw;
+		}
+	}
+
+	addCachedKEY(key, archives, bifs);
+
+	debugC(1, Common::kDebugResources, "Indexed %u BIFs in %.3fs", count, getSecondsSince(startTime));
 }
 
 void ResourceManager::indexArchive(KnownArchive &knownArchive, Archive *archive,
                                    uint32 priority, Change *change) {
 
-	const Common::HashAlgo hashAlgo = archive->getNameHashAlgo();
+	indexArchive(knownArchive, archive, archive->getResources(), archive->getNameHashAlgo(), priority, change);
+}
+
+void ResourceManager::indexArchive(KnownArchive &knownArchive, Archive *archive,
+                                   const Archive::ResourceList &resources, Common::HashAlgo hashAlgo,
+                                   uint32 priority, Change *change) {
+
 	if ((hashAlgo != Common::kHashNone) && (hashAlgo != _hashAlgo))
 		throw Common::Exception("ResourceManager::indexArchive(): Archive uses a different name hashing "
 		                        "algorithm than we do (%d vs. %d)", (int) hashAlgo, (int) _hashAlgo);
@@ -414,7 +1135,7 @@ void ResourceManager::indexArchive(KnownArchive &knownArchive, Archive *archive,
 	_openedArchives.push_back(OpenedArchive());
 
 	try {
-		_openedArchives.back().set(knownArchive, *archive);
+		_openedArchives.back().set(knownArchive, archive);
 	} catch (...) {
 		_openedArchives.pop_back();
 		throw;
@@ -424,7 +1145,6 @@ void ResourceManager::indexArchive(KnownArchive &knownArchive, Archive *archive,
 	if (change)
 		change->_change->openedArchives.push_back(--_openedArchives.end());
 
-	const Archive::ResourceList &resources = archive->getResources();
 	for (Archive::ResourceList::const_iterator resource = resources.begin(); resource != resources.end(); ++resource) {
 		// Build the resource record
 		Resource res;
@@ -457,6 +1177,8 @@ void ResourceManager::indexArchive(KnownArchive &knownArchive, Archive *archive,
 }
 
 bool ResourceManager::hasResourceDir(const Common::UString &dir) {
+	Common::StackLock lock(_mutex);
+
 	if (_baseDir.empty())
 		return false;
 
@@ -466,6 +1188,8 @@ bool ResourceManager::hasResourceDir(const Common::UString &dir) {
 void ResourceManager::indexResourceFile(const Common::UString &file, uint32 priority,
                                         Common::ChangeID *changeID) {
 
+	Common::StackLock lock(_mutex);
+
 	Common::UString path;
 	path = _baseDir.empty() ? file : (_baseDir + "/" + file);
 	path = Common::FilePath::normalize(path, false);
@@ -482,6 +1206,8 @@ void ResourceManager::indexResourceFile(const Common::UString &file, uint32 prio
 
 void ResourceManager::indexResourceDir(const Common::UString &dir, const char *glob, int depth,
                                        uint32 priority, Common::ChangeID *changeID) {
+	Common::StackLock lock(_mutex);
+
 	if (_baseDir.empty())
 		throw Common::Exception("No base data directory set");
 
@@ -513,6 +1239,8 @@ void ResourceManager::indexResourceDir(const Common::UString &dir, const char *g
 }
 
 void ResourceManager::undo(Common::ChangeID &changeID) {
+	Common::StackLock lock(_mutex);
+
 	Change *change = dynamic_cast<Change *>(changeID.getContent());
 	if (!change || (change->_change == _changes.end()))
 		return;
@@ -578,10 +1306,8 @@ void ResourceManager::undo(Common::ChangeID &changeID) {
 		}
 
 		// Remove the resource, and the name list too if it's empty
-		resChange->hashIt->second.erase(resChange->resIt);
-
-		if (resChange->hashIt->second.empty())
-			_resources.erase(resChange->hashIt);
+		_resources.erase(resChange->hash, &*resChange->resIt);
+		_resourceList.erase(resChange->resIt);
 	}
 
 	// Now we can remove the change set from our list of change sets
@@ -589,26 +1315,38 @@ void ResourceManager::undo(Common::ChangeID &changeID) {
 
 	// And finally set the change ID to a defined empty state
 	changeID.clear();
+
+	_generation++;
 }
 
 void ResourceManager::addTypeAlias(FileType alias, FileType realType) {
+	Common::StackLock lock(_mutex);
+
 	_typeAliases[alias] = realType;
+
+	_generation++;
 }
 
 void ResourceManager::blacklist(const Common::UString &name, FileType type) {
-	ResourceMap::iterator resList = _resources.find(getHash(name, type));
-	if (resList == _resources.end())
+	Common::StackLock lock(_mutex);
+
+	ResourceCandidates *resList = _resources.find(getHash(name, type));
+	if (!resList)
 		return;
 
-	for (ResourceList::iterator res = resList->second.begin(); res != resList->second.end(); ++res)
-		res->priority = 0;
+	for (ResourceCandidates::iterator res = resList->begin(); res != resList->end(); ++res)
+		(*res)->priority = 0;
+
+	_generation++;
 }
 
 void ResourceManager::declareResource(const Common::UString &name, FileType type) {
+	Common::StackLock lock(_mutex);
+
 	bool isSmall = false;
 
-	ResourceMap::iterator resList = _resources.find(getHash(name, type));
-	if (resList == _resources.end()) {
+	ResourceCandidates *resList = _resources.find(getHash(name, type));
+	if (!resList) {
 		if (_hasSmall) {
 			Common::UString smallName = TypeMan.addFileType(TypeMan.setFileType(name, type), kFileTypeSMALL);
 
@@ -616,17 +1354,19 @@ void ResourceManager::declareResource(const Common::UString &name, FileType type
 			isSmall = true;
 		}
 
-		if (resList == _resources.end())
+		if (!resList)
 			return;
 	}
 
-	for (ResourceList::iterator r = resList->second.begin(); r != resList->second.end(); ++r) {
-		r->name    = name;
-		r->type    = type;
-		r->isSmall = isSmall;
+	for (ResourceCandidates::iterator r = resList->begin(); r != resList->end(); ++r) {
+		(*r)->name    = name;
+		(*r)->type    = type;
+		(*r)->isSmall = isSmall;
 
-		checkResourceIsArchive(*r, 0);
+		checkResourceIsArchive(**r, 0);
 	}
+
+	_generation++;
 }
 
 void ResourceManager::declareResource(const Common::UString &name) {
@@ -652,10 +1392,20 @@ bool ResourceManager::hasResource(const Common::UString &name) const {
 }
 
 bool ResourceManager::hasResource(const Common::UString &name, const std::vector<FileType> &types) const {
+	Common::StackLock lock(_mutex);
+
 	return getRes(name, types) != 0;
 }
 
+uint32 ResourceManager::getGeneration() const {
+	Common::StackLock lock(_mutex);
+
+	return _generation;
+}
+
 bool ResourceManager::hasResource(uint64 hash) const {
+	Common::StackLock lock(_mutex);
+
 	return getRes(hash) != 0;
 }
 
@@ -679,6 +1429,8 @@ Common::UString ResourceManager::findResourceFile(const Common::UString &name) c
 
 Common::UString ResourceManager::findResourceFile(const Common::UString &name,
                                                   const std::vector<FileType> &types) const {
+	Common::StackLock lock(_mutex);
+
 	const Resource *res = getRes(name, types);
 	if (res && (res->source == kSourceFile))
 		return res->path;
@@ -688,10 +1440,10 @@ Common::UString ResourceManager::findResourceFile(const Common::UString &name,
 
 uint32 ResourceManager::getResourceSize(const Resource &res) const {
 	if (res.source == kSourceArchive) {
-		if ((res.archive == 0) || (res.archive->archive == 0) || (res.archiveIndex == 0xFFFFFFFF))
+		if ((res.archive == 0) || (res.archiveIndex == 0xFFFFFFFF))
 			return 0xFFFFFFFF;
 
-		return res.archive->archive->getResourceSize(res.archiveIndex);
+		return getArchive(*res.archive)->getResourceSize(res.archiveIndex);
 	}
 
 	if (res.source == kSourceFile)
@@ -701,18 +1453,25 @@ uint32 ResourceManager::getResourceSize(const Resource &res) const {
 }
 
 Common::SeekableReadStream *ResourceManager::getArchiveResource(const Resource &res, bool tryNoCopy) const {
-	if ((res.archive == 0) || (res.archive->archive == 0) || (res.archiveIndex == 0xFFFFFFFF))
+	if ((res.archive == 0) || (res.archiveIndex == 0xFFFFFFFF))
 		throw Common::Exception("Archive resource has no archive");
 
-	return res.archive->archive->getResource(res.archiveIndex, tryNoCopy);
+	return getArchive(*res.archive)->getResource(res.archiveIndex, tryNoCopy);
 }
 
-Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &name, FileType type) const {
+Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &name, FileType type,
+                                                         bool tryNoCopy) const {
 	std::vector<FileType> types;
 
 	types.push_back(type);
 
-	return getResource(name, types);
+	Common::StackLock lock(_mutex);
+
+	const Resource *res = getRes(name, types);
+	if (!res)
+		return 0;
+
+	return getResource(*res, tryNoCopy);
 }
 
 Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &name) const {
@@ -722,6 +1481,8 @@ Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &
 Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &name,
 		const std::vector<FileType> &types, FileType *foundType) const {
 
+	Common::StackLock lock(_mutex);
+
 	const Resource *res = getRes(name, types);
 	if (!res)
 		return 0;
@@ -734,6 +1495,8 @@ Common::SeekableReadStream *ResourceManager::getResource(const Common::UString &
 }
 
 Common::SeekableReadStream *ResourceManager::getResource(uint64 hash, FileType *type) const {
+	Common::StackLock lock(_mutex);
+
 	const Resource *res = getRes(hash);
 	if (!res)
 		return 0;
@@ -750,6 +1513,15 @@ Common::SeekableReadStream *ResourceManager::getResource(const Resource &res, bo
 
 	switch (res.source) {
 		case kSourceFile:
+			// Compressed "small" files need to be read anyway, so only map plain ones
+			if (tryNoCopy && !res.isSmall) {
+				Common::MappedFile *mappedFile = new Common::MappedFile;
+				if (mappedFile->open(res.path))
+					return mappedFile;
+
+				delete mappedFile;
+			}
+
 			stream = new Common::ReadFile(res.path);
 			break;
 
@@ -792,28 +1564,31 @@ Common::SeekableReadStream *ResourceManager::getResource(ResourceType resType,
 void ResourceManager::getAvailableResources(FileType type,
 		std::list<ResourceID> &list) const {
 
-	for (ResourceMap::const_iterator r = _resources.begin(); r != _resources.end(); ++r) {
-		if (!r->second.empty() && (r->second.front().type == type)) {
-			list.push_back(ResourceID());
+	std::vector<FileType> types(1, type);
 
-			list.back().name = r->second.front().name;
-			list.back().type = r->second.front().type;
-			list.back().hash = r->first;
-		}
-	}
+	getAvailableResources(types, list);
 }
 
 void ResourceManager::getAvailableResources(const std::vector<FileType> &types,
 		std::list<ResourceID> &list) const {
 
-	for (ResourceMap::const_iterator r = _resources.begin(); r != _resources.end(); ++r) {
+	Common::StackLock lock(_mutex);
+
+	// Go through the resources in the order of their hashes, to get a stable result
+	std::vector<uint64> hashes;
+	_resources.getHashes(hashes);
+
+	for (std::vector<uint64>::const_iterator h = hashes.begin(); h != hashes.end(); ++h) {
+		const ResourceCandidates *r = _resources.find(*h);
+		assert(r && !r->empty());
+
 		for (std::vector<FileType>::const_iterator t = types.begin(); t != types.end(); ++t) {
-			if (!r->second.empty() && (r->second.front().type == *t)) {
+			if (r->front()->type == *t) {
 				list.push_back(ResourceID());
 
-				list.back().name = r->second.front().name;
-				list.back().type = r->second.front().type;
-				list.back().hash = r->first;
+				list.back().name = r->front()->name;
+				list.back().type = r->front()->type;
+				list.back().hash = *h;
 			}
 		}
 
@@ -892,17 +1667,17 @@ inline uint64 ResourceManager::getHash(const Common::UString &name) const {
 	return Common::hashString(name.toLower(), _hashAlgo);
 }
 
-void ResourceManager::checkHashCollision(const Resource &resource, ResourceMap::const_iterator resList) {
-	if (resource.name.empty() || resList->second.empty())
+void ResourceManager::checkHashCollision(const Resource &resource, const ResourceCandidates &resList) {
+	if (resource.name.empty() || resList.empty())
 		return;
 
 	Common::UString newName = TypeMan.setFileType(resource.name, resource.type).toLower();
 
-	for (ResourceList::const_iterator r = resList->second.begin(); r != resList->second.end(); ++r) {
-		if (r->name.empty())
+	for (ResourceCandidates::const_iterator r = resList.begin(); r != resList.end(); ++r) {
+		if ((*r)->name.empty())
 			continue;
 
-		Common::UString oldName = TypeMan.setFileType(r->name, r->type).toLower();
+		Common::UString oldName = TypeMan.setFileType((*r)->name, (*r)->type).toLower();
 		if (oldName != newName) {
 			warning("ResourceManager: Found hash collision: %s (\"%s\" and \"%s\")",
 					Common::formatHash(getHash(oldName)).c_str(), oldName.c_str(), newName.c_str());
@@ -943,36 +1718,27 @@ bool ResourceManager::checkResourceIsArchive(Resource &resource, Change *change)
 }
 
 void ResourceManager::addResource(Resource &resource, uint64 hash, Change *change) {
-	ResourceMap::iterator resList = _resources.find(hash);
-	if (resList == _resources.end()) {
-		// We don't have a resource with this name yet, create a new resource list for it
-
-		std::pair<ResourceMap::iterator, bool> result;
-
-		result = _resources.insert(std::make_pair(hash, ResourceList()));
-
-		resList = result.first;
-	}
-
 #ifdef CHECK_HASH_COLLISION
-	checkHashCollision(resource, resList);
+	const ResourceCandidates *resList = _resources.find(hash);
+	if (resList)
+		checkHashCollision(resource, *resList);
 #endif
 
-	// Add the resource to the list
-	resList->second.push_back(resource);
-	Resource *res = &resList->second.back();
+	// Add the resource to the list, and then to the map
+	_resourceList.push_back(resource);
+	Resource *res = &_resourceList.back();
+
+	_resources.insert(hash, res);
+	_generation++;
 
 	checkResourceIsArchive(*res, change);
 
 	// Remember the resource in the change set
 	if (change) {
 		change->_change->resources.push_back(ResourceChange());
-		change->_change->resources.back().hashIt = resList;
-		change->_change->resources.back().resIt  = --resList->second.end();
+		change->_change->resources.back().hash  = hash;
+		change->_change->resources.back().resIt = --_resourceList.end();
 	}
-
-	// Resort the list by priority
-	resList->second.sort();
 }
 
 void ResourceManager::addResource(const Common::UString &path, Change *change, uint32 priority) {
@@ -1006,11 +1772,11 @@ void ResourceManager::addResources(const Common::FileList &files, Change *change
 }
 
 const ResourceManager::Resource *ResourceManager::getRes(uint64 hash) const {
-	ResourceMap::const_iterator r = _resources.find(hash);
-	if ((r == _resources.end()) || r->second.empty() || (r->second.back().priority == 0))
+	const ResourceCandidates *r = _resources.find(hash);
+	if (!r || r->empty() || (r->back()->priority == 0))
 		return 0;
 
-	return &r->second.back();
+	return r->back();
 }
 
 const ResourceManager::Resource *ResourceManager::getRes(const Common::UString &name,
@@ -1042,6 +1808,8 @@ const ResourceManager::Resource *ResourceManager::getRes(const Common::UString &
 }
 
 void ResourceManager::dumpResourcesList(const Common::UString &fileName) const {
+	Common::StackLock lock(_mutex);
+
 	Common::WriteFile file;
 
 	if (!file.open(fileName))
@@ -1050,15 +1818,19 @@ void ResourceManager::dumpResourcesList(const Common::UString &fileName) const {
 	file.writeString("                Name                 |        Hash        |     Size    \n");
 	file.writeString("-------------------------------------|--------------------|-------------\n");
 
-	for (ResourceMap::const_iterator r = _resources.begin(); r != _resources.end(); ++r) {
-		if (r->second.empty())
+	std::vector<uint64> hashes;
+	_resources.getHashes(hashes);
+
+	for (std::vector<uint64>::const_iterator h = hashes.begin(); h != hashes.end(); ++h) {
+		const ResourceCandidates *r = _resources.find(*h);
+		if (!r || r->empty())
 			continue;
 
-		const Resource &res = r->second.back();
+		const Resource &res = *r->back();
 
 		const Common::UString &name = res.name;
 		const Common::UString   ext = TypeMan.setFileType("", res.type);
-		const uint64           hash = r->first;
+		const uint64           hash = *h;
 		const uint32           size = getResourceSize(res);
 
 		const Common::UString line =
@@ -36,21 +36,40 @@
 #include "src/common/filelist.h"
 #include "src/common/hash.h"
 #include "src/common/changeid.h"
+#include "src/common/mutex.h"
 
 #include "src/aurora/types.h"
+#include "src/aurora/archive.h"
 
 namespace Common {
 	class SeekableReadStream;
+	class WriteStream;
 }
 
 namespace Aurora {
 
-class Archive;
 class KEYFile;
 class BIFFile;
 
 /** A resource manager holding information about and handling all request for all
  *  resources useable by the game.
+ *
+ *  Thread safety: all public methods are safe to be called from any thread.
+ *  In particular, several threads can query and fetch resources at the same
+ *  time, for example to load textures or models in the background.
+ *
+ *  Looking up a resource and opening its stream are done under a lock. For
+ *  resources in archives that are mapped into memory (see Common::MappedFile),
+ *  opening the stream just creates a view, so this is cheap. Resources in other
+ *  archives have to be read out of a shared stream, so fetching those is
+ *  serialized. Once returned, a resource stream belongs to the caller alone and
+ *  can be read and decoded without any further locking.
+ *
+ *  Optionally, the resource lists of archive files can be kept in an index
+ *  cache file (see setIndexCache()). An archive file that hasn't changed since
+ *  it was cached (same path, size and modification time) is then indexed
+ *  straight out of the cache, and only actually opened once a resource
+ *  within it is requested.
  */
 class ResourceManager : public Common::Singleton<ResourceManager> {
 public:
@@ -85,6 +104,25 @@ public:
 	 *  @param realType The actual type a resource of the alias type is.
 	 */
 	void addTypeAlias(FileType alias, FileType realType);
+
+	/** Set the number of threads used to open archives when indexing several at once.
+	 *
+	 *  0 means one thread per CPU core, 1 opens all archives one after the other.
+	 */
+	void setIndexThreads(size_t threads);
+	// '---
+
+	// .--- Index cache
+	/** Use this file to cache the resource lists of archives across runs.
+	 *
+	 *  Any previous index cache is written to disk first, if it changed.
+	 *  The new cache file is read, if it exists. An empty file name
+	 *  disables the index cache.
+	 */
+	void setIndexCache(const Common::UString &file);
+
+	/** Write the index cache to disk, if it changed. */
+	void saveIndexCache();
 	// '---
 
 	// .--- Data base
@@ -135,6 +173,21 @@ public:
 	 */
 	void indexArchive(const Common::UString &file, uint32 priority, const std::vector<byte> &password,
 	                  Common::ChangeID *changeID = 0);
+
+	/** Add all the resources of several archives to the resource manager.
+	 *
+	 *  The archives are read and parsed in parallel (see setIndexThreads()), but
+	 *  their resources are added strictly in order. The result is the same as
+	 *  calling indexArchive() on each file in turn, with the priority counting up
+	 *  by one for each file.
+	 *
+	 *  @param files The names of the archive files to index.
+	 *  @param priority The priority of the first archive. Every following archive
+	 *                  has a priority one higher than the one before.
+	 *  @param changeID If given, record the collective changes done here.
+	 */
+	void indexArchives(const std::vector<Common::UString> &files, uint32 priority,
+	                   Common::ChangeID *changeID = 0);
 	// '---
 
 	// .--- Directories and files
@@ -204,6 +257,14 @@ public:
 	// '---
 
 	// .--- Resources
+	/** Return the current generation of the resource index.
+	 *
+	 *  The generation changes whenever resources are added, removed or
+	 *  altered. Comparing it to an earlier value tells whether data derived
+	 *  from resources might be out of date.
+	 */
+	uint32 getGeneration() const;
+
 	/** Does a specific resource exist?
 	 *
 	 *  @param  hash The hash of the name and extension of the resource.
@@ -287,12 +348,19 @@ public:
 	Common::SeekableReadStream *getResource(uint64 hash, FileType *type = 0) const;
 
 	/** Return a resource.
+	 *
+	 *  With tryNoCopy set, the resource manager tries to avoid reading the
+	 *  resource into memory: plain files are mapped, and resources inside
+	 *  archives are returned as views where the archive allows that. This
+	 *  is meant for large resources that are kept open for a long time.
 	 *
 	 *  @param  name The name (ResRef) of the resource.
 	 *  @param  type The resource's type.
+	 *  @param  tryNoCopy Try to return the resource without copying it.
 	 *  @return The resource stream or 0 if the resource doesn't exist.
 	 */
-	Common::SeekableReadStream *getResource(const Common::UString &name, FileType type) const;
+	Common::SeekableReadStream *getResource(const Common::UString &name, FileType type,
+	                                        bool tryNoCopy = false) const;
 
 	/** Return a resource.
 	 *
@@ -342,6 +410,7 @@ private:
 
 	struct Resource;
 	struct OpenedArchive;
+	struct CachedArchive;
 
 	// .--- Archives
 	struct KnownArchive {
@@ -359,7 +428,7 @@ private:
 	};
 
 	struct OpenedArchive {
-		/** The actual archive. */
+		/** The actual archive, or 0 if it hasn't been opened yet. */
 		Archive *archive;
 
 		/** The information we know about this archive. */
@@ -372,13 +441,64 @@ private:
 
 		OpenedArchive();
 
-		void set(KnownArchive &kA, Archive &a);
+		void set(KnownArchive &kA, Archive *a);
 	};
 
 	/** List of all known archive files. */
 	typedef std::list<KnownArchive> KnownArchives;
 	/** List of all opened archive files. */
 	typedef std::list<OpenedArchive> OpenedArchives;
+
+	/** An archive that's about to be opened, maybe in parallel with others. */
+	struct PendingArchive {
+		KnownArchive *known; ///< The archive to open.
+
+		/** The archive's data, until the opened archive takes it over. */
+		Common::SeekableReadStream *stream;
+		/** The password to decrypt the archive with. */
+		const std::vector<byte> *password;
+
+		const KEYFile *key;      ///< For BIFs, the KEY describing the BIF's contents.
+		uint32         keyIndex; ///< For BIFs, the BIF's index within the KEY.
+
+		Archive *archive; ///< The opened archive.
+
+		/** If the archive is found in the index cache, its cached information. */
+		const CachedArchive *cached;
+
+		bool              failed; ///< Did opening the archive fail?
+		Common::Exception error;  ///< If so, why.
+
+		PendingArchive();
+	};
+
+	typedef std::vector<PendingArchive> PendingArchives;
+	// '---
+
+	// .--- Index cache
+	/** The cached resource list of an archive file. */
+	struct CachedArchive {
+		Common::UString name; ///< For BIFs, the name the KEY knows the BIF by.
+		Common::UString path; ///< The path of the archive file.
+
+		uint64 size; ///< The size of the archive file.
+		uint64 time; ///< The modification time of the archive file.
+
+		/** The algorithm the archive hashes its resource names with. */
+		Common::HashAlgo hashAlgo;
+		/** The resources within the archive. */
+		Archive::ResourceList resources;
+
+		/** For KEYs, the BIFs the KEY indexes. */
+		std::vector<CachedArchive> bifs;
+
+		CachedArchive();
+
+		void swap(CachedArchive &cached);
+	};
+
+	/** Cached archives, indexed by their path. */
+	typedef std::map<Common::UString, CachedArchive> IndexCache;
 	// '---
 
 	// .--- Resources
@@ -418,10 +538,59 @@ private:
 		bool operator<(const Resource &right) const;
 	};
 
-	/** List of resources, sorted by priority. */
+	/** List of all resources. Once added, a resource never moves in memory. */
 	typedef std::list<Resource> ResourceList;
-	/** Map over resources, indexed by their hashed name. */
-	typedef std::map<uint64, ResourceList> ResourceMap;
+	/** All resources with the same hashed name, sorted by priority. */
+	typedef std::vector<Resource *> ResourceCandidates;
+
+	/** Map over resources, indexed by their hashed name.
+	 *
+	 *  This is an open-addressing hash table with linear probing, so that a
+	 *  lookup only touches a short, contiguous run of slots. Removal shifts the
+	 *  following entries of a run back, which means we need no tombstones.
+	 */
+	class ResourceMap {
+	public:
+		ResourceMap();
+
+		void clear();
+
+		bool empty() const;
+		size_t size() const;
+
+		/** Return the candidates for this hash, or 0 if there are none. */
+		const ResourceCandidates *find(uint64 hash) const;
+		/** Return the candidates for this hash, or 0 if there are none. */
+		ResourceCandidates *find(uint64 hash);
+
+		/** Add a resource as a candidate for this hash. */
+		void insert(uint64 hash, Resource *resource);
+		/** Remove a resource from the candidates for this hash. */
+		void erase(uint64 hash, Resource *resource);
+
+		/** Return all hashes in the map, in ascending order. */
+		void getHashes(std::vector<uint64> &hashes) const;
+
+	private:
+		struct Slot {
+			uint64 hash;
+
+			/** If this is empty, the slot is unused. */
+			ResourceCandidates resources;
+
+			Slot();
+		};
+
+		std::vector<Slot> _slots;
+
+		size_t _size;
+		size_t _mask;
+
+		size_t getHome(uint64 hash) const;
+		size_t findSlot(uint64 hash) const;
+
+		void grow();
+	};
 	// '---
 
 	// .--- Changes
@@ -431,7 +600,7 @@ private:
 	typedef OpenedArchives::iterator OpenedArchiveChange;
 	/** A change produced by indexing archive resources. */
 	struct ResourceChange {
-		ResourceMap::iterator  hashIt;
+		uint64                 hash;
 		ResourceList::iterator resIt;
 	};
 
@@ -478,14 +647,27 @@ private:
 	/** The data base archive (if any), the archive the current game is in. */
 	Common::UString _baseArchive;
 
+	/** The number of threads used for opening archives. 0 means one per core. */
+	size_t _indexThreads;
+
+	Common::UString _indexCacheFile;  ///< The file the index cache is stored in.
+	IndexCache      _indexCache;      ///< The resource lists of cached archives.
+	bool            _indexCacheDirty; ///< Was the index cache changed since it was read?
+
+	/** Guards everything, so that resources can be fetched from several threads. */
+	mutable Common::Mutex _mutex;
+
 	KnownArchives  _knownArchives[kArchiveMAX]; ///< List of all known archives.
 	OpenedArchives _openedArchives;             ///< List of currently used archives.
 
 	/** The current type aliases, changing one type to another. */
 	std::map<FileType, FileType> _typeAliases;
 
-	ResourceMap   _resources; ///< All currently known resources.
-	ChangeSetList _changes;   ///< Changes produced by indexing the currently known resources.
+	ResourceList  _resourceList; ///< Storage of all currently known resources.
+	ResourceMap   _resources;    ///< All currently known resources, by hash.
+	ChangeSetList _changes;      ///< Changes produced by indexing the currently known resources.
+
+	uint32 _generation; ///< Changes whenever the resource index changes.
 
 	FileTypeSet  _archiveTypeTypes [kArchiveMAX];  ///< All valid archive types file types.
 	FileTypeList _resourceTypeTypes[kResourceMAX]; ///< All valid resource type file types.
@@ -499,14 +681,45 @@ private:
 	// '---
 
 	// .--- Indexing archives
-	void indexKEY(Common::SeekableReadStream *stream, uint32 priority, Change *change);
+	void indexKEY(KnownArchive &key, Common::SeekableReadStream *stream, uint32 priority, Change *change);
 	uint32 openKEYBIFs(Common::SeekableReadStream *keyStream,
 	                   std::vector<KnownArchive *> &archives, std::vector<BIFFile *> &bifs);
 
 	void indexArchive(KnownArchive &knownArchive, Archive *archive,
 	                  uint32 priority, Change *change);
+	void indexArchive(KnownArchive &knownArchive, Archive *archive,
+	                  const Archive::ResourceList &resources, Common::HashAlgo hashAlgo,
+	                  uint32 priority, Change *change);
 
 	Common::SeekableReadStream *openArchiveStream(const KnownArchive &archive) const;
+
+	Archive *openArchive(ArchiveType type, Common::SeekableReadStream *stream,
+	                     const std::vector<byte> &password) const;
+
+	void openPendingArchive(PendingArchive &pending) const;
+	void openPendingArchives(PendingArchives &pending) const;
+	void closePendingArchives(PendingArchives &pending) const;
+
+	Archive *getArchive(OpenedArchive &archive) const;
+	// '---
+
+	// .--- Index cache
+	void loadIndexCache();
+	void clearIndexCache();
+
+	bool initCachedArchive(CachedArchive &cached, const KnownArchive &archive) const;
+	bool isCachedArchiveValid(const CachedArchive &cached, const KnownArchive &archive) const;
+
+	const CachedArchive *getCachedArchive(const KnownArchive &archive);
+	void indexCachedArchive(KnownArchive &archive, const CachedArchive &cached,
+	                        uint32 priority, Change *change);
+
+	void addCachedArchive(const KnownArchive &knownArchive, const Archive &archive);
+	void addCachedKEY(const KnownArchive &key, const std::vector<KnownArchive *> &bifs,
+	                  const std::vector<BIFFile *> &bifFiles);
+
+	static void readCachedArchive(Common::SeekableReadStream &stream, CachedArchive &cached);
+	static void writeCachedArchive(Common::WriteStream &stream, const CachedArchive &cached);
 	// '---
 
 	// .--- Adding resources
@@ -541,7 +754,7 @@ private:
 	inline uint64 getHash(const Common::UString &name, FileType type) const;
 	inline uint64 getHash(const Common::UString &name) const;
 
-	void checkHashCollision(const Resource &resource, ResourceMap::const_iterator resList);
+	void checkHashCollision(const Resource &resource, const ResourceCandidates &resList);
 
 	Change *newChangeSet(Common::ChangeID &changeID);
 	// '---
@@ -27,6 +27,7 @@
 #include "src/common/util.h"
 #include "src/common/strutil.h"
 #include "src/common/memreadstream.h"
+#include "src/common/mappedfile.h"
 #include "src/common/error.h"
 #include "src/common/encoding.h"
 
@@ -114,6 +115,11 @@ uint32 RIMFile::getResourceSize(uint32 index) const {
 Common::SeekableReadStream *RIMFile::getResource(uint32 index, bool tryNoCopy) const {
 	const IResource &res = getIResource(index);
 
+	// If the RIM is mapped into memory, we can just give out a view into it
+	const Common::MappedFile *mappedRIM = dynamic_cast<const Common::MappedFile *>(_rim);
+	if (mappedRIM)
+		return mappedRIM->readView(res.offset, res.size);
+
 	if (tryNoCopy)
 		return new Common::SeekableSubReadStream(_rim, res.offset, res.offset + res.size);
 
@@ -57,7 +57,8 @@ static TalkTable *loadTable(const Common::UString &name, Common::Encoding encodi
 	if (name.empty())
 		return 0;
 
-	Common::SeekableReadStream *tlk = ResMan.getResource(name, kFileTypeTLK);
+	// Talk tables stay open for a long time, so try not to read them into memory
+	Common::SeekableReadStream *tlk = ResMan.getResource(name, kFileTypeTLK, true);
 	if (!tlk)
 		return 0;
 
@@ -130,7 +131,7 @@ void TalkManager::removeTable(Common::ChangeID &changeID) {
 }
 
 static const Common::UString kEmptyString = "";
-const Common::UString &TalkManager::getString(uint32 strRef, LanguageGender gender) {
+Common::UString TalkManager::getString(uint32 strRef, LanguageGender gender) {
 	if (gender == kLanguageGenderCurrent)
 		gender = LangMan.getCurrentGender();
 
@@ -144,7 +145,7 @@ const Common::UString &TalkManager::getString(uint32 strRef, LanguageGender gend
 	return table->getString(strRef);
 }
 
-const Common::UString &TalkManager::getSoundResRef(uint32 strRef, LanguageGender gender) {
+Common::UString TalkManager::getSoundResRef(uint32 strRef, LanguageGender gender) {
 	if (gender == kLanguageGenderCurrent)
 		gender = LangMan.getCurrentGender();
 
@@ -60,8 +60,8 @@ public:
 	/** Remove a talk table from the talk manager again. */
 	void removeTable(Common::ChangeID &changeID);
 
-	const Common::UString &getString     (uint32 strRef, LanguageGender gender = kLanguageGenderCurrent);
-	const Common::UString &getSoundResRef(uint32 strRef, LanguageGender gender = kLanguageGenderCurrent);
+	Common::UString getString     (uint32 strRef, LanguageGender gender = kLanguageGenderCurrent);
+	Common::UString getSoundResRef(uint32 strRef, LanguageGender gender = kLanguageGenderCurrent);
 
 private:
 	struct Table {
@@ -53,8 +53,8 @@ public:
 
 	virtual bool hasEntry(uint32 strRef) const = 0;
 
-	virtual const Common::UString &getString     (uint32 strRef) const = 0;
-	virtual const Common::UString &getSoundResRef(uint32 strRef) const = 0;
+	virtual Common::UString getString     (uint32 strRef) const = 0;
+	virtual Common::UString getSoundResRef(uint32 strRef) const = 0;
 
 	static TalkTable *load(Common::SeekableReadStream *tlk, Common::Encoding encoding);
 
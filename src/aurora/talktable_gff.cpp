@@ -63,7 +63,7 @@ bool TalkTable_GFF::hasEntry(uint32 strRef) const {
 }
 
 static const Common::UString kEmptyString = "";
-const Common::UString &TalkTable_GFF::getString(uint32 strRef) const {
+Common::UString TalkTable_GFF::getString(uint32 strRef) const {
 	Entries::iterator e = _entries.find(strRef);
 	if (e == _entries.end())
 		return kEmptyString;
@@ -73,7 +73,7 @@ const Common::UString &TalkTable_GFF::getString(uint32 strRef) const {
 	return e->second->text;
 }
 
-const Common::UString &TalkTable_GFF::getSoundResRef(uint32 UNUSED(strRef)) const {
+Common::UString TalkTable_GFF::getSoundResRef(uint32 UNUSED(strRef)) const {
 	return kEmptyString;
 }
 
@@ -52,8 +52,8 @@ public:
 
 	bool hasEntry(uint32 strRef) const;
 
-	const Common::UString &getString     (uint32 strRef) const;
-	const Common::UString &getSoundResRef(uint32 strRef) const;
+	Common::UString getString     (uint32 strRef) const;
+	Common::UString getSoundResRef(uint32 strRef) const;
 
 
 private:
@@ -31,6 +31,7 @@
 #include "src/common/util.h"
 #include "src/common/strutil.h"
 #include "src/common/memreadstream.h"
+#include "src/common/mappedfile.h"
 #include "src/common/readfile.h"
 #include "src/common/error.h"
 
@@ -43,8 +44,17 @@ static const uint32 kVersion4 = MKTAG('V', '4', '.', '0');
 
 namespace Aurora {
 
+static const size_t kEntrySizeV3 = 40;
+static const size_t kEntrySizeV4 = 10;
+
+TalkTable_TLK::DecodedEntry::DecodedEntry(uint32 r) :
+	strRef(r), hasText(false), hasSoundResRef(false) {
+
+}
+
+
 TalkTable_TLK::TalkTable_TLK(Common::SeekableReadStream *tlk, Common::Encoding encoding) :
-	TalkTable(encoding), _tlk(tlk) {
+	TalkTable(encoding), _tlk(tlk), _data(0), _size(0) {
 
 	load();
 }
@@ -65,26 +75,22 @@ void TalkTable_TLK::load() {
 		if (_version != kVersion3 && _version != kVersion4)
 			throw Common::Exception("Unsupported TLK file version %s", Common::debugTag(_version).c_str());
 
-		_languageID = _tlk->readUint32LE();
-
-		uint32 stringCount = _tlk->readUint32LE();
-		_entries.resize(stringCount);
+		_languageID  = _tlk->readUint32LE();
+		_stringCount = _tlk->readUint32LE();
 
 		// V4 added this field; it's right after the header in V3
-		uint32 tableOffset = 20;
+		_tableOffset = 20;
 		if (_version == kVersion4)
-			tableOffset = _tlk->readUint32LE();
+			_tableOffset = _tlk->readUint32LE();
 
 		_stringsOffset = _tlk->readUint32LE();
 
-		// Go to the table
-		_tlk->seek(tableOffset);
+		loadData();
 
-		// Read in all the table data
-		if (_version == kVersion3)
-			readEntryTableV3();
-		else
-			readEntryTableV4();
+		// Make sure the whole entry table is there, so we can read it without any further checks
+		const size_t entrySize = (_version == kVersion3) ? kEntrySizeV3 : kEntrySizeV4;
+		if ((_tableOffset > _size) || (((_size - _tableOffset) / entrySize) < _stringCount))
+			throw Common::Exception(Common::kReadError);
 
 	} catch (Common::Exception &e) {
 		delete _tlk;
@@ -94,50 +100,96 @@ void TalkTable_TLK::load() {
 	}
 }
 
-void TalkTable_TLK::readEntryTableV3() {
-	for (Entries::iterator entry = _entries.begin(); entry != _entries.end(); ++entry) {
-		entry->flags          = _tlk->readUint32LE();
-		entry->soundResRef    = Common::readStringFixed(*_tlk, Common::kEncodingASCII, 16);
-		entry->volumeVariance = _tlk->readUint32LE();
-		entry->pitchVariance  = _tlk->readUint32LE();
-		entry->offset         = _tlk->readUint32LE() + _stringsOffset;
-		entry->length         = _tlk->readUint32LE();
-		entry->soundLength    = _tlk->readIEEEFloatLE();
+void TalkTable_TLK::loadData() {
+	/* We want the whole file in one contiguous buffer. If the stream already
+	 * is one (for example a mapped file, or a view into a mapped archive), we
+	 * can use it directly. Otherwise, we have to read it into memory. */
+
+	Common::MemoryReadStream *memory = dynamic_cast<Common::MemoryReadStream *>(_tlk);
+	if (memory) {
+		_data = memory->getData();
+		_size = memory->size();
+		return;
+	}
+
+	Common::MappedFile *mapped = dynamic_cast<Common::MappedFile *>(_tlk);
+	if (mapped) {
+		_data = mapped->getData();
+		_size = mapped->size();
+		return;
 	}
+
+	_tlk->seek(0);
+	memory = _tlk->readStream(_tlk->size());
+
+	delete _tlk;
+	_tlk = memory;
+
+	_data = memory->getData();
+	_size = memory->size();
 }
 
-void TalkTable_TLK::readEntryTableV4() {
-	for (Entries::iterator entry = _entries.begin(); entry != _entries.end(); ++entry) {
-		entry->soundID = _tlk->readUint32LE();
-		entry->offset  = _tlk->readUint32LE();
-		entry->length  = _tlk->readUint16LE();
-		entry->flags   = kFlagTextPresent;
+TalkTable_TLK::Entry TalkTable_TLK::getEntry(uint32 strRef) const {
+	assert(strRef < _stringCount);
+
+	Entry entry;
+
+	if (_version == kVersion3) {
+		const byte *data = _data + _tableOffset + strRef * kEntrySizeV3;
+
+		entry.flags       = READ_LE_UINT32(data);
+		entry.soundResRef = data + 4;
+		entry.offset      = READ_LE_UINT32(data + 28) + _stringsOffset;
+		entry.length      = READ_LE_UINT32(data + 32);
+
+	} else {
+		const byte *data = _data + _tableOffset + strRef * kEntrySizeV4;
+
+		entry.flags       = kFlagTextPresent;
+		entry.soundResRef = 0;
+		entry.offset      = READ_LE_UINT32(data + 4);
+		entry.length      = READ_LE_UINT16(data + 8);
 	}
+
+	return entry;
 }
 
-void TalkTable_TLK::readString(Entry &entry) const {
-	if (!entry.text.empty() || (entry.length == 0) || !(entry.flags & kFlagTextPresent))
-		// We already have the string
-		return;
+TalkTable_TLK::DecodedEntry &TalkTable_TLK::getDecodedEntry(uint32 strRef) const {
+	DecodedEntryMap::iterator d = _decodedMap.find(strRef);
+	if (d != _decodedMap.end()) {
+		// Move the entry to the front, marking it as the most recently used one
+		_decoded.splice(_decoded.begin(), _decoded, d->second);
 
-	assert(_tlk);
+		return *d->second;
+	}
+
+	if (_decodedMap.size() >= kCacheSize) {
+		// Throw out the least recently used entry
+		_decodedMap.erase(_decoded.back().strRef);
+		_decoded.pop_back();
+	}
 
-	_tlk->seek(entry.offset);
+	_decoded.push_front(DecodedEntry(strRef));
+	_decodedMap.insert(std::make_pair(strRef, _decoded.begin()));
 
-	uint32 length = MIN<size_t>(entry.length, _tlk->size() - _tlk->pos());
-	if (length == 0)
-		return;
+	return _decoded.front();
+}
+
+Common::UString TalkTable_TLK::readString(const Entry &entry) const {
+	if ((entry.length == 0) || !(entry.flags & kFlagTextPresent) || (entry.offset >= _size))
+		return "";
+
+	const size_t length = MIN<size_t>(entry.length, _size - entry.offset);
 
-	Common::MemoryReadStream *data   = _tlk->readStream(length);
-	Common::MemoryReadStream *parsed = LangMan.preParseColorCodes(*data);
+	Common::MemoryReadStream  data(_data + entry.offset, length);
+	Common::MemoryReadStream *parsed = LangMan.preParseColorCodes(data);
 
+	Common::UString text = "[???]";
 	if (_encoding != Common::kEncodingInvalid)
-		entry.text = Common::readString(*parsed, _encoding);
-	else
-		entry.text = "[???]";
+		text = Common::readString(*parsed, _encoding);
 
 	delete parsed;
-	delete data;
+	return text;
 }
 
 uint32 TalkTable_TLK::getLanguageID() const {
@@ -145,24 +197,40 @@ uint32 TalkTable_TLK::getLanguageID() const {
 }
 
 bool TalkTable_TLK::hasEntry(uint32 strRef) const {
-	return strRef < _entries.size();
+	return strRef < _stringCount;
 }
 
 static const Common::UString kEmptyString = "";
-const Common::UString &TalkTable_TLK::getString(uint32 strRef) const {
-	if (strRef >= _entries.size())
+Common::UString TalkTable_TLK::getString(uint32 strRef) const {
+	if (strRef >= _stringCount)
 		return kEmptyString;
 
-	readString(_entries[strRef]);
+	DecodedEntry &decoded = getDecodedEntry(strRef);
+	if (!decoded.hasText) {
+		decoded.text    = readString(getEntry(strRef));
+		decoded.hasText = true;
+	}
 
-	return _entries[strRef].text;
+	return decoded.text;
 }
 
-const Common::UString &TalkTable_TLK::getSoundResRef(uint32 strRef) const {
-	if (strRef >= _entries.size())
+Common::UString TalkTable_TLK::getSoundResRef(uint32 strRef) const {
+	if (strRef >= _stringCount)
 		return kEmptyString;
 
-	return _entries[strRef].soundResRef;
+	const Entry entry = getEntry(strRef);
+	if (!entry.soundResRef)
+		return kEmptyString;
+
+	DecodedEntry &decoded = getDecodedEntry(strRef);
+	if (!decoded.hasSoundResRef) {
+		Common::MemoryReadStream soundResRef(entry.soundResRef, 16);
+
+		decoded.soundResRef    = Common::readStringFixed(soundResRef, Common::kEncodingASCII, 16);
+		decoded.hasSoundResRef = true;
+	}
+
+	return decoded.soundResRef;
 }
 
 uint32 TalkTable_TLK::getLanguageID(Common::SeekableReadStream &tlk) {
@@ -25,7 +25,9 @@
 #ifndef AURORA_TALKTABLE_TLK_H
 #define AURORA_TALKTABLE_TLK_H
 
-#include <vector>
+#include <list>
+
+#include <boost/unordered/unordered_map.hpp>
 
 #include "src/common/types.h"
 #include "src/common/ustring.h"
@@ -43,6 +45,12 @@ namespace Aurora {
  *  format. It has a numerical, game-local ID of the language it
  *  contains, and stores a few more optional data points per string,
  *  like a reference to a voice-over file.
+ *
+ *  The whole TLK file is kept in one contiguous buffer, ideally a
+ *  memory-mapped file. The entry table is read directly from that
+ *  buffer when a string is requested, and only a limited number of
+ *  decoded strings is kept around. Strings are therefore returned
+ *  by value.
  */
 class TalkTable_TLK : public AuroraBase, public TalkTable {
 public:
@@ -54,14 +62,17 @@ public:
 
 	bool hasEntry(uint32 strRef) const;
 
-	const Common::UString &getString     (uint32 strRef) const;
-	const Common::UString &getSoundResRef(uint32 strRef) const;
+	Common::UString getString     (uint32 strRef) const;
+	Common::UString getSoundResRef(uint32 strRef) const;
 
 	static uint32 getLanguageID(Common::SeekableReadStream &tlk);
 	static uint32 getLanguageID(const Common::UString &file);
 
 
 private:
+	/** The number of decoded entries we keep around. */
+	static const size_t kCacheSize = 1024;
+
 	/** The entries' flags. */
 	enum EntryFlags {
 		kFlagTextPresent        = (1 << 0),
@@ -69,39 +80,54 @@ private:
 		kFlagSoundLengthPresent = (1 << 2)
 	};
 
-	/** A talk resource entry. */
+	/** A talk resource entry, as found in the entry table. */
 	struct Entry {
-		Common::UString text;
+		uint32 flags;
 		uint32 offset;
 		uint32 length;
 
-		// V3
-		uint32 flags;
+		const byte *soundResRef; ///< The raw, fixed-size sound ResRef (V3 only).
+	};
+
+	/** A talk resource entry with its decoded strings. */
+	struct DecodedEntry {
+		uint32 strRef;
+
+		bool hasText;
+		bool hasSoundResRef;
+
+		Common::UString text;
 		Common::UString soundResRef;
-		uint32 volumeVariance; // Unused
-		uint32 pitchVariance; // Unused
-		float soundLength; // In seconds
 
-		// V4
-		uint32 soundID;
+		DecodedEntry(uint32 r);
 	};
 
-	typedef std::vector<Entry> Entries;
+	/** The decoded entries, most recently used first. */
+	typedef std::list<DecodedEntry> DecodedEntries;
+	/** Map a string reference to its decoded entry. */
+	typedef boost::unordered_map<uint32, DecodedEntries::iterator> DecodedEntryMap;
 
 
 	Common::SeekableReadStream *_tlk;
 
+	const byte *_data; ///< The whole TLK file.
+	size_t      _size; ///< The size of the whole TLK file.
+
+	uint32 _stringCount;
+	uint32 _tableOffset;
 	uint32 _stringsOffset;
 	uint32 _languageID;
 
-	mutable Entries _entries;
+	mutable DecodedEntries  _decoded;
+	mutable DecodedEntryMap _decodedMap;
 
 	void load();
+	void loadData();
 
-	void readEntryTableV3();
-	void readEntryTableV4();
+	Entry getEntry(uint32 strRef) const;
+	DecodedEntry &getDecodedEntry(uint32 strRef) const;
 
-	void readString(Entry &entry) const;
+	Common::UString readString(const Entry &entry) const;
 };
 
 } // End of namespace Aurora
@@ -0,0 +1,440 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A dynamic tree of axis-aligned bounding boxes.
+ */
+
+/* The tree is built and kept balanced the same way as the dynamic AABB tree
+ * in Box2D, by Erin Catto: new leaves are placed next to the sibling that
+ * causes the least increase in surface area, and unbalanced nodes are fixed
+ * with tree rotations on the way back up to the root.
+ */
+
+#include <cassert>
+
+#include "src/common/aabbtree.h"
+#include "src/common/boundingbox.h"
+#include "src/common/util.h"
+
+namespace Common {
+
+/** By how much the box of a leaf is enlarged in every direction. */
+static const float kMargin = 0.5f;
+
+static float getSurfaceArea(const float *min, const float *max) {
+	const float x = max[0] - min[0];
+	const float y = max[1] - min[1];
+	const float z = max[2] - min[2];
+
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+static float getCombinedSurfaceArea(const float *minA, const float *maxA,
+                                    const float *minB, const float *maxB) {
+	float min[3], max[3];
+	for (int i = 0; i < 3; i++) {
+		min[i] = MIN(minA[i], minB[i]);
+		max[i] = MAX(maxA[i], maxB[i]);
+	}
+
+	return getSurfaceArea(min, max);
+}
+
+
+bool AABBTree::Node::isLeaf() const {
+	return left == kInvalidID;
+}
+
+
+AABBTree::AABBTree() : _root(kInvalidID), _freeList(kInvalidID) {
+}
+
+AABBTree::~AABBTree() {
+}
+
+void AABBTree::clear() {
+	_nodes.clear();
+
+	_root     = kInvalidID;
+	_freeList = kInvalidID;
+}
+
+bool AABBTree::empty() const {
+	return _root == kInvalidID;
+}
+
+uint32 AABBTree::insert(const BoundingBox &box, void *object) {
+	const uint32 leaf = allocateNode();
+
+	setFromBox(_nodes[leaf], box);
+	_nodes[leaf].object = object;
+	_nodes[leaf].height = 0;
+
+	insertLeaf(leaf);
+
+	return leaf;
+}
+
+void AABBTree::remove(uint32 id) {
+	assert((id < _nodes.size()) && _nodes[id].isLeaf() && (_nodes[id].height == 0));
+
+	removeLeaf(id);
+	freeNode(id);
+}
+
+bool AABBTree::update(uint32 id, const BoundingBox &box) {
+	assert((id < _nodes.size()) && _nodes[id].isLeaf() && (_nodes[id].height == 0));
+
+	Node &leaf = _nodes[id];
+
+	float min[3], max[3];
+	box.getMin(min[0], min[1], min[2]);
+	box.getMax(max[0], max[1], max[2]);
+
+	/* Only touch the tree when the new box doesn't fit into the leaf's
+	 * fat box anymore, or when the fat box has become far too large. */
+
+	bool fits = true;
+	for (int i = 0; i < 3; i++) {
+		if ((min[i] < leaf.min[i]) || (max[i] > leaf.max[i]))
+			fits = false;
+		if ((min[i] - leaf.min[i]) > (4.0f * kMargin) || (leaf.max[i] - max[i]) > (4.0f * kMargin))
+			fits = false;
+	}
+
+	if (fits)
+		return false;
+
+	removeLeaf(id);
+	setFromBox(_nodes[id], box);
+	insertLeaf(id);
+
+	return true;
+}
+
+void AABBTree::findIntersecting(float x1, float y1, float z1, float x2, float y2, float z2,
+                                std::vector<void *> &objects) const {
+
+	if (_root == kInvalidID)
+		return;
+
+	const float start    [3] = { x1, y1, z1 };
+	const float direction[3] = { x2 - x1, y2 - y1, z2 - z1 };
+
+	std::vector<uint32> stack;
+	stack.reserve(64);
+	stack.push_back(_root);
+
+	while (!stack.empty()) {
+		const Node &node = _nodes[stack.back()];
+		stack.pop_back();
+
+		// Clip the line against the three slabs of the box
+		float tMin = 0.0f, tMax = 1.0f;
+
+		bool hit = true;
+		for (int i = 0; (i < 3) && hit; i++) {
+			if (direction[i] == 0.0f) {
+				hit = (start[i] >= node.min[i]) && (start[i] <= node.max[i]);
+				continue;
+			}
+
+			float t1 = (node.min[i] - start[i]) / direction[i];
+			float t2 = (node.max[i] - start[i]) / direction[i];
+			if (t1 > t2)
+				SWAP(t1, t2);
+
+			tMin = MAX(tMin, t1);
+			tMax = MIN(tMax, t2);
+
+			hit = tMin <= tMax;
+		}
+
+		if (!hit)
+			continue;
+
+		if (node.isLeaf()) {
+			objects.push_back(node.object);
+			continue;
+		}
+
+		stack.push_back(node.left);
+		stack.push_back(node.right);
+	}
+}
+
+uint32 AABBTree::allocateNode() {
+	uint32 node = _freeList;
+
+	if (node != kInvalidID) {
+		_freeList = _nodes[node].parent;
+	} else {
+		node = _nodes.size();
+		_nodes.push_back(Node());
+	}
+
+	_nodes[node].parent = kInvalidID;
+	_nodes[node].left   = kInvalidID;
+	_nodes[node].right  = kInvalidID;
+	_nodes[node].height = 0;
+	_nodes[node].object = 0;
+
+	return node;
+}
+
+void AABBTree::freeNode(uint32 node) {
+	_nodes[node].parent = _freeList;
+	_nodes[node].height = -1;
+	_nodes[node].object = 0;
+
+	_freeList = node;
+}
+
+void AABBTree::insertLeaf(uint32 leaf) {
+	if (_root == kInvalidID) {
+		_root = leaf;
+		_nodes[leaf].parent = kInvalidID;
+		return;
+	}
+
+	// Find the best sibling for the new leaf
+	const float *leafMin = _nodes[leaf].min;
+	const float *leafMax = _nodes[leaf].max;
+
+	uint32 sibling = _root;
+	while (!_nodes[sibling].isLeaf()) {
+		const Node &node  = _nodes[sibling];
+		const Node &left  = _nodes[node.left];
+		const Node &right = _nodes[node.right];
+
+		const float area         = getSurfaceArea(node.min, node.max);
+		const float combinedArea = getCombinedSurfaceArea(node.min, node.max, leafMin, leafMax);
+
+		// Cost of creating a new parent for this node and the new leaf
+		const float cost = 2.0f * combinedArea;
+
+		// Minimum cost of pushing the leaf further down the tree
+		const float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float costLeft = getCombinedSurfaceArea(left.min, left.max, leafMin, leafMax) + inheritanceCost;
+		if (!left.isLeaf())
+			costLeft -= getSurfaceArea(left.min, left.max);
+
+		float costRight = getCombinedSurfaceArea(right.min, right.max, leafMin, leafMax) + inheritanceCost;
+		if (!right.isLeaf())
+			costRight -= getSurfaceArea(right.min, right.max);
+
+		if ((cost < costLeft) && (cost < costRight))
+			break;
+
+		sibling = (costLeft < costRight) ? node.left : node.right;
+	}
+
+	// Create a new parent for the sibling and the leaf
+	const uint32 oldParent = _nodes[sibling].parent;
+	const uint32 newParent = allocateNode();
+
+	_nodes[newParent].parent = oldParent;
+	_nodes[newParent].left   = sibling;
+	_nodes[newParent].right  = leaf;
+	_nodes[newParent].height = _nodes[sibling].height + 1;
+	combine(_nodes[newParent], _nodes[sibling], _nodes[leaf]);
+
+	if (oldParent != kInvalidID) {
+		if (_nodes[oldParent].left == sibling)
+			_nodes[oldParent].left  = newParent;
+		else
+			_nodes[oldParent].right = newParent;
+	} else
+		_root = newParent;
+
+	_nodes[sibling].parent = newParent;
+	_nodes[leaf   ].parent = newParent;
+
+	refit(oldParent);
+}
+
+void AABBTree::removeLeaf(uint32 leaf) {
+	if (leaf == _root) {
+		_root = kInvalidID;
+		return;
+	}
+
+	const uint32 parent      = _nodes[leaf].parent;
+	const uint32 grandParent = _nodes[parent].parent;
+	const uint32 sibling     = (_nodes[parent].left == leaf) ? _nodes[parent].right : _nodes[parent].left;
+
+	// Replace the parent with the sibling
+	if (grandParent != kInvalidID) {
+		if (_nodes[grandParent].left == parent)
+			_nodes[grandParent].left  = sibling;
+		else
+			_nodes[grandParent].right = sibling;
+
+		_nodes[sibling].parent = grandParent;
+	} else {
+		_root = sibling;
+		_nodes[sibling].parent = kInvalidID;
+	}
+
+	freeNode(parent);
+	refit(grandParent);
+}
+
+void AABBTree::refit(uint32 node) {
+	while (node != kInvalidID) {
+		node = balance(node);
+
+		Node &n = _nodes[node];
+		const Node &left  = _nodes[n.left];
+		const Node &right = _nodes[n.right];
+
+		n.height = 1 + MAX(left.height, right.height);
+		combine(n, left, right);
+
+		node = n.parent;
+	}
+}
+
+uint32 AABBTree::balance(uint32 iA) {
+	Node &a = _nodes[iA];
+	if (a.isLeaf() || (a.height < 2))
+		return iA;
+
+	const uint32 iB = a.left;
+	const uint32 iC = a.right;
+
+	Node &b = _nodes[iB];
+	Node &c = _nodes[iC];
+
+	const int32 heightDifference = c.height - b.height;
+
+	// Rotate C up
+	if (heightDifference > 1) {
+		const uint32 iF = c.left;
+		const uint32 iG = c.right;
+
+		Node &f = _nodes[iF];
+		Node &g = _nodes[iG];
+
+		c.left   = iA;
+		c.parent = a.parent;
+		a.parent = iC;
+
+		if (c.parent != kInvalidID) {
+			if (_nodes[c.parent].left == iA)
+				_nodes[c.parent].left  = iC;
+			else
+				_nodes[c.parent].right = iC;
+		} else
+			_root = iC;
+
+		if (f.height > g.height) {
+			c.right  = iF;
+			a.right  = iG;
+			g.parent = iA;
+
+			combine(a, b, g);
+			combine(c, a, f);
+
+			a.height = 1 + MAX(b.height, g.height);
+			c.height = 1 + MAX(a.height, f.height);
+		} else {
+			c.right  = iG;
+			a.right  = iF;
+			f.parent = iA;
+
+			combine(a, b, f);
+			combine(c, a, g);
+
+			a.height = 1 + MAX(b.height, f.height);
+			c.height = 1 + MAX(a.height, g.height);
+		}
+
+		return iC;
+	}
+
+	// Rotate B up
+	if (heightDifference < -1) {
+		const uint32 iD = b.left;
+		const uint32 iE = b.right;
+
+		Node &d = _nodes[iD];
+		Node &e = _nodes[iE];
+
+		b.left   = iA;
+		b.parent = a.parent;
+		a.parent = iB;
+
+		if (b.parent != kInvalidID) {
+			if (_nodes[b.parent].left == iA)
+				_nodes[b.parent].left  = iB;
+			else
+				_nodes[b.parent].right = iB;
+		} else
+			_root = iB;
+
+		if (d.height > e.height) {
+			b.right  = iD;
+			a.left   = iE;
+			e.parent = iA;
+
+			combine(a, c, e);
+			combine(b, a, d);
+
+			a.height = 1 + MAX(c.height, e.height);
+			b.height = 1 + MAX(a.height, d.height);
+		} else {
+			b.right  = iE;
+			a.left   = iD;
+			d.parent = iA;
+
+			combine(a, c, d);
+			combine(b, a, e);
+
+			a.height = 1 + MAX(c.height, d.height);
+			b.height = 1 + MAX(a.height, e.height);
+		}
+
+		return iB;
+	}
+
+	return iA;
+}
+
+void AABBTree::setFromBox(Node &node, const BoundingBox &box) const {
+	box.getMin(node.min[0], node.min[1], node.min[2]);
+	box.getMax(node.max[0], node.max[1], node.max[2]);
+
+	for (int i = 0; i < 3; i++) {
+		node.min[i] -= kMargin;
+		node.max[i] += kMargin;
+	}
+}
+
+void AABBTree::combine(Node &node, const Node &a, const Node &b) const {
+	for (int i = 0; i < 3; i++) {
+		node.min[i] = MIN(a.min[i], b.min[i]);
+		node.max[i] = MAX(a.max[i], b.max[i]);
+	}
+}
+
+} // End of namespace Common
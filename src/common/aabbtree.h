@@ -0,0 +1,117 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A dynamic tree of axis-aligned bounding boxes.
+ */
+
+#ifndef COMMON_AABBTREE_H
+#define COMMON_AABBTREE_H
+
+#include <vector>
+
+#include "src/common/types.h"
+
+namespace Common {
+
+class BoundingBox;
+
+/** A dynamic bounding volume hierarchy over axis-aligned bounding boxes.
+ *
+ *  Every object in the tree is represented by a leaf, holding an opaque
+ *  pointer to the object and a slightly enlarged ("fat") copy of its box.
+ *  Each inner node contains the boxes of its two children. Objects can be
+ *  added, moved and removed at any time, while the tree is kept balanced.
+ *
+ *  Since a leaf's box is enlarged, an object moving only a little doesn't
+ *  change the tree at all. Queries return every object whose fat box
+ *  matches; the caller has to check the actual objects itself.
+ */
+class AABBTree {
+public:
+	static const uint32 kInvalidID = 0xFFFFFFFF;
+
+	AABBTree();
+	~AABBTree();
+
+	/** Remove all objects from the tree. */
+	void clear();
+
+	/** Is the tree empty? */
+	bool empty() const;
+
+	/** Add an object with this box (in absolute coordinates) to the tree.
+	 *
+	 *  @return The ID of the object within the tree.
+	 */
+	uint32 insert(const BoundingBox &box, void *object);
+
+	/** Remove the object with this ID from the tree. */
+	void remove(uint32 id);
+
+	/** The box of the object with this ID changed.
+	 *
+	 *  @return true if the tree had to be modified.
+	 */
+	bool update(uint32 id, const BoundingBox &box);
+
+	/** Find all objects whose box intersects the line from x1.y1.z1 to x2.y2.z2. */
+	void findIntersecting(float x1, float y1, float z1, float x2, float y2, float z2,
+	                      std::vector<void *> &objects) const;
+
+private:
+	struct Node {
+		float min[3];
+		float max[3];
+
+		uint32 parent; ///< The parent node, or the next free node if unused.
+		uint32 left;   ///< The left child, or kInvalidID for leaves.
+		uint32 right;  ///< The right child, or kInvalidID for leaves.
+
+		int32 height; ///< The height of the subtree, 0 for leaves, -1 for unused nodes.
+
+		void *object;
+
+		bool isLeaf() const;
+	};
+
+	std::vector<Node> _nodes;
+
+	uint32 _root;
+	uint32 _freeList; ///< Start of the linked list of unused nodes.
+
+	uint32 allocateNode();
+	void freeNode(uint32 node);
+
+	void insertLeaf(uint32 leaf);
+	void removeLeaf(uint32 leaf);
+
+	/** Recalculate the boxes and heights from this node up to the root, rebalancing on the way. */
+	void refit(uint32 node);
+	/** Rotate the subtree at this node if it's unbalanced, returning the new subtree root. */
+	uint32 balance(uint32 node);
+
+	void setFromBox(Node &node, const BoundingBox &box) const;
+	void combine(Node &node, const Node &a, const Node &b) const;
+};
+
+} // End of namespace Common
+
+#endif // COMMON_AABBTREE_H
@@ -28,8 +28,12 @@
 #include <cassert>
 
 #include "src/common/types.h"
+#include "src/common/util.h"
+#include "src/common/endianness.h"
+#include "src/common/noncopyable.h"
 #include "src/common/error.h"
 #include "src/common/readstream.h"
+#include "src/common/memreadstream.h"
 
 namespace Common {
 
@@ -60,141 +64,328 @@ public:
 	/** Read a multi-bit value from the bit stream. */
 	virtual uint32 getBits(size_t n) = 0;
 
+	/** Read a multi-bit value from the bit stream, without consuming the bits.
+	 *
+	 *  Bits past the end of the stream are read as 0.
+	 */
+	virtual uint32 peekBits(size_t n) = 0;
+
 	/** Add a bit to the value x, making it an n-bit value. */
 	virtual void addBit(uint32 &x, size_t n) = 0;
 
+	/** Are the bits handed out MSB to LSB?
+	 *
+	 *  If true, the first bit read by getBits() is the highest bit of the
+	 *  value. Otherwise, it's the lowest bit.
+	 */
+	virtual bool isMSBFirst() const = 0;
+
 protected:
 	BitStream() {
 	}
 };
 
 /**
- * A template implementing a bit stream for different data memory layouts.
+ * A template implementing a fast bit reader for different data memory layouts.
  *
- * Such a bit stream reads a valueBits-wide values from the data stream and
- * gives * access to their bits, one at a time.
+ * Such a bit reader works on valueBits-wide values in a contiguous block of
+ * memory. It keeps up to 64 bits of the data in a cache that is refilled a
+ * whole value (or, where the memory layout allows it, 8 bytes) at a time,
+ * and hands out bits out of that cache with a few shifts and masks.
  *
- * For example, a bit stream with the layout parameters 32, true, false
+ * For example, a bit reader with the layout parameters 32, true, false
  * for valueBits, isLE and isMSB2LSB, reads 32bit little-endian values
- * from the data stream and hands out the bits in the order of LSB to MSB.
+ * from the data and hands out the bits in the order of LSB to MSB.
+ *
+ * None of the methods are virtual, so decoders that know the memory layout
+ * of their data should use a bit reader directly, to let the compiler inline
+ * the reading of bits. BitStreamImpl wraps a bit reader in the BitStream
+ * interface.
  */
 template<int valueBits, bool isLE, bool isMSB2LSB>
-class BitStreamImpl : public BitStream {
+class BitReaderImpl : NonCopyable {
 private:
-	SeekableReadStream *_stream; ///< The input stream.
+	/** Are the values laid out in memory just like a plain sequence of bytes? */
+	static const bool kByteOrder = (valueBits == 8) || (isLE != isMSB2LSB);
+
+	/** Size of one unit of data that is loaded into the cache, in bytes. */
+	static const size_t kUnitSize = kByteOrder ? 1 : (valueBits / 8);
+	/** Size of one unit of data that is loaded into the cache, in bits. */
+	static const size_t kUnitBits = kUnitSize * 8;
+
+	SeekableReadStream *_stream; ///< The input stream, if any.
 	bool _disposeAfterUse;       ///< Should we delete the stream on destruction?
 
-	uint64 _value;   ///< Current value.
-	uint8  _inValue; ///< Position within the current value.
+	byte *_ownedData; ///< The data we read out of the input stream, if we had to.
+
+	const byte *_data; ///< The data.
+	size_t _dataSize;  ///< The size of the data in bytes, in whole values.
+	size_t _dataPos;   ///< The number of bytes already loaded into the cache.
+
+	/** The cache.
+	 *
+	 *  In MSB-first readers, the next bit is the highest bit of the cache.
+	 *  Otherwise, it's the lowest bit. The bits past _cacheBits are either
+	 *  0 or already the following bits of the data.
+	 */
+	uint64 _cache;
+	size_t _cacheBits; ///< The number of valid bits in the cache.
+
+	void checkLayout() {
+		if ((valueBits != 8) && (valueBits != 16) && (valueBits != 32) && (valueBits != 64))
+			throw Exception("BitStream: Invalid memory layout %d, %d, %d", valueBits, isLE, isMSB2LSB);
+	}
+
+	void setData(const byte *data, size_t size) {
+		_data     = data;
+		_dataSize = size & ~((size_t) ((valueBits >> 3) - 1));
+		_dataPos  = 0;
+
+		_cache     = 0;
+		_cacheBits = 0;
+	}
+
+	/** Get the data out of the input stream, from its current position on. */
+	void readStream(SeekableReadStream &stream) {
+		const size_t start = stream.pos();
+		const size_t size  = stream.size() - start;
+
+		// If the stream is a memory block already, we can read from it directly
+		MemoryReadStream *memStream = dynamic_cast<MemoryReadStream *>(&stream);
+		if (memStream) {
+			setData(memStream->getData() + start, size);
+			return;
+		}
+
+		_ownedData = new byte[size];
+		if (stream.read(_ownedData, size) != size)
+			throw Exception(kReadError);
+
+		setData(_ownedData, size);
+	}
+
+	/** Read one unit of data. */
+	static inline uint64 readUnit(const byte *data) {
+		if (kByteOrder)
+			return *data;
 
-	/** Read a data value. */
-	inline uint64 readData() {
 		if (isLE) {
-			if (valueBits ==  8)
-				return _stream->readByte();
 			if (valueBits == 16)
-				return _stream->readUint16LE();
+				return READ_LE_UINT16(data);
 			if (valueBits == 32)
-				return _stream->readUint32LE();
+				return READ_LE_UINT32(data);
 			if (valueBits == 64)
-				return _stream->readUint64LE();
+				return READ_LE_UINT64(data);
 		} else {
-			if (valueBits ==  8)
-				return _stream->readByte();
 			if (valueBits == 16)
-				return _stream->readUint16BE();
+				return READ_BE_UINT16(data);
 			if (valueBits == 32)
-				return _stream->readUint32BE();
+				return READ_BE_UINT32(data);
 			if (valueBits == 64)
-				return _stream->readUint64BE();
+				return READ_BE_UINT64(data);
 		}
 
 		assert(false);
 		return 0;
 	}
 
-	/** Read the next data value. */
-	inline void readValue() {
-		if ((size() - pos()) < valueBits)
-			throw Exception("BitStream::readValue(): End of bit stream reached");
+	/** Load as much data into the cache as fits. */
+	inline void refill() {
+		if (kByteOrder && ((_dataSize - _dataPos) >= 8)) {
+			// Load 8 bytes at once, and count as many whole bytes as fit into the cache
 
-		_value = readData();
+			if (_cacheBits > 56)
+				return;
 
-		// If we're reading the bits MSB first, we need to shift the value to that position
-		if (isMSB2LSB)
-			_value <<= 64 - valueBits;
+			if (isMSB2LSB)
+				_cache |= READ_BE_UINT64(_data + _dataPos) >> _cacheBits;
+			else
+				_cache |= READ_LE_UINT64(_data + _dataPos) << _cacheBits;
+
+			const size_t bytes = (64 - _cacheBits) >> 3;
+
+			_dataPos   += bytes;
+			_cacheBits += bytes * 8;
+			return;
 		}
 
+		while ((_cacheBits <= (64 - kUnitBits)) && ((_dataSize - _dataPos) >= kUnitSize)) {
+			const uint64 unit = readUnit(_data + _dataPos);
+
+			if (isMSB2LSB)
+				_cache |= unit << (64 - kUnitBits - _cacheBits);
+			else
+				_cache |= unit << _cacheBits;
+
+			_dataPos   += kUnitSize;
+			_cacheBits += kUnitBits;
+		}
+	}
+
+	/** Take n bits out of the cache. n must be within [1, 32] and not exceed _cacheBits. */
+	inline uint32 takeBits(size_t n) {
+		uint32 v;
+
+		if (isMSB2LSB) {
+			v = (uint32) (_cache >> (64 - n));
+			_cache <<= n;
+		} else {
+			v = (uint32) (_cache & ((((uint64) 1) << n) - 1));
+			_cache >>= n;
+		}
+
+		_cacheBits -= n;
+		return v;
+	}
+
+	/** Drop n bits out of the cache. n must not exceed _cacheBits. */
+	inline void dropBits(size_t n) {
+		if (n >= 64)
+			_cache = 0;
+		else if (isMSB2LSB)
+			_cache <<= n;
+		else
+			_cache >>= n;
+
+		_cacheBits -= n;
+	}
+
+	/** Read bits straddling two values, which can only happen with 64-bit values. */
+	uint32 getBitsSplit(size_t n) {
+		if ((size() - pos()) < n)
+			throw Exception("BitStream: End of bit stream reached");
+
+		const size_t first = _cacheBits;
+		const uint32 high  = (first > 0) ? takeBits(first) : 0;
+
+		refill();
+		const uint32 low = takeBits(n - first);
+
+		if (isMSB2LSB)
+			return (high << (n - first)) | low;
+
+		return high | (low << first);
+	}
+
 public:
-	/** Create a bit stream using this input data stream and optionally delete it on destruction. */
-	BitStreamImpl(SeekableReadStream *stream, bool disposeAfterUse = false) :
-		_stream(stream), _disposeAfterUse(disposeAfterUse), _value(0), _inValue(0) {
+	/** Create a bit reader on this block of memory. The memory is not copied. */
+	BitReaderImpl(const byte *data, size_t size) :
+		_stream(0), _disposeAfterUse(false), _ownedData(0) {
 
-		if ((valueBits != 8) && (valueBits != 16) && (valueBits != 32) && (valueBits != 64))
-			throw Exception("BitStream: Invalid memory layout %d, %d, %d", valueBits, isLE, isMSB2LSB);
+		checkLayout();
+		setData(data, size);
 	}
 
-	/** Create a bit stream using this input data stream. */
-	BitStreamImpl(SeekableReadStream &stream) :
-		_stream(&stream), _disposeAfterUse(false), _value(0), _inValue(0) {
+	/** Create a bit reader using this input data stream and optionally delete it on destruction.
+	 *
+	 *  The bits are read from the current position of the stream until its end.
+	 */
+	BitReaderImpl(SeekableReadStream *stream, bool disposeAfterUse = false) :
+		_stream(stream), _disposeAfterUse(disposeAfterUse), _ownedData(0) {
+
+		try {
+			checkLayout();
+			readStream(*_stream);
+		} catch (...) {
+			delete[] _ownedData;
+			if (_disposeAfterUse)
+				delete _stream;
+			throw;
+		}
+	}
 
-		if ((valueBits != 8) && (valueBits != 16) && (valueBits != 32) && (valueBits != 64))
-			throw Exception("BitStream: Invalid memory layout %d, %d, %d", valueBits, isLE, isMSB2LSB);
+	/** Create a bit reader using this input data stream.
+	 *
+	 *  The bits are read from the current position of the stream until its end.
+	 */
+	BitReaderImpl(SeekableReadStream &stream) :
+		_stream(&stream), _disposeAfterUse(false), _ownedData(0) {
+
+		try {
+			checkLayout();
+			readStream(*_stream);
+		} catch (...) {
+			delete[] _ownedData;
+			throw;
+		}
 	}
 
-	~BitStreamImpl() {
+	~BitReaderImpl() {
+		delete[] _ownedData;
+
 		if (_disposeAfterUse)
 			delete _stream;
 	}
 
 	/** Read a bit from the bit stream. */
-	uint32 getBit() {
-		// Check if we need the next value
-		if (_inValue == 0)
-			readValue();
+	inline uint32 getBit() {
+		if (_cacheBits == 0) {
+			refill();
 
-		// Get the current bit
-		int b = 0;
-		if (isMSB2LSB)
-			b = ((_value & 0x8000000000000000ULL) == 0) ? 0 : 1;
-		else
-			b = ((_value & 1) == 0) ? 0 : 1;
+			if (_cacheBits == 0)
+				throw Exception("BitStream: End of bit stream reached");
+		}
 
-		// Shift to the next bit
-		if (isMSB2LSB)
-			_value <<= 1;
-		else
-			_value >>= 1;
+		return takeBits(1);
+	}
 
-		// Increase the position within the current value
-		_inValue = (_inValue + 1) % valueBits;
+	/** Read a multi-bit value from the bit stream. */
+	inline uint32 getBits(size_t n) {
+		if (n > 32)
+			throw Exception("Too many bits requested to be read");
+
+		if (n == 0)
+			return 0;
 
-		return b;
+		if (_cacheBits < n) {
+			refill();
+
+			if (_cacheBits < n)
+				return getBitsSplit(n);
+		}
+
+		return takeBits(n);
 	}
 
-	/** Read a multi-bit value from the bit stream. */
-	uint32 getBits(size_t n) {
+	/** Read a multi-bit value from the bit stream, without consuming the bits.
+	 *
+	 *  Bits past the end of the stream are read as 0.
+	 */
+	inline uint32 peekBits(size_t n) {
 		if (n > 32)
 			throw Exception("Too many bits requested to be read");
 
-		// Read the number of bits
-		uint32 v = 0;
+		if (n == 0)
+			return 0;
 
-		if (isMSB2LSB) {
-			while (n-- > 0)
-				v = (v << 1) | getBit();
-		} else {
-			for (uint32 i = 0; i < n; i++)
-				v = (v >> 1) | (((uint32) getBit()) << 31);
+		if (_cacheBits < n)
+			refill();
+
+		// If the cache can't hold any more data, the bits past its end are all 0
+		if ((_cacheBits >= n) || ((_dataSize - _dataPos) < kUnitSize)) {
+			if (isMSB2LSB)
+				return (uint32) (_cache >> (64 - n));
 
-			v >>= (32 - n);
+			return (uint32) (_cache & ((((uint64) 1) << n) - 1));
 		}
 
+		// Otherwise, read across the value boundary and then go back to where we were
+
+		const size_t dataPos   = _dataPos;
+		const uint64 cache     = _cache;
+		const size_t cacheBits = _cacheBits;
+
+		const uint32 v = getBitsSplit(n);
+
+		_dataPos   = dataPos;
+		_cache     = cache;
+		_cacheBits = cacheBits;
+
 		return v;
 	}
 
 	/** Add a bit to the value x, making it an n-bit value. */
-	void addBit(uint32 &x, size_t n) {
+	inline void addBit(uint32 &x, size_t n) {
 		if (n > 32)
 			throw Exception("Too many bits requested to be read");
 
@@ -206,37 +397,129 @@ public:
 
 	/** Rewind the bit stream back to the start. */
 	void rewind() {
-		_stream->seek(0);
+		_dataPos = 0;
 
-		_value   = 0;
-		_inValue = 0;
+		_cache     = 0;
+		_cacheBits = 0;
 	}
 
 	/** Skip the specified amount of bits. */
-	void skip(size_t n) {
-		while (n-- > 0)
-			getBit();
+	inline void skip(size_t n) {
+		if (n <= _cacheBits) {
+			dropBits(n);
+			return;
+		}
+
+		if ((size() - pos()) < n)
+			throw Exception("BitStream: End of bit stream reached");
+
+		// Throw away the cache and skip over whole units directly in the data
+
+		n -= _cacheBits;
+
+		_cache     = 0;
+		_cacheBits = 0;
+
+		_dataPos += (n / kUnitBits) * kUnitSize;
+		n        %= kUnitBits;
+
+		// And consume the start of the next unit
+		if (n > 0) {
+			refill();
+			dropBits(n);
+		}
+	}
+
+	/** Are the bits handed out MSB to LSB? */
+	bool isMSBFirst() const {
+		return isMSB2LSB;
 	}
 
 	/** Return the stream position in bits. */
 	size_t pos() const {
-		if (_stream->pos() == 0)
-			return 0;
-
-		size_t p = (_inValue == 0) ? _stream->pos() : ((_stream->pos() - 1) & ~((size_t) ((valueBits >> 3) - 1)));
-		return p * 8 + _inValue;
+		return _dataPos * 8 - _cacheBits;
 	}
 
 	/** Return the stream size in bits. */
 	size_t size() const {
-		return (_stream->size() & ~((size_t) ((valueBits >> 3) - 1))) * 8;
+		return _dataSize * 8;
 	}
 
+	/** Has the end of the stream been reached? */
 	bool eos() const {
-		return _stream->eos() || (pos() >= size());
+		return pos() >= size();
 	}
 };
 
+/**
+ * A template implementing a bit stream for different data memory layouts.
+ *
+ * This wraps a BitReaderImpl with the same layout parameters in the generic
+ * BitStream interface.
+ */
+template<int valueBits, bool isLE, bool isMSB2LSB>
+class BitStreamImpl : public BitStream {
+public:
+	/** Create a bit stream on this block of memory. The memory is not copied. */
+	BitStreamImpl(const byte *data, size_t size) : _reader(data, size) {
+	}
+
+	/** Create a bit stream using this input data stream and optionally delete it on destruction. */
+	BitStreamImpl(SeekableReadStream *stream, bool disposeAfterUse = false) :
+		_reader(stream, disposeAfterUse) {
+	}
+
+	/** Create a bit stream using this input data stream. */
+	BitStreamImpl(SeekableReadStream &stream) : _reader(stream) {
+	}
+
+	~BitStreamImpl() {
+	}
+
+	uint32 getBit() {
+		return _reader.getBit();
+	}
+
+	uint32 getBits(size_t n) {
+		return _reader.getBits(n);
+	}
+
+	uint32 peekBits(size_t n) {
+		return _reader.peekBits(n);
+	}
+
+	void addBit(uint32 &x, size_t n) {
+		_reader.addBit(x, n);
+	}
+
+	void rewind() {
+		_reader.rewind();
+	}
+
+	void skip(size_t n) {
+		_reader.skip(n);
+	}
+
+	bool isMSBFirst() const {
+		return _reader.isMSBFirst();
+	}
+
+	size_t pos() const {
+		return _reader.pos();
+	}
+
+	size_t size() const {
+		return _reader.size();
+	}
+
+	bool eos() const {
+		return _reader.eos();
+	}
+
+private:
+	BitReaderImpl<valueBits, isLE, isMSB2LSB> _reader;
+};
+
 // typedefs for various memory layouts.
 
 /** 8-bit data, MSB to LSB. */
@@ -271,6 +554,39 @@ typedef BitStreamImpl<64, false, true > BitStream64BEMSB;
 /** 64-bit big-endian data, LSB to MSB. */
 typedef BitStreamImpl<64, false, false> BitStream64BELSB;
 
+
+/** 8-bit data, MSB to LSB. */
+typedef BitReaderImpl<8, false, true > BitReader8MSB;
+/** 8-bit data, LSB to MSB. */
+typedef BitReaderImpl<8, false, false> BitReader8LSB;
+
+/** 16-bit little-endian data, MSB to LSB. */
+typedef BitReaderImpl<16, true , true > BitReader16LEMSB;
+/** 16-bit little-endian data, LSB to MSB. */
+typedef BitReaderImpl<16, true , false> BitReader16LELSB;
+/** 16-bit big-endian data, MSB to LSB. */
+typedef BitReaderImpl<16, false, true > BitReader16BEMSB;
+/** 16-bit big-endian data, LSB to MSB. */
+typedef BitReaderImpl<16, false, false> BitReader16BELSB;
+
+/** 32-bit little-endian data, MSB to LSB. */
+typedef BitReaderImpl<32, true , true > BitReader32LEMSB;
+/** 32-bit little-endian data, LSB to MSB. */
+typedef BitReaderImpl<32, true , false> BitReader32LELSB;
+/** 32-bit big-endian data, MSB to LSB. */
+typedef BitReaderImpl<32, false, true > BitReader32BEMSB;
+/** 32-bit big-endian data, LSB to MSB. */
+typedef BitReaderImpl<32, false, false> BitReader32BELSB;
+
+/** 64-bit little-endian data, MSB to LSB. */
+typedef BitReaderImpl<64, true , true > BitReader64LEMSB;
+/** 64-bit little-endian data, LSB to MSB. */
+typedef BitReaderImpl<64, true , false> BitReader64LELSB;
+/** 64-bit big-endian data, MSB to LSB. */
+typedef BitReaderImpl<64, false, true > BitReader64BEMSB;
+/** 64-bit big-endian data, LSB to MSB. */
+typedef BitReaderImpl<64, false, false> BitReader64BELSB;
+
 } // End of namespace Common
 
 #endif // COMMON_BITSTREAM_H
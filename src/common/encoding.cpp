@@ -32,6 +32,7 @@
 #include "src/common/encoding.h"
 #include "src/common/error.h"
 #include "src/common/singleton.h"
+#include "src/common/mutex.h"
 #include "src/common/ustring.h"
 #include "src/common/memreadstream.h"
 #include "src/common/writestream.h"
@@ -86,6 +87,8 @@ public:
 		if (((size_t) encoding) >= kEncodingMAX)
 			throw Exception("Invalid encoding %d", encoding);
 
+		Common::StackLock lock(_mutex);
+
 		return convert(_contextFrom[encoding], data, n, kEncodingGrowthFrom[encoding], 1);
 	}
 
@@ -93,6 +96,8 @@ public:
 		if (((size_t) encoding) >= kEncodingMAX)
 			throw Exception("Invalid encoding %d", encoding);
 
+		Common::StackLock lock(_mutex);
+
 		return convert(_contextTo[encoding], str, kEncodingGrowthTo[encoding],
 		               terminate ? kTerminatorLength[encoding] : 0);
 	}
@@ -101,6 +106,9 @@ private:
 	iconv_t _contextFrom[kEncodingMAX];
 	iconv_t _contextTo  [kEncodingMAX];
 
+	/** The iconv contexts carry state, so only one conversion may run at a time. */
+	Mutex _mutex;
+
 	byte *doConvert(iconv_t &ctx, byte *data, size_t nIn, size_t nOut, size_t &size) {
 		size_t inBytes  = nIn;
 		size_t outBytes = nOut;
@@ -345,6 +353,10 @@ MemoryReadStream *convertString(const UString &str, Encoding encoding, bool term
 	return ConvMan.convert(encoding, str, terminateString);
 }
 
+void initEncodings() {
+	ConvMan;
+}
+
 size_t getBytesPerCodepoint(Encoding encoding) {
 	switch (encoding) {
 		case kEncodingASCII:
@@ -79,6 +79,13 @@ void writeStringFixed(WriteStream &stream, const Common::UString &str, Encoding
 /** Convert a string into the given encoding. */
 MemoryReadStream *convertString(const UString &str, Encoding encoding, bool terminateString = true);
 
+/** Set up the encoding conversion.
+ *
+ *  This happens automatically on the first conversion, but it has to be done
+ *  explicitly before strings are first converted by several threads at once.
+ */
+void initEncodings();
+
 /** Return the number of bytes per codepoint in this encoding.
  *
  *  Note: This will throw on encodings with a variable number of bytes per codepoint.
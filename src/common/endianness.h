@@ -313,7 +313,7 @@ static inline uint16 SWAP_BYTES_16(const uint16 a) {
 			const uint8 *b = static_cast<const uint8 *>(ptr);
 			return ((uint32)b[0] << 24) | ((uint32)b[1] << 16) | ((uint32)b[2] << 8) | ((uint32)b[3]);
 		}
-		static inline uint32 READ_BE_UINT64(const void *ptr) {
+		static inline uint64 READ_BE_UINT64(const void *ptr) {
 			const uint8 *b = static_cast<const uint8 *>(ptr);
 			return ((uint64)b[0] << 56) | ((uint64)b[1] << 48) | ((uint64)b[2] << 40) | ((uint64)b[3] << 32) |
 			       ((uint64)b[4] << 24) | ((uint64)b[5] << 16) | ((uint64)b[6] <<  8) | ((uint64)b[7]);
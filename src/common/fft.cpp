@@ -30,11 +30,19 @@
 #include <cassert>
 #include <cstring>
 
+#include <SDL_cpuinfo.h>
+
 #include "src/common/maths.h"
 #include "src/common/cosinetables.h"
 #include "src/common/util.h"
 #include "src/common/fft.h"
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+	#define XOREOS_FFT_SSE 1
+
+	#include <xmmintrin.h>
+#endif
+
 namespace Common {
 
 FFT::FFT(int bits, bool inverse) : _bits(bits), _inverse(inverse) {
@@ -50,6 +58,8 @@ FFT::FFT(int bits, bool inverse) : _bits(bits), _inverse(inverse) {
 
 	for (int i = 0; i < n; i++)
 		_revTab[-splitRadixPermutation(i, n, _inverse) & (n - 1)] = i;
+
+	_calc = getCalc();
 }
 
 FFT::~FFT() {
@@ -172,15 +182,102 @@ PASS(pass)
 #define BUTTERFLIES BUTTERFLIES_BIG
 PASS(pass_big)
 
-#define DECL_FFT(t,n,n2,n4)\
+/** The plain C++ split-radix passes. These are the reference implementation. */
+struct PassesScalar {
+	static void small(Complex *z, const float *wre, unsigned int n) {
+		pass(z, wre, n);
+	}
+
+	static void big(Complex *z, const float *wre, unsigned int n) {
+		pass_big(z, wre, n);
+	}
+};
+
+#ifdef XOREOS_FFT_SSE
+
+/** A split-radix pass doing two complex values at once, with SSE.
+ *
+ *  This is the same sequence of operations as TRANSFORM(), so it
+ *  produces the same results as the plain C++ pass, apart from the
+ *  sign of a zero.
+ */
+static void pass_sse(Complex *z, const float *wre, unsigned int n)
+{
+	float t1, t2, t3, t4, t5, t6;
+	int o1 = 2*n;
+	int o2 = 4*n;
+	int o3 = 6*n;
+	const float *wim = wre+o1;
+	n--;
+
+	// The first pair needs the untwiddled transform
+	TRANSFORM_ZERO(z[0],z[o1],z[o2],z[o3]);
+	TRANSFORM(z[1],z[o1+1],z[o2+1],z[o3+1],wre[1],wim[-1]);
+
+	// Negate the real or imaginary parts
+	const __m128 negRe = _mm_set_ps(0.0f, -0.0f, 0.0f, -0.0f);
+	const __m128 negIm = _mm_set_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+
+	do {
+		z += 2;
+		wre += 2;
+		wim -= 2;
+
+		const __m128 cosW = _mm_set_ps(wre[ 1], wre[ 1], wre[0], wre[0]);
+		const __m128 sinW = _mm_set_ps(wim[-1], wim[-1], wim[0], wim[0]);
+
+		const __m128 a0 = _mm_loadu_ps(&z[0 ].re);
+		const __m128 a1 = _mm_loadu_ps(&z[o1].re);
+		const __m128 a2 = _mm_loadu_ps(&z[o2].re);
+		const __m128 a3 = _mm_loadu_ps(&z[o3].re);
+
+		// Swap the real and imaginary parts
+		const __m128 a2s = _mm_shuffle_ps(a2, a2, _MM_SHUFFLE(2, 3, 0, 1));
+		const __m128 a3s = _mm_shuffle_ps(a3, a3, _MM_SHUFFLE(2, 3, 0, 1));
+
+		// (t1, t2) = a2 * conj(w), (t5, t6) = a3 * w
+		const __m128 t12 = _mm_add_ps(_mm_mul_ps(a2, cosW), _mm_xor_ps(_mm_mul_ps(a2s, sinW), negIm));
+		const __m128 t56 = _mm_add_ps(_mm_mul_ps(a3, cosW), _mm_xor_ps(_mm_mul_ps(a3s, sinW), negRe));
+
+		const __m128 sum  = _mm_add_ps(t56, t12);
+		const __m128 diff = _mm_sub_ps(t56, t12);
+
+		// diff * i
+		const __m128 diffI = _mm_xor_ps(_mm_shuffle_ps(diff, diff, _MM_SHUFFLE(2, 3, 0, 1)), negRe);
+
+		_mm_storeu_ps(&z[0 ].re, _mm_add_ps(a0, sum));
+		_mm_storeu_ps(&z[o2].re, _mm_sub_ps(a0, sum));
+		_mm_storeu_ps(&z[o1].re, _mm_add_ps(a1, diffI));
+		_mm_storeu_ps(&z[o3].re, _mm_sub_ps(a1, diffI));
+	} while (--n);
+}
+
+/** The split-radix passes, vectorized with SSE. */
+struct PassesSSE {
+	static void small(Complex *z, const float *wre, unsigned int n) {
+		pass_sse(z, wre, n);
+	}
+
+	static void big(Complex *z, const float *wre, unsigned int n) {
+		pass_sse(z, wre, n);
+	}
+};
+
+#endif // XOREOS_FFT_SSE
+
+#define DECL_FFT(t,n,n2,n4,pass)\
+template<class Passes>\
 static void fft##n(Complex *z)\
 {\
-	fft##n2(z);\
-	fft##n4(z+n4*2);\
-	fft##n4(z+n4*3);\
-	pass(z,getCosineTable(t),n4/2);\
+	fft##n2<Passes>(z);\
+	fft##n4<Passes>(z+n4*2);\
+	fft##n4<Passes>(z+n4*3);\
+	Passes::pass(z,getCosineTable(t),n4/2);\
 }
 
+// The smallest transforms are always done without the passes
+
+template<class Passes>
 static void fft4(Complex *z)
 {
 	float t1, t2, t3, t4, t5, t6, t7, t8;
@@ -195,11 +292,12 @@ static void fft4(Complex *z)
 	BF(z[2].im, z[0].im, t2, t5);
 }
 
+template<class Passes>
 static void fft8(Complex *z)
 {
 	float t1, t2, t3, t4, t5, t6, t7, t8;
 
-	fft4(z);
+	fft4<Passes>(z);
 
 	BF(t1, z[5].re, z[4].re, -z[5].re);
 	BF(t2, z[5].im, z[4].im, -z[5].im);
@@ -215,13 +313,14 @@ static void fft8(Complex *z)
 	TRANSFORM(z[1],z[3],z[5],z[7],sqrthalf,sqrthalf);
 }
 
+template<class Passes>
 static void fft16(Complex *z)
 {
 	float t1, t2, t3, t4, t5, t6;
 
-	fft8(z);
-	fft4(z+8);
-	fft4(z+12);
+	fft8<Passes>(z);
+	fft4<Passes>(z+8);
+	fft4<Passes>(z+12);
 
 	const float * const cosTable = getCosineTable(4);
 
@@ -231,27 +330,41 @@ static void fft16(Complex *z)
 	TRANSFORM(z[3],z[7],z[11],z[15],cosTable[3],cosTable[1]);
 }
 
-DECL_FFT(5, 32,16,8)
-DECL_FFT(6, 64,32,16)
-DECL_FFT(7, 128,64,32)
-DECL_FFT(8, 256,128,64)
-DECL_FFT(9, 512,256,128)
-#define pass pass_big
-DECL_FFT(10, 1024,512,256)
-DECL_FFT(11, 2048,1024,512)
-DECL_FFT(12, 4096,2048,1024)
-DECL_FFT(13, 8192,4096,2048)
-DECL_FFT(14, 16384,8192,4096)
-DECL_FFT(15, 32768,16384,8192)
-DECL_FFT(16, 65536,32768,16384)
-
-static void (* const fft_dispatch[])(Complex*) = {
-	fft4, fft8, fft16, fft32, fft64, fft128, fft256, fft512, fft1024,
-	fft2048, fft4096, fft8192, fft16384, fft32768, fft65536,
-};
+DECL_FFT(5, 32,16,8, small)
+DECL_FFT(6, 64,32,16, small)
+DECL_FFT(7, 128,64,32, small)
+DECL_FFT(8, 256,128,64, small)
+DECL_FFT(9, 512,256,128, small)
+DECL_FFT(10, 1024,512,256, big)
+DECL_FFT(11, 2048,1024,512, big)
+DECL_FFT(12, 4096,2048,1024, big)
+DECL_FFT(13, 8192,4096,2048, big)
+DECL_FFT(14, 16384,8192,4096, big)
+DECL_FFT(15, 32768,16384,8192, big)
+DECL_FFT(16, 65536,32768,16384, big)
+
+template<class Passes>
+static void fft_dispatch(Complex *z, int bits) {
+	static void (* const dispatch[])(Complex*) = {
+		fft4<Passes>, fft8<Passes>, fft16<Passes>, fft32<Passes>, fft64<Passes>,
+		fft128<Passes>, fft256<Passes>, fft512<Passes>, fft1024<Passes>, fft2048<Passes>,
+		fft4096<Passes>, fft8192<Passes>, fft16384<Passes>, fft32768<Passes>, fft65536<Passes>,
+	};
+
+	dispatch[bits - 2](z);
+}
+
+FFT::CalcFunc FFT::getCalc() {
+#ifdef XOREOS_FFT_SSE
+	if (SDL_HasSSE())
+		return &fft_dispatch<PassesSSE>;
+#endif
+
+	return &fft_dispatch<PassesScalar>;
+}
 
 void FFT::calc(Complex *z) {
-	fft_dispatch[_bits - 2](z);
+	_calc(z, _bits);
 }
 
 } // End of namespace Common
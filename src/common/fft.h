@@ -55,6 +55,8 @@ public:
 	void calc(Complex *z);
 
 private:
+	typedef void (*CalcFunc)(Complex *z, int bits);
+
 	int  _bits;
 	bool _inverse;
 
@@ -65,7 +67,13 @@ private:
 
 	int _splitRadix;
 
+	/** The transform implementation best suited for this CPU. */
+	CalcFunc _calc;
+
 	static int splitRadixPermutation(int i, int n, bool inverse);
+
+	/** Pick the vectorized transform if the CPU supports it, the plain C++ one otherwise. */
+	static CalcFunc getCalc();
 };
 
 } // End of namespace Common
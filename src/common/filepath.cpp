@@ -23,6 +23,7 @@
  */
 
 #include <list>
+#include <ctime>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem.hpp>
@@ -40,6 +41,7 @@ using boost::filesystem::exists;
 using boost::filesystem::is_regular_file;
 using boost::filesystem::is_directory;
 using boost::filesystem::file_size;
+using boost::filesystem::last_write_time;
 using boost::filesystem::directory_iterator;
 using boost::filesystem::create_directories;
 
@@ -66,6 +68,16 @@ size_t FilePath::getFileSize(const UString &p) {
 	return size;
 }
 
+uint64 FilePath::getModificationTime(const UString &p) {
+	boost::system::error_code error;
+
+	std::time_t time = last_write_time(p.c_str(), error);
+	if (error || (time <= 0))
+		return 0;
+
+	return (uint64) time;
+}
+
 UString FilePath::getFile(const UString &p) {
 	path file(p.c_str());
 
@@ -58,6 +58,13 @@ public:
 	 */
 	static size_t getFileSize(const UString &p);
 
+	/** Return the time a file was last modified.
+	 *
+	 *  @param  p The file to look up.
+	 *  @return The modification time in seconds since the epoch, or 0 if not a valid file.
+	 */
+	static uint64 getModificationTime(const UString &p);
+
 	/** Return a file name without its path.
 	 *
 	 *  Example: "/path/to/file.ext" > "file.ext"
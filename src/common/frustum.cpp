@@ -0,0 +1,103 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A view frustum.
+ */
+
+/* The plane extraction follows Gribb and Hartmann, "Fast Extraction of
+ * Viewing Frustum Planes from the World-View-Projection Matrix".
+ */
+
+#include <cstring>
+
+#include "src/common/frustum.h"
+#include "src/common/transmatrix.h"
+#include "src/common/boundingbox.h"
+
+namespace Common {
+
+Frustum::Frustum() {
+	// Planes that contain everything
+	std::memset(_planes, 0, sizeof(_planes));
+}
+
+Frustum::~Frustum() {
+}
+
+void Frustum::setMatrix(const TransformationMatrix &m) {
+	for (int i = 0; i < 4; i++) {
+		_planes[kPlaneLeft  ][i] = m(3, i) + m(0, i);
+		_planes[kPlaneRight ][i] = m(3, i) - m(0, i);
+		_planes[kPlaneBottom][i] = m(3, i) + m(1, i);
+		_planes[kPlaneTop   ][i] = m(3, i) - m(1, i);
+		_planes[kPlaneNear  ][i] = m(3, i) + m(2, i);
+		_planes[kPlaneFar   ][i] = m(3, i) - m(2, i);
+	}
+}
+
+void Frustum::transform(const TransformationMatrix &m) {
+	/* A point p in local coordinates is m * p in our coordinates. So for
+	 * each plane n, n * (m * p) = (transposed(m) * n) * p. */
+
+	for (int i = 0; i < kPlaneMAX; i++) {
+		float plane[4];
+
+		for (int j = 0; j < 4; j++)
+			plane[j] = _planes[i][0] * m(0, j) + _planes[i][1] * m(1, j) +
+			           _planes[i][2] * m(2, j) + _planes[i][3] * m(3, j);
+
+		std::memcpy(_planes[i], plane, sizeof(plane));
+	}
+}
+
+bool Frustum::isIn(float x, float y, float z) const {
+	for (int i = 0; i < kPlaneMAX; i++)
+		if ((_planes[i][0] * x + _planes[i][1] * y + _planes[i][2] * z + _planes[i][3]) < 0.0f)
+			return false;
+
+	return true;
+}
+
+bool Frustum::isIn(const BoundingBox &box) const {
+	if (box.empty())
+		return true;
+
+	float min[3], max[3];
+	box.getMin(min[0], min[1], min[2]);
+	box.getMax(max[0], max[1], max[2]);
+
+	/* For each plane, check the corner of the box that lies the farthest
+	 * in the direction of the plane's normal. If even that one is outside,
+	 * the whole box is. */
+
+	for (int i = 0; i < kPlaneMAX; i++) {
+		const float x = (_planes[i][0] >= 0.0f) ? max[0] : min[0];
+		const float y = (_planes[i][1] >= 0.0f) ? max[1] : min[1];
+		const float z = (_planes[i][2] >= 0.0f) ? max[2] : min[2];
+
+		if ((_planes[i][0] * x + _planes[i][1] * y + _planes[i][2] * z + _planes[i][3]) < 0.0f)
+			return false;
+	}
+
+	return true;
+}
+
+} // End of namespace Common
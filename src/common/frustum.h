@@ -0,0 +1,85 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A view frustum.
+ */
+
+#ifndef COMMON_FRUSTUM_H
+#define COMMON_FRUSTUM_H
+
+namespace Common {
+
+class TransformationMatrix;
+class BoundingBox;
+
+/** A view frustum, described by its six clipping planes.
+ *
+ *  The planes are extracted from a combined projection and modelview
+ *  matrix, so the frustum lives in the coordinate system the modelview
+ *  matrix transforms from (usually world space).
+ *
+ *  All tests are conservative: an object that is reported to be outside
+ *  is guaranteed to be invisible, but an object near the edges of the
+ *  frustum might be reported as inside even though it isn't.
+ */
+class Frustum {
+public:
+	Frustum();
+	~Frustum();
+
+	/** Extract the clipping planes out of the matrix projection * modelview. */
+	void setMatrix(const TransformationMatrix &m);
+
+	/** Move the frustum into a local coordinate system.
+	 *
+	 *  m transforms from the local coordinate system into the current one,
+	 *  for example the absolute position of a model. Afterwards, the frustum
+	 *  can be tested against points and boxes in the local coordinates.
+	 */
+	void transform(const TransformationMatrix &m);
+
+	/** Is that point within the frustum? */
+	bool isIn(float x, float y, float z) const;
+
+	/** Is the box, at least partially, within the frustum?
+	 *
+	 *  An empty box is always considered to be within the frustum.
+	 */
+	bool isIn(const BoundingBox &box) const;
+
+private:
+	enum Plane {
+		kPlaneLeft   = 0,
+		kPlaneRight     ,
+		kPlaneBottom    ,
+		kPlaneTop       ,
+		kPlaneNear      ,
+		kPlaneFar       ,
+		kPlaneMAX
+	};
+
+	/** The planes (a, b, c, d), with ax + by + cz + d >= 0 for points inside. */
+	float _planes[kPlaneMAX][4];
+};
+
+} // End of namespace Common
+
+#endif // COMMON_FRUSTUM_H
@@ -24,6 +24,9 @@
 
 #include <cassert>
 
+#include <algorithm>
+#include <map>
+
 #include "src/common/huffman.h"
 #include "src/common/util.h"
 #include "src/common/error.h"
@@ -31,7 +34,18 @@
 
 namespace Common {
 
-Huffman::Symbol::Symbol(uint32 c, uint32 s) : code(c), symbol(s) {
+Huffman::Code::Code(uint32 c, uint8 l, uint32 i) : code(c), length(l), index(i) {
+}
+
+bool Huffman::Code::operator<(const Code &right) const {
+	if (length != right.length)
+		return length < right.length;
+
+	return index < right.index;
+}
+
+
+Huffman::TableEntry::TableEntry() : value(0), length(0) {
 }
 
 
@@ -59,18 +73,90 @@ void Huffman::init(uint8 maxLength, size_t codeCount, const uint32 *codes,
 
 	assert(maxLength <= 32);
 
-	_codes.resize(maxLength);
 	_symbols.resize(codeCount);
+	setSymbols(symbols);
+
+	Codes sortedCodes;
+	sortedCodes.reserve(codeCount);
 
 	for (size_t i = 0; i < codeCount; i++) {
-		// The symbol. If none were specified, just assume it's identical to the code index
-		uint32 symbol = symbols ? symbols[i] : i;
+		assert(lengths[i] <= 32);
 
-		// Put the code and symbol into the correct list
-		_codes[lengths[i] - 1].push_back(Symbol(codes[i], symbol));
+		// Codes that don't fit into their length can never be found
+		if ((lengths[i] == 0) || ((lengths[i] < 32) && ((codes[i] >> lengths[i]) != 0)))
+			continue;
 
-		// And put the pointer to the symbol/code struct into the symbol list.
-		_symbols[i] = &_codes[lengths[i] - 1].back();
+		sortedCodes.push_back(Code(codes[i], lengths[i], i));
+	}
+
+	std::sort(sortedCodes.begin(), sortedCodes.end());
+
+	_tableBits = MAX<uint8>(MIN(maxLength, kMaxTableBits), 1);
+
+	_tableMSB.resize(1 << _tableBits);
+	_tableLSB.resize(1 << _tableBits);
+
+	buildTable(_tableMSB, 0, _tableBits, sortedCodes, true);
+	buildTable(_tableLSB, 0, _tableBits, sortedCodes, false);
+}
+
+void Huffman::buildTable(Table &table, size_t offset, uint8 tableBits,
+                         const Codes &codes, bool msbFirst) {
+
+	/* Codes longer than the table are grouped by their first tableBits bits.
+	 * Each group gets a sub-table for the rest of their bits. */
+
+	typedef std::map<uint32, Codes> SubCodes;
+	SubCodes subCodes;
+
+	const uint32 tableMask = (1 << tableBits) - 1;
+
+	for (Codes::const_iterator c = codes.begin(); c != codes.end(); ++c) {
+		if (c->length <= tableBits)
+			continue;
+
+		const uint8  restLength = c->length - tableBits;
+		const uint32 restMask   = (((uint32) 1) << restLength) - 1;
+
+		if (msbFirst)
+			subCodes[c->code >> restLength].push_back(Code(c->code & restMask, restLength, c->index));
+		else
+			subCodes[c->code & tableMask].push_back(Code(c->code >> tableBits, restLength, c->index));
+	}
+
+	for (SubCodes::const_iterator s = subCodes.begin(); s != subCodes.end(); ++s) {
+		uint8 maxLength = 0;
+		for (Codes::const_iterator c = s->second.begin(); c != s->second.end(); ++c)
+			maxLength = MAX(maxLength, c->length);
+
+		const uint8  subBits   = MIN(maxLength, kMaxTableBits);
+		const size_t subOffset = table.size();
+
+		table.resize(subOffset + (1 << subBits));
+
+		table[offset + s->first].value  = subOffset;
+		table[offset + s->first].length = - ((int32) subBits);
+
+		buildTable(table, subOffset, subBits, s->second, msbFirst);
+	}
+
+	/* Fill in the codes that fit into this table. A code shorter than the table
+	 * fills all entries starting with that code. We go backwards, so that when
+	 * codes collide, the shortest and first one wins, like in a linear search. */
+
+	for (Codes::const_reverse_iterator c = codes.rbegin(); c != codes.rend(); ++c) {
+		if (c->length > tableBits)
+			continue;
+
+		const uint8  freeBits = tableBits - c->length;
+		const uint32 fill     = 1 << freeBits;
+
+		for (uint32 i = 0; i < fill; i++) {
+			const uint32 index = msbFirst ? ((c->code << freeBits) | i) : (c->code | (i << c->length));
+
+			table[offset + index].value  = c->index;
+			table[offset + index].length = c->length;
+		}
 	}
 }
 
@@ -79,21 +165,11 @@ Huffman::~Huffman() {
 
 void Huffman::setSymbols(const uint32 *symbols) {
 	for (size_t i = 0; i < _symbols.size(); i++)
-		_symbols[i]->symbol = symbols ? *symbols++ : i;
+		_symbols[i] = symbols ? *symbols++ : i;
 }
 
 uint32 Huffman::getSymbol(BitStream &bits) const {
-	uint32 code = 0;
-
-	for (size_t i = 0; i < _codes.size(); i++) {
-		bits.addBit(code, i);
-
-		for (CodeList::const_iterator cCode = _codes[i].begin(); cCode != _codes[i].end(); ++cCode)
-			if (code == cCode->code)
-				return cCode->symbol;
-	}
-
-	throw Exception("Unknown Huffman code");
+	return getSymbol<BitStream>(bits);
 }
 
 } // End of namespace Common
@@ -26,9 +26,9 @@
 #define COMMON_HUFFMAN_H
 
 #include <vector>
-#include <list>
 
 #include "src/common/types.h"
+#include "src/common/error.h"
 
 namespace Common {
 
@@ -43,7 +43,17 @@ struct HuffmanTable {
 	const uint32 *symbols; ///< The symbols, 0 if identical to the codes.
 };
 
-/** Decode a Huffman'd bitstream. */
+/** Decode a Huffman'd bitstream.
+ *
+ *  Decoding is table-driven: the next few bits of the stream are peeked at
+ *  and looked up in a table, which either directly yields the symbol and the
+ *  length of its code, or points to a sub-table for the following bits of a
+ *  longer code. A symbol is therefore found in one or two lookups for most
+ *  codes, instead of a bit-by-bit search.
+ *
+ *  Since the first bit of a code is the highest bit in MSB-first bit streams
+ *  and the lowest bit in LSB-first ones, the tables are built for both kinds.
+ */
 class Huffman {
 public:
 	/** Construct a Huffman decoder.
@@ -65,26 +75,82 @@ public:
 	/** Return the next symbol in the bitstream. */
 	uint32 getSymbol(BitStream &bits) const;
 
+	/** Return the next symbol in the bit reader.
+	 *
+	 *  This works on any class with the interface of a BitStream, without
+	 *  needing virtual calls, e.g. a concrete BitReaderImpl.
+	 */
+	template<class BitReader>
+	uint32 getSymbol(BitReader &bits) const {
+		const Table &table = bits.isMSBFirst() ? _tableMSB : _tableLSB;
+
+		size_t offset    = 0;
+		uint8  tableBits = _tableBits;
+
+		while (true) {
+			const TableEntry &entry = table[offset + bits.peekBits(tableBits)];
+
+			if (entry.length > 0) {
+				bits.skip(entry.length);
+
+				return _symbols[entry.value];
+			}
+
+			if (entry.length == 0)
+				break;
+
+			// Descend into the sub-table for the following bits
+			bits.skip(tableBits);
+
+			offset    = entry.value;
+			tableBits = -entry.length;
+		}
+
+		throw Exception("Unknown Huffman code");
+	}
+
 private:
-	struct Symbol {
-		uint32 code;
-		uint32 symbol;
+	/** The maximum number of bits looked up in one table. */
+	static const uint8 kMaxTableBits = 9;
+
+	/** A code, as used while building the tables. */
+	struct Code {
+		uint32 code;   ///< The code.
+		uint8  length; ///< The length of the code.
+		uint32 index;  ///< The index of the code.
+
+		Code(uint32 c, uint8 l, uint32 i);
 
-		Symbol(uint32 c, uint32 s);
+		bool operator<(const Code &right) const;
 	};
 
-	typedef std::list<Symbol>     CodeList;
-	typedef std::vector<CodeList> CodeLists;
-	typedef std::vector<Symbol *> SymbolList;
+	/** An entry in a lookup table. */
+	struct TableEntry {
+		/** If length > 0, the index of the code. If length < 0, the offset of the sub-table. */
+		uint32 value;
+		/** Length of the code if > 0, negated number of bits of the sub-table if < 0, 0 if invalid. */
+		int32 length;
 
-	/** Lists of codes and their symbols, sorted by code length. */
-	CodeLists _codes;
+		TableEntry();
+	};
+
+	typedef std::vector<Code>       Codes;
+	typedef std::vector<TableEntry> Table;
+
+	uint8 _tableBits; ///< Number of bits looked up in the first-level table.
 
-	/** Sorted list of pointers to the symbols. */
-	SymbolList _symbols;
+	Table _tableMSB; ///< Lookup tables for MSB-first bit streams.
+	Table _tableLSB; ///< Lookup tables for LSB-first bit streams.
+
+	/** The symbols, by code index. */
+	std::vector<uint32> _symbols;
 
 	void init(uint8 maxLength, size_t codeCount, const uint32 *codes,
 	          const uint8 *lengths, const uint32 *symbols);
+
+	/** Build a lookup table for these codes, appending it to the table vector. */
+	static void buildTable(Table &table, size_t offset, uint8 tableBits,
+	                       const Codes &codes, bool msbFirst);
 };
 
 } // End of namespace Common
@@ -0,0 +1,304 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Implementing the stream reading interfaces for memory-mapped files.
+ */
+
+#include "src/common/system.h"
+
+#if defined(WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+
+	#define XOREOS_HAVE_FILE_MAPPING 1
+#elif defined(HAVE_SYS_MMAN_H) && defined(HAVE_MMAP)
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+
+	#define XOREOS_HAVE_FILE_MAPPING 1
+#endif
+
+#include <cstring>
+
+#include <boost/filesystem/path.hpp>
+
+#include "src/common/mappedfile.h"
+#include "src/common/memreadstream.h"
+#include "src/common/error.h"
+#include "src/common/ustring.h"
+
+namespace Common {
+
+/** The platform-specific memory mapping of a whole file. */
+class MappedFile::Mapping : NonCopyable {
+public:
+	Mapping() : _data(0), _size(0) {
+#if defined(WIN32)
+		_mapping = 0;
+#endif
+	}
+
+	~Mapping() {
+		unmap();
+	}
+
+	bool map(const UString &fileName);
+
+	const byte *getData() const {
+		return _data;
+	}
+
+	size_t getSize() const {
+		return _size;
+	}
+
+private:
+	const byte *_data;
+	size_t      _size;
+
+#if defined(WIN32)
+	HANDLE _mapping;
+#endif
+
+	void unmap();
+};
+
+#if defined(WIN32)
+
+bool MappedFile::Mapping::map(const UString &fileName) {
+	HANDLE file = CreateFileW(boost::filesystem::path(fileName.c_str()).c_str(), GENERIC_READ, FILE_SHARE_READ,
+	                          0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart <= 0) || (fileSize.QuadPart > 0x7FFFFFFF)) {
+		CloseHandle(file);
+		return false;
+	}
+
+	_mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	CloseHandle(file);
+
+	if (!_mapping)
+		return false;
+
+	_data = static_cast<const byte *>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!_data) {
+		CloseHandle(_mapping);
+		_mapping = 0;
+
+		return false;
+	}
+
+	_size = (size_t) fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::Mapping::unmap() {
+	if (_data)
+		UnmapViewOfFile(_data);
+	if (_mapping)
+		CloseHandle(_mapping);
+
+	_data    = 0;
+	_size    = 0;
+	_mapping = 0;
+}
+
+#elif defined(XOREOS_HAVE_FILE_MAPPING)
+
+bool MappedFile::Mapping::map(const UString &fileName) {
+	int fd = ::open(boost::filesystem::path(fileName.c_str()).c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat fileStat;
+	if ((fstat(fd, &fileStat) != 0) || !S_ISREG(fileStat.st_mode) ||
+	    (fileStat.st_size <= 0) || ((uint64) fileStat.st_size > (uint64) 0x7FFFFFFFULL)) {
+
+		::close(fd);
+		return false;
+	}
+
+	void *data = mmap(0, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping stays valid after closing the file descriptor
+	::close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	_data = static_cast<const byte *>(data);
+	_size = (size_t) fileStat.st_size;
+
+	return true;
+}
+
+void MappedFile::Mapping::unmap() {
+	if (_data)
+		munmap(const_cast<byte *>(_data), _size);
+
+	_data = 0;
+	_size = 0;
+}
+
+#else
+
+bool MappedFile::Mapping::map(const UString &UNUSED(fileName)) {
+	return false;
+}
+
+void MappedFile::Mapping::unmap() {
+}
+
+#endif
+
+
+/** A view into a memory mapping, keeping that mapping alive. */
+class MappedReadStream : public MemoryReadStream {
+public:
+	MappedReadStream(const boost::shared_ptr<MappedFile::Mapping> &mapping, const byte *dataPtr, size_t dataSize) :
+		MemoryReadStream(dataPtr, dataSize, false), _mapping(mapping) {
+	}
+
+	~MappedReadStream() {
+	}
+
+private:
+	boost::shared_ptr<MappedFile::Mapping> _mapping;
+};
+
+
+MappedFile::MappedFile() : _data(0), _size(kSizeInvalid), _pos(0), _eos(false) {
+}
+
+MappedFile::MappedFile(const UString &fileName) : _data(0), _size(kSizeInvalid), _pos(0), _eos(false) {
+	if (!open(fileName))
+		throw Exception("Can't map file \"%s\"", fileName.c_str());
+}
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::isSupported() {
+#ifdef XOREOS_HAVE_FILE_MAPPING
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool MappedFile::open(const UString &fileName) {
+	close();
+
+	boost::shared_ptr<Mapping> mapping(new Mapping);
+	if (!mapping->map(fileName))
+		return false;
+
+	_mapping = mapping;
+
+	_data = _mapping->getData();
+	_size = _mapping->getSize();
+
+	return true;
+}
+
+void MappedFile::close() {
+	_mapping.reset();
+
+	_data = 0;
+	_size = kSizeInvalid;
+	_pos  = 0;
+	_eos  = false;
+}
+
+bool MappedFile::isOpen() const {
+	return _data != 0;
+}
+
+bool MappedFile::eos() const {
+	if (!_data)
+		return true;
+
+	return _eos;
+}
+
+size_t MappedFile::pos() const {
+	if (!_data)
+		return kPositionInvalid;
+
+	return _pos;
+}
+
+size_t MappedFile::size() const {
+	return _size;
+}
+
+size_t MappedFile::seek(ptrdiff_t offset, Origin whence) {
+	if (!_data)
+		throw Exception(kSeekError);
+
+	const size_t oldPos = _pos;
+	const size_t newPos = evalSeek(offset, whence, _pos, 0, _size);
+	if (newPos > _size)
+		throw Exception(kSeekError);
+
+	_pos = newPos;
+
+	// Reset end-of-stream flag on a successful seek
+	_eos = false;
+
+	return oldPos;
+}
+
+size_t MappedFile::read(void *dataPtr, size_t dataSize) {
+	if (!_data)
+		return 0;
+
+	// Read at most as many bytes as are still available...
+	if (dataSize > _size - _pos) {
+		dataSize = _size - _pos;
+		_eos = true;
+	}
+
+	std::memcpy(dataPtr, _data + _pos, dataSize);
+	_pos += dataSize;
+
+	return dataSize;
+}
+
+const byte *MappedFile::getData() const {
+	return _data;
+}
+
+MemoryReadStream *MappedFile::readView(size_t offset, size_t viewSize) const {
+	if (!_data || (offset > _size) || (viewSize > (_size - offset)))
+		throw Exception(kReadError);
+
+	return new MappedReadStream(_mapping, _data + offset, viewSize);
+}
+
+} // End of namespace Common
@@ -0,0 +1,111 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  Implementing the stream reading interfaces for memory-mapped files.
+ */
+
+#ifndef COMMON_MAPPEDFILE_H
+#define COMMON_MAPPEDFILE_H
+
+#include <boost/shared_ptr.hpp>
+
+#include "src/common/types.h"
+#include "src/common/readstream.h"
+#include "src/common/noncopyable.h"
+
+namespace Common {
+
+class UString;
+class MemoryReadStream;
+
+/** A file mapped read-only into memory.
+ *
+ *  Apart from the usual streaming interface, a MappedFile can hand out
+ *  views into parts of the file. These are independent streams that read
+ *  directly from the mapping, without any allocation or copying. Since they
+ *  don't share a seek position with the MappedFile or with each other, they
+ *  can be used from different threads at the same time.
+ *
+ *  Every view keeps the mapping alive, so a view may outlive the MappedFile
+ *  it was created from.
+ *
+ *  Memory mapping is not available on all platforms. In that case, open()
+ *  will always fail and the caller should fall back to a ReadFile.
+ */
+class MappedFile : public SeekableReadStream, public NonCopyable {
+public:
+	MappedFile();
+	MappedFile(const UString &fileName);
+	~MappedFile();
+
+	/** Is memory mapping supported on this platform? */
+	static bool isSupported();
+
+	/** Try to map the file with the given fileName into memory.
+	 *
+	 *  @param  fileName the name of the file to open
+	 *  @return true if file was mapped successfully, false otherwise
+	 */
+	bool open(const UString &fileName);
+
+	/** Unmap the file, if mapped. Views created from it stay valid. */
+	void close();
+
+	/** Checks if the object mapped a file successfully.
+	 *
+	 *  @return true if any file is mapped, false otherwise.
+	 */
+	bool isOpen() const;
+
+	bool eos() const;
+
+	size_t pos() const;
+	size_t size() const;
+
+	size_t seek(ptrdiff_t offset, Origin whence = kOriginBegin);
+	size_t read(void *dataPtr, size_t dataSize);
+
+	/** Return the mapped data. */
+	const byte *getData() const;
+
+	/** Create a read-only view into the range [offset, offset + viewSize) of the file.
+	 *
+	 *  This does not touch the current seek position of the MappedFile.
+	 */
+	MemoryReadStream *readView(size_t offset, size_t viewSize) const;
+
+private:
+	class Mapping;
+
+	boost::shared_ptr<Mapping> _mapping; ///< The actual memory mapping.
+
+	const byte *_data; ///< The mapped data.
+	size_t      _size; ///< The file's size.
+	size_t      _pos;  ///< The current position within the file.
+
+	bool _eos;
+
+	friend class MappedReadStream;
+};
+
+} // End of namespace Common
+
+#endif // COMMON_MAPPEDFILE_H
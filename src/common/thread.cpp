@@ -44,15 +44,21 @@ bool Thread::createThread() {
 		// Already running, nothing to do
 		return true;
 
+	/* Mark the thread as running before it actually starts. Otherwise, a
+	 * destroyThread() right after creation might miss it. */
+	_threadRunning = true;
+
 	// Try to create the thread
-	if (!(_thread = SDL_CreateThread(threadHelper, 0, static_cast<void *>(this))))
+	if (!(_thread = SDL_CreateThread(threadHelper, 0, static_cast<void *>(this)))) {
+		_threadRunning = false;
 		return false;
+	}
 
 	return true;
 }
 
 bool Thread::destroyThread() {
-	if (!_threadRunning)
+	if (!_thread)
 		return true;
 
 	// Signal the thread that it should die
@@ -66,6 +72,7 @@ bool Thread::destroyThread() {
 		// Wait for everything to settle
 		SDL_WaitThread(_thread, 0);
 
+		_thread        = 0;
 		_killThread    = false;
 		_threadRunning = false;
 
@@ -80,12 +87,23 @@ bool Thread::destroyThread() {
 	return false;
 }
 
+void Thread::joinThread() {
+	if (!_thread)
+		return;
+
+	// Signal the thread that it should die
+	_killThread = true;
+
+	SDL_WaitThread(_thread, 0);
+
+	_thread        = 0;
+	_killThread    = false;
+	_threadRunning = false;
+}
+
 int Thread::threadHelper(void *obj) {
 	Thread *thread = static_cast<Thread *>(obj);
 
-	// The thread is running.
-	thread->_threadRunning = true;
-
 	// Run the thread
 	thread->threadMethod();
 
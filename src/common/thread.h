@@ -40,6 +40,9 @@ public:
 	bool createThread();
 	bool destroyThread();
 
+	/** Signal the thread to die, and wait for it to finish, however long it takes. */
+	void joinThread();
+
 protected:
 	volatile bool _killThread;
 
@@ -0,0 +1,156 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A pool of worker threads.
+ */
+
+#include <exception>
+
+#include <SDL_cpuinfo.h>
+
+#include "src/common/threadpool.h"
+#include "src/common/thread.h"
+#include "src/common/error.h"
+#include "src/common/util.h"
+
+namespace Common {
+
+/** A worker thread, running jobs until the pool shuts down. */
+class ThreadPool::Worker : public Thread {
+public:
+	Worker(ThreadPool &pool) : _pool(&pool) {
+	}
+
+	~Worker() {
+		joinThread();
+	}
+
+private:
+	ThreadPool *_pool;
+
+	void threadMethod() {
+		while (!_killThread && !_pool->_shutdown)
+			_pool->runJob(100);
+	}
+};
+
+
+ThreadPool::ThreadPool(size_t threadCount) : _unfinished(0), _jobsQueued(0),
+	_jobsFinished(_mutex), _shutdown(false) {
+
+	if (threadCount == 0)
+		threadCount = getCPUCount();
+
+	_workers.reserve(threadCount);
+
+	for (size_t i = 0; i < threadCount; i++) {
+		_workers.push_back(new Worker(*this));
+
+		if (!_workers.back()->createThread()) {
+			_shutdown = true;
+
+			for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+				delete *w;
+
+			throw Exception("Failed to create a worker thread");
+		}
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	// Let the workers finish their current job and leave
+	_shutdown = true;
+
+	for (size_t i = 0; i < _workers.size(); i++)
+		_jobsQueued.unlock();
+
+	/* A worker might be in the middle of a long job. We have to wait for it
+	 * to finish, since it still accesses both itself and the pool. */
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		(*w)->joinThread();
+
+	for (std::vector<Worker *>::iterator w = _workers.begin(); w != _workers.end(); ++w)
+		delete *w;
+}
+
+size_t ThreadPool::getThreadCount() const {
+	return _workers.size();
+}
+
+size_t ThreadPool::getCPUCount() {
+	const int count = SDL_GetCPUCount();
+
+	return (count > 0) ? ((size_t) count) : 1;
+}
+
+void ThreadPool::addJob(const Job &job) {
+	{
+		StackLock lock(_mutex);
+
+		_jobs.push_back(job);
+		_unfinished++;
+	}
+
+	_jobsQueued.unlock();
+}
+
+void ThreadPool::wait() {
+	StackLock lock(_mutex);
+
+	while (_unfinished > 0)
+		_jobsFinished.wait();
+}
+
+void ThreadPool::runJob(uint32 timeout) {
+	if (!_jobsQueued.lock(timeout))
+		return;
+
+	Job job;
+	{
+		StackLock lock(_mutex);
+
+		// We might have been woken up to shut down
+		if (_jobs.empty())
+			return;
+
+		job = _jobs.front();
+		_jobs.pop_front();
+	}
+
+	try {
+		job();
+	} catch (Exception &e) {
+		printException(e, "WARNING: ");
+	} catch (std::exception &e) {
+		Exception se(e);
+
+		printException(se, "WARNING: ");
+	} catch (...) {
+		warning("Unknown exception in a thread pool job");
+	}
+
+	StackLock lock(_mutex);
+
+	if (--_unfinished == 0)
+		_jobsFinished.broadcast();
+}
+
+} // End of namespace Common
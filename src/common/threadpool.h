@@ -0,0 +1,95 @@
+/* xoreos - A reimplementation of BioWare's Aurora engine
+ *
+ * xoreos is the legal property of its developers, whose names
+ * can be found in the AUTHORS file distributed with this source
+ * distribution.
+ *
+ * xoreos is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 3
+ * of the License, or (at your option) any later version.
+ *
+ * xoreos is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with xoreos. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/** @file
+ *  A pool of worker threads.
+ */
+
+#ifndef COMMON_THREADPOOL_H
+#define COMMON_THREADPOOL_H
+
+#include <list>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include "src/common/types.h"
+#include "src/common/noncopyable.h"
+#include "src/common/mutex.h"
+
+namespace Common {
+
+/** A pool of worker threads, running queued jobs in parallel.
+ *
+ *  Jobs are run in the order they were queued, but since several run at
+ *  the same time, they may finish in any order. A job that needs to report
+ *  a result or an error should store it somewhere the creator can pick it up
+ *  after wait() returned.
+ *
+ *  Exceptions escaping a job are caught and printed as warnings.
+ *
+ *  Destroying the pool waits for all running jobs to finish, but jobs
+ *  that are still queued and haven't started yet are dropped. To make
+ *  sure all queued jobs are run, call wait() first.
+ */
+class ThreadPool : NonCopyable {
+public:
+	typedef boost::function<void ()> Job;
+
+	/** Create a pool with this many worker threads. 0 means one per CPU core. */
+	ThreadPool(size_t threadCount = 0);
+	/** Wait for the running jobs to finish and drop all queued ones. */
+	~ThreadPool();
+
+	/** Return the number of worker threads in this pool. */
+	size_t getThreadCount() const;
+
+	/** Queue a job to be run on one of the worker threads. */
+	void addJob(const Job &job);
+
+	/** Wait until all jobs queued so far have finished. */
+	void wait();
+
+	/** Return the number of CPU cores available. */
+	static size_t getCPUCount();
+
+private:
+	class Worker;
+
+	std::vector<Worker *> _workers;
+
+	std::list<Job> _jobs;       ///< Jobs still waiting for a worker.
+	size_t         _unfinished; ///< Jobs queued or currently running.
+
+	Mutex     _mutex;
+	Semaphore _jobsQueued;
+	Condition _jobsFinished;
+
+	volatile bool _shutdown;
+
+	/** Wait for a job and run it. Called by the worker threads. */
+	void runJob(uint32 timeout);
+
+	friend class Worker;
+};
+
+} // End of namespace Common
+
+#endif // COMMON_THREADPOOL_H
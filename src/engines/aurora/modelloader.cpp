@@ -36,4 +36,38 @@ void ModelLoader::free(Graphics::Aurora::Model *&model) {
 	model = 0;
 }
 
+Common::UString ModelLoader::getPrototypeKey(const Common::UString &resref,
+		Graphics::Aurora::ModelType type, const Common::UString &texture) {
+
+	return Common::UString::format("%d|%s|%s", (int) type, texture.c_str(), resref.c_str());
+}
+
+Graphics::Aurora::Model *ModelLoader::findInstance(const Common::UString &resref,
+		Graphics::Aurora::ModelType type, const Common::UString &texture) {
+
+	Prototypes::iterator p = _prototypes.find(getPrototypeKey(resref, type, texture));
+	if (p == _prototypes.end())
+		return 0;
+
+	boost::shared_ptr<Graphics::Aurora::Model> prototype = p->second.lock();
+	if (!prototype) {
+		// All instances of this model have been freed
+		_prototypes.erase(p);
+		return 0;
+	}
+
+	return new Graphics::Aurora::Model(prototype);
+}
+
+Graphics::Aurora::Model *ModelLoader::addInstance(const Common::UString &resref,
+		Graphics::Aurora::ModelType type, const Common::UString &texture,
+		Graphics::Aurora::Model *model) {
+
+	boost::shared_ptr<Graphics::Aurora::Model> prototype(model);
+
+	_prototypes[getPrototypeKey(resref, type, texture)] = prototype;
+
+	return new Graphics::Aurora::Model(prototype);
+}
+
 } // End of namespace Engines
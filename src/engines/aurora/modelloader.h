@@ -25,11 +25,13 @@
 #ifndef ENGINES_AURORA_MODELLOADER_H
 #define ENGINES_AURORA_MODELLOADER_H
 
-#include "src/graphics/aurora/types.h"
+#include <map>
+
+#include <boost/weak_ptr.hpp>
 
-namespace Common {
-	class UString;
-}
+#include "src/common/ustring.h"
+
+#include "src/graphics/aurora/types.h"
 
 namespace Engines {
 
@@ -40,6 +42,33 @@ public:
 	virtual Graphics::Aurora::Model *load(const Common::UString &resref,
 			Graphics::Aurora::ModelType type, const Common::UString &texture) = 0;
 	virtual void free(Graphics::Aurora::Model *&model);
+
+protected:
+	/** Create a new instance of a model that's already loaded.
+	 *
+	 *  Returns 0 if no instance of this model currently exists.
+	 */
+	Graphics::Aurora::Model *findInstance(const Common::UString &resref,
+			Graphics::Aurora::ModelType type, const Common::UString &texture);
+
+	/** Take over a freshly loaded model and create a first instance of it.
+	 *
+	 *  All further instances of that model created by findInstance() share
+	 *  its geometry and animations, until the last of its instances is freed.
+	 */
+	Graphics::Aurora::Model *addInstance(const Common::UString &resref,
+			Graphics::Aurora::ModelType type, const Common::UString &texture,
+			Graphics::Aurora::Model *model);
+
+private:
+	typedef std::map<Common::UString, boost::weak_ptr<Graphics::Aurora::Model>,
+	                 Common::UString::iless> Prototypes;
+
+	/** The models all current instances were created from, indexed by resref, type and texture. */
+	Prototypes _prototypes;
+
+	static Common::UString getPrototypeKey(const Common::UString &resref,
+			Graphics::Aurora::ModelType type, const Common::UString &texture);
 };
 
 } // End of namespace Engines
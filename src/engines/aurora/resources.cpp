@@ -61,6 +61,22 @@ void indexMandatoryArchive(const Common::UString &file, uint32 priority, ChangeL
 	indexMandatoryArchive(file, priority, password, changes);
 }
 
+void indexMandatoryArchives(const std::vector<Common::UString> &files, uint32 priority,
+                            Common::ChangeID *changeID) {
+
+	if (EventMan.quitRequested())
+		return;
+
+	ResMan.indexArchives(files, priority, changeID);
+}
+
+void indexMandatoryArchives(const std::vector<Common::UString> &files, uint32 priority,
+                            ChangeList &changes) {
+
+	changes.push_back(Common::ChangeID());
+	indexMandatoryArchives(files, priority, &changes.back());
+}
+
 bool indexOptionalArchive(const Common::UString &file, uint32 priority, const std::vector<byte> &password,
                           Common::ChangeID *changeID) {
 
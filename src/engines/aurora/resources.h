@@ -48,6 +48,16 @@ void indexMandatoryArchive(const Common::UString &file, uint32 priority, const s
 void indexMandatoryArchive(const Common::UString &file, uint32 priority, const std::vector<byte> &password,
                            ChangeList &changes);
 
+/** Add several archive files to the resource manager, erroring out if one does not exist.
+ *
+ *  The archives are opened in parallel. Each archive gets a priority one higher
+ *  than the one before it, starting with the given priority.
+ */
+void indexMandatoryArchives(const std::vector<Common::UString> &files, uint32 priority,
+                            Common::ChangeID *changeID = 0);
+void indexMandatoryArchives(const std::vector<Common::UString> &files, uint32 priority,
+                            ChangeList &changes);
+
 /** Add an archive file to the resource manager, if it exists. */
 bool indexOptionalArchive(const Common::UString &file, uint32 priority, Common::ChangeID *changeID = 0);
 bool indexOptionalArchive(const Common::UString &file, uint32 priority, ChangeList &changes);
@@ -60,7 +60,10 @@ void playVideo(const Common::UString &video) {
 	try {
 		Video::Aurora::VideoPlayer videoPlayer(video);
 
-		videoPlayer.play();
+		if (ConfigMan.getBool("benchmarkvideos", false))
+			videoPlayer.benchmark();
+		else
+			videoPlayer.play();
 	} catch (Common::Exception &e) {
 		Common::printException(e, "WARNING: ");
 	}
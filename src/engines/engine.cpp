@@ -26,6 +26,10 @@
 
 #include "src/common/util.h"
 #include "src/common/configman.h"
+#include "src/common/filepath.h"
+#include "src/common/hash.h"
+
+#include "src/aurora/resman.h"
 
 #include "src/graphics/aurora/fps.h"
 #include "src/graphics/aurora/fontman.h"
@@ -89,9 +93,25 @@ void Engine::start(Aurora::GameID game, const Common::UString &target, Aurora::P
 	_platform = platform;
 	_target   = target;
 
+	ResMan.setIndexThreads(MAX(ConfigMan.getInt("indexthreads", 0), 0));
+	setupIndexCache();
+
 	run();
 }
 
+void Engine::setupIndexCache() {
+	if (!ConfigMan.getBool("indexcache", false)) {
+		ResMan.setIndexCache("");
+		return;
+	}
+
+	// One index cache file per game installation
+	const uint64 targetHash = Common::hashString(Common::FilePath::canonicalize(_target), Common::kHashFNV64);
+
+	ResMan.setIndexCache(Common::FilePath::getUserDataDirectory() + "/indexcache/" +
+	                     Common::formatHash(targetHash) + ".idx");
+}
+
 void Engine::showFPS() {
 	bool show = ConfigMan.getBool("showfps", false);
 
@@ -91,6 +91,10 @@ protected:
 
 	bool evaluateLanguage(bool find, Aurora::Language &language) const;
 	bool evaluateLanguage(bool find, Aurora::Language &languageVoice, Aurora::Language &languageText) const;
+
+private:
+	/** Evaluate the index cache setting and set up the resource manager's index cache. */
+	void setupIndexCache();
 };
 
 } // End of namespace Engines
@@ -22,6 +22,8 @@
  *  The context holding a Star Wars: Knights of the Old Republic area.
  */
 
+#include <set>
+
 #include "src/common/util.h"
 #include "src/common/error.h"
 #include "src/common/readstream.h"
@@ -32,6 +34,7 @@
 #include "src/aurora/2dareg.h"
 
 #include "src/graphics/graphics.h"
+#include "src/graphics/camera.h"
 #include "src/graphics/renderable.h"
 
 #include "src/graphics/aurora/cursorman.h"
@@ -53,7 +56,8 @@ namespace Engines {
 namespace KotOR {
 
 Area::Area(Module &module, const Common::UString &resRef) : Object(kObjectTypeArea),
-	_module(&module), _resRef(resRef), _visible(false), _activeObject(0), _highlightAll(false) {
+	_module(&module), _resRef(resRef), _visible(false), _currentRoom(0),
+	_activeObject(0), _highlightAll(false) {
 
 	try {
 		load();
@@ -101,6 +105,9 @@ void Area::clear() {
 
 	_objects.clear();
 	_rooms.clear();
+	_roomMap.clear();
+
+	_currentRoom = 0;
 }
 
 uint32 Area::getMusicDayTrack() const {
@@ -190,11 +197,11 @@ void Area::show() {
 	if (_visible)
 		return;
 
-	GfxMan.lockFrame();
-
 	// Show rooms
-	for (RoomList::iterator r = _rooms.begin(); r != _rooms.end(); ++r)
-		(*r)->show();
+	updateCurrentRoom();
+	showVisibleRooms();
+
+	GfxMan.lockFrame();
 
 	// Show objects
 	for (ObjectList::iterator o = _objects.begin(); o != _objects.end(); ++o)
@@ -324,8 +331,11 @@ void Area::loadProperties(const Aurora::GFF3Struct &props) {
 
 void Area::loadRooms() {
 	const Aurora::LYTFile::RoomArray &rooms = _lyt.getRooms();
-	for (Aurora::LYTFile::RoomArray::const_iterator r = rooms.begin(); r != rooms.end(); ++r)
+	for (Aurora::LYTFile::RoomArray::const_iterator r = rooms.begin(); r != rooms.end(); ++r) {
 		_rooms.push_back(new Room(r->model, r->x, r->y, r->z));
+
+		_roomMap.insert(std::make_pair(r->model, _rooms.back()));
+	}
 }
 
 void Area::loadObject(KotOR::Object &object) {
@@ -468,8 +478,101 @@ void Area::removeFocus() {
 	_activeObject = 0;
 }
 
+size_t Area::getRoomCount() const {
+	return _rooms.size();
+}
+
+size_t Area::getVisibleRoomCount() const {
+	size_t count = 0;
+	for (RoomList::const_iterator r = _rooms.begin(); r != _rooms.end(); ++r)
+		if ((*r)->isVisible())
+			count++;
+
+	return count;
+}
+
+Common::UString Area::getCurrentRoom() const {
+	if (!_currentRoom)
+		return "";
+
+	return _currentRoom->getResRef();
+}
+
+Room *Area::getRoomAt(float x, float y, float z) const {
+	/* Rooms' bounding boxes overlap a bit, so prefer staying in the current room.
+	 * If the point isn't within any room's full box, for example because the
+	 * camera floats above the ceiling, fall back to looking from the top down. */
+
+	if (_currentRoom && _currentRoom->isIn(x, y, z))
+		return _currentRoom;
+
+	for (RoomList::const_iterator r = _rooms.begin(); r != _rooms.end(); ++r)
+		if ((*r)->isIn(x, y, z))
+			return *r;
+
+	if (_currentRoom && _currentRoom->isIn(x, y))
+		return _currentRoom;
+
+	for (RoomList::const_iterator r = _rooms.begin(); r != _rooms.end(); ++r)
+		if ((*r)->isIn(x, y))
+			return *r;
+
+	return 0;
+}
+
+bool Area::updateCurrentRoom() {
+	Common::StackLock lock(_mutex);
+
+	const float *position = CameraMan.getPosition();
+
+	Room *room = getRoomAt(position[0], position[1], position[2]);
+	if (room == _currentRoom)
+		return false;
+
+	_currentRoom = room;
+	return true;
+}
+
+void Area::showVisibleRooms() {
+	Common::StackLock lock(_mutex);
+
+	/* Without a current room, or when the VIS file doesn't know about it,
+	 * we can't tell what's visible. Show everything then, to be safe. */
+
+	const std::vector<Common::UString> *visible = 0;
+	if (_currentRoom)
+		visible = &_vis.getVisibilityArray(_currentRoom->getResRef());
+
+	const bool showAll = !visible || visible->empty();
+
+	std::set<Room *> show;
+	if (!showAll) {
+		show.insert(_currentRoom);
+
+		for (std::vector<Common::UString>::const_iterator v = visible->begin(); v != visible->end(); ++v) {
+			RoomMap::const_iterator r = _roomMap.find(*v);
+			if (r != _roomMap.end())
+				show.insert(r->second);
+		}
+	}
+
+	GfxMan.lockFrame();
+
+	for (RoomList::iterator r = _rooms.begin(); r != _rooms.end(); ++r) {
+		if (showAll || (show.find(*r) != show.end()))
+			(*r)->show();
+		else
+			(*r)->hide();
+	}
+
+	GfxMan.unlockFrame();
+}
+
 void Area::notifyCameraMoved() {
 	checkActive();
+
+	if (updateCurrentRoom() && _visible)
+		showVisibleRooms();
 }
 
 } // End of namespace KotOR
@@ -73,6 +73,16 @@ public:
 	void show();
 	void hide();
 
+	// Rooms
+
+	/** Return the number of rooms in the area. */
+	size_t getRoomCount() const;
+	/** Return the number of rooms currently visible. */
+	size_t getVisibleRoomCount() const;
+
+	/** Return the resref of the room the camera is in, or "" if it's outside all rooms. */
+	Common::UString getCurrentRoom() const;
+
 	// Music/Sound
 
 	uint32 getMusicDayTrack   () const; ///< Return the music track ID playing by day.
@@ -109,6 +119,7 @@ protected:
 
 private:
 	typedef std::list<Room *> RoomList;
+	typedef std::map<Common::UString, Room *, Common::UString::iless> RoomMap;
 
 	typedef std::list<KotOR::Object *> ObjectList;
 	typedef std::map<uint32, KotOR::Object *> ObjectMap;
@@ -144,7 +155,11 @@ private:
 	Aurora::LYTFile _lyt; ///< The area's layout description.
 	Aurora::VISFile _vis; ///< The area's inter-room visibility description.
 
-	RoomList _rooms; ///< All rooms in the area.
+	RoomList _rooms;   ///< All rooms in the area.
+	RoomMap  _roomMap; ///< All rooms in the area, indexed by resref.
+
+	/** The room the camera is currently in. */
+	Room *_currentRoom;
 
 	ObjectList _objects;   ///< List of all objects in the area.
 	ObjectMap  _objectMap; ///< Map of all non-static objects in the area.
@@ -193,6 +208,16 @@ private:
 
 	void click(int x, int y);
 
+	// Room visibility helpers
+
+	/** Return the room containing this point, preferring the current room. */
+	Room *getRoomAt(float x, float y, float z) const;
+
+	/** Find the room the camera is in. Return true if it changed. */
+	bool updateCurrentRoom();
+	/** Show the current room and all rooms visible from it, hide all others. */
+	void showVisibleRooms();
+
 
 	friend class Console;
 };
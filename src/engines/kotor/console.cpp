@@ -40,6 +40,7 @@
 #include "src/engines/kotor/kotor.h"
 #include "src/engines/kotor/game.h"
 #include "src/engines/kotor/module.h"
+#include "src/engines/kotor/area.h"
 
 namespace Engines {
 
@@ -62,6 +63,8 @@ Console::Console(KotOREngine &engine) :
 	registerCommand("playmusic"  , boost::bind(&Console::cmdPlayMusic  , this, _1),
 			"Usage: playmusic [<music>]\nPlay the specified music resource. "
 			"If none was specified, play the default area music.");
+	registerCommand("visiblerooms", boost::bind(&Console::cmdVisibleRooms, this, _1),
+			"Usage: visiblerooms\nShow how many of the current area's rooms are visible");
 }
 
 Console::~Console() {
@@ -141,6 +144,19 @@ void Console::cmdPlayMusic(const CommandLine &cl) {
 	_engine->getGame().playMusic(cl.args);
 }
 
+void Console::cmdVisibleRooms(const CommandLine &UNUSED(cl)) {
+	Area *area = _engine->getGame().getModule().getCurrentArea();
+	if (!area) {
+		printf("Not in an area");
+		return;
+	}
+
+	const Common::UString room = area->getCurrentRoom();
+
+	printf("Current room: %s", room.empty() ? "(none)" : room.c_str());
+	printf("Visible rooms: %u/%u", (uint)area->getVisibleRoomCount(), (uint)area->getRoomCount());
+}
+
 } // End of namespace KotOR
 
 } // End of namespace Engines
@@ -38,7 +38,13 @@ namespace KotOR {
 Graphics::Aurora::Model *KotORModelLoader::load(const Common::UString &resref,
 		Graphics::Aurora::ModelType type, const Common::UString &texture) {
 
-	return new Graphics::Aurora::Model_KotOR(resref, false, type, texture, &_modelCache);
+	Graphics::Aurora::Model *model = findInstance(resref, type, texture);
+	if (model)
+		return model;
+
+	model = new Graphics::Aurora::Model_KotOR(resref, false, type, texture, &_modelCache);
+
+	return addInstance(resref, type, texture, model);
 }
 
 } // End of namespace KotOR
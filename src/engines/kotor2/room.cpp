@@ -35,7 +35,9 @@ namespace Engines {
 
 namespace KotOR2 {
 
-Room::Room(const Common::UString &resRef, float x, float y, float z) : _model(0) {
+Room::Room(const Common::UString &resRef, float x, float y, float z) :
+	_resRef(resRef), _model(0), _visible(false) {
+
 	load(resRef, x, y, z);
 }
 
@@ -54,14 +56,40 @@ void Room::load(const Common::UString &resRef, float x, float y, float z) {
 	_model->setPosition(x, y, z);
 }
 
+const Common::UString &Room::getResRef() const {
+	return _resRef;
+}
+
 void Room::show() {
+	if (_visible)
+		return;
+
 	if (_model)
 		_model->show();
+
+	_visible = true;
 }
 
 void Room::hide() {
+	if (!_visible)
+		return;
+
 	if (_model)
 		_model->hide();
+
+	_visible = false;
+}
+
+bool Room::isVisible() const {
+	return _visible;
+}
+
+bool Room::isIn(float x, float y) const {
+	return _model && _model->isIn(x, y);
+}
+
+bool Room::isIn(float x, float y, float z) const {
+	return _model && _model->isIn(x, y, z);
 }
 
 } // End of namespace KotOR2
@@ -25,11 +25,9 @@
 #ifndef ENGINES_KOTOR2_ROOM_H
 #define ENGINES_KOTOR2_ROOM_H
 
-#include "src/graphics/aurora/types.h"
+#include "src/common/ustring.h"
 
-namespace Common {
-	class UString;
-}
+#include "src/graphics/aurora/types.h"
 
 namespace Engines {
 
@@ -40,12 +38,27 @@ public:
 	Room(const Common::UString &resRef, float x, float y, float z);
 	~Room();
 
+	/** Return the resref of the room's model. */
+	const Common::UString &getResRef() const;
+
 	void show();
 	void hide();
 
+	/** Is the room currently visible? */
+	bool isVisible() const;
+
+	/** Is that point within the room's bounding box, as viewed from the top down? */
+	bool isIn(float x, float y) const;
+	/** Is that point within the room's bounding box? */
+	bool isIn(float x, float y, float z) const;
+
 private:
+	Common::UString _resRef;
+
 	Graphics::Aurora::Model *_model;
 
+	bool _visible;
+
 	void load(const Common::UString &resRef, float x, float y, float z);
 };
 
@@ -801,19 +801,19 @@ void Creature::loadClasses(const Aurora::GFF3Struct &gff,
 	}
 }
 
-const Common::UString &Creature::getConvRace() const {
+Common::UString Creature::getConvRace() const {
 	const uint32 strRef = TwoDAReg.get2DA("racialtypes").getRow(_race).getInt("ConverName");
 
 	return TalkMan.getString(strRef);
 }
 
-const Common::UString &Creature::getConvrace() const {
+Common::UString Creature::getConvrace() const {
 	const uint32 strRef = TwoDAReg.get2DA("racialtypes").getRow(_race).getInt("ConverNameLower");
 
 	return TalkMan.getString(strRef);
 }
 
-const Common::UString &Creature::getConvRaces() const {
+Common::UString Creature::getConvRaces() const {
 	const uint32 strRef = TwoDAReg.get2DA("racialtypes").getRow(_race).getInt("NamePlural");
 
 	return TalkMan.getString(strRef);
@@ -842,21 +842,21 @@ uint16 Creature::getClassLevel(uint32 classID) const {
 	return 0;
 }
 
-const Common::UString &Creature::getConvClass() const {
+Common::UString Creature::getConvClass() const {
 	const uint32 classID = _classes.front().classID;
 	const uint32 strRef  = TwoDAReg.get2DA("classes").getRow(classID).getInt("Name");
 
 	return TalkMan.getString(strRef);
 }
 
-const Common::UString &Creature::getConvclass() const {
+Common::UString Creature::getConvclass() const {
 	const uint32 classID = _classes.front().classID;
 	const uint32 strRef  = TwoDAReg.get2DA("classes").getRow(classID).getInt("Lower");
 
 	return TalkMan.getString(strRef);
 }
 
-const Common::UString &Creature::getConvClasses() const {
+Common::UString Creature::getConvClasses() const {
 	const uint32 classID = _classes.front().classID;
 	const uint32 strRef  = TwoDAReg.get2DA("classes").getRow(classID).getInt("Plural");
 
@@ -89,11 +89,11 @@ public:
 	const Common::UString &getPortrait() const;
 
 	/** Return the creature's race as needed in conversations, e.g. "Dwarven". */
-	const Common::UString &getConvRace() const;
+	Common::UString getConvRace() const;
 	/** Return the creature's lowercase race as needed in conversations, e.g. "dwarven". */
-	const Common::UString &getConvrace() const;
+	Common::UString getConvrace() const;
 	/** Return the creature's race plural as needed in conversations, e.g. "Dwarves". */
-	const Common::UString &getConvRaces() const;
+	Common::UString getConvRaces() const;
 
 	/** Get the creature's subrace. */
 	const Common::UString &getSubRace() const;
@@ -104,11 +104,11 @@ public:
 	uint16 getClassLevel(uint32 classID) const;
 
 	/** Return the creature's class as needed in conversations, e.g. "Barbarian". */
-	const Common::UString &getConvClass() const;
+	Common::UString getConvClass() const;
 	/** Return the creature's class as needed in conversations, e.g. "barbarian". */
-	const Common::UString &getConvclass() const;
+	Common::UString getConvclass() const;
 	/** Return the pcreature's class plural as needed in conversations, e.g. "Barbarians". */
-	const Common::UString &getConvClasses() const;
+	Common::UString getConvClasses() const;
 
 	/** Return the creature's class description. */
 	Common::UString getClassString() const;
@@ -38,11 +38,13 @@ namespace NWN {
 Graphics::Aurora::Model *NWNModelLoader::load(const Common::UString &resref,
 		Graphics::Aurora::ModelType type, const Common::UString &texture) {
 
-	// if supermodel
-	// check model cache
-	// else load supermodel and insert into cache
+	Graphics::Aurora::Model *model = findInstance(resref, type, texture);
+	if (model)
+		return model;
 
-	return new Graphics::Aurora::Model_NWN(resref, type, texture, &_modelCache);
+	model = new Graphics::Aurora::Model_NWN(resref, type, texture, &_modelCache);
+
+	return addInstance(resref, type, texture, model);
 }
 
 } // End of namespace NWN
@@ -581,8 +581,13 @@ void Module::unloadTLK() {
 void Module::loadHAKs() {
 	const std::vector<Common::UString> &haks = _ifo.getHAKs();
 
-	for (size_t i = 0; i < haks.size(); i++)
-		indexMandatoryArchive(haks[i] + ".hak", 1002 + i, _resHAKs);
+	std::vector<Common::UString> hakFiles;
+	hakFiles.reserve(haks.size());
+
+	for (std::vector<Common::UString>::const_iterator h = haks.begin(); h != haks.end(); ++h)
+		hakFiles.push_back(*h + ".hak");
+
+	indexMandatoryArchives(hakFiles, 1002, _resHAKs);
 }
 
 void Module::unloadHAKs() {
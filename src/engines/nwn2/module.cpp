@@ -372,18 +372,17 @@ void Module::unloadTLK() {
 void Module::loadHAKs() {
 	const std::vector<Common::UString> &haks = _ifo.getHAKs();
 
-	_resHAKs.resize(haks.size());
+	std::vector<Common::UString> hakFiles;
+	hakFiles.reserve(haks.size());
 
-	for (size_t i = 0; i < haks.size(); i++)
-		indexMandatoryArchive(haks[i] + ".hak", 1002 + i, &_resHAKs[i]);
+	for (std::vector<Common::UString>::const_iterator h = haks.begin(); h != haks.end(); ++h)
+		hakFiles.push_back(*h + ".hak");
+
+	indexMandatoryArchives(hakFiles, 1002, _resHAKs);
 }
 
 void Module::unloadHAKs() {
-	std::vector<Common::ChangeID>::iterator hak;
-	for (hak = _resHAKs.begin(); hak != _resHAKs.end(); ++hak)
-		deindexResources(*hak);
-
-	_resHAKs.clear();
+	deindexResources(_resHAKs);
 }
 
 void Module::loadAreas() {
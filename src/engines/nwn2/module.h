@@ -37,6 +37,8 @@
 
 #include "src/events/types.h"
 
+#include "src/engines/aurora/resources.h"
+
 #include "src/engines/nwn2/objectcontainer.h"
 #include "src/engines/nwn2/object.h"
 
@@ -159,7 +161,7 @@ private:
 	Common::ChangeID _resTLK;
 
 	/** Resources added by the HAKs of the module. */
-	std::vector<Common::ChangeID> _resHAKs;
+	ChangeList _resHAKs;
 
 	Aurora::IFOFile _ifo; ///< The module's IFO.
 
@@ -77,9 +77,11 @@ void AnimNode::update(Model *model, float UNUSED(lastFrame), float nextFrame, fl
 	float oX, oY, oZ, oA;
 	_nodedata->interpolateOrientation(nextFrame, oX, oY, oZ, oA);
 
-	// Update the position/orientation of corresponding modelnode
-	target->setPosition(posX * scale, posY * scale, posZ * scale);
-	target->setOrientation(oX, oY, oZ, oA);
+	/* Queue the new position/orientation of the corresponding modelnode.
+	 * We might be running on a worker thread, and the model node might be
+	 * shared with other models through the supermodel, so the model applies
+	 * them later, in Model::finishAdvanceTime(). */
+	model->addAnimatedNode(*target, posX * scale, posY * scale, posZ * scale, oX, oY, oZ, oA);
 }
 
 } // End of namespace Aurora
@@ -47,7 +47,11 @@ public:
 	/** Get the node's name. */
 	const Common::UString &getName() const;
 
-	/** Update the model properties interpolating between frames */
+	/** Calculate the model node properties interpolating between frames.
+	 *
+	 *  The results are queued in the model, and only applied to the model
+	 *  node in Model::finishAdvanceTime().
+	 */
 	void update(Model *model, float lastFrame, float nextFrame, float scale);
 protected:
 	// Animation *_animation; ///< The animation this node belongs to.
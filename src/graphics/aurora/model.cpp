@@ -24,6 +24,7 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 
 #include <SDL_timer.h>
 
@@ -50,7 +51,7 @@ namespace Aurora {
 Model::Model(ModelType type) : Renderable((RenderableType) type),
 	_type(type), _superModel(0), _currentState(0),
 	_currentAnimation(0), _nextAnimation(0), _drawBound(false),
-	_drawSkeleton(false), _drawSkeletonInvisible(false) {
+	_drawSkeleton(false), _drawSkeletonInvisible(false), _cullNodes(false) {
 
 	_scale   [0] = 1.0f; _scale   [1] = 1.0f; _scale   [2] = 1.0f;
 	_position[0] = 0.0f; _position[1] = 0.0f; _position[2] = 0.0f;
@@ -74,11 +75,41 @@ Model::Model(ModelType type) : Renderable((RenderableType) type),
 	_boundRenderable->setMesh(MeshMan.getMesh("defaultWireBox"));
 }
 
+Model::Model(const boost::shared_ptr<Model> &prototype) :
+	Renderable((RenderableType) prototype->_type), _type(prototype->_type),
+	_fileName(prototype->_fileName), _name(prototype->_name),
+	_superModelName(prototype->_superModelName), _superModel(prototype->_superModel),
+	_prototype(prototype), _currentState(0), _stateNames(prototype->_stateNames),
+	_animationMap(prototype->_animationMap), _currentAnimation(0), _nextAnimation(0),
+	_loopAnimation(0), _animationScale(prototype->_animationScale),
+	_defaultAnimations(prototype->_defaultAnimations), _boundBox(prototype->_boundBox),
+	_drawBound(false), _drawSkeleton(false), _drawSkeletonInvisible(false), _cullNodes(false),
+	_elapsedTime(0.0f) {
+
+	memcpy(_scale      , prototype->_scale      , 3 * sizeof(float));
+	memcpy(_orientation, prototype->_orientation, 4 * sizeof(float));
+	memcpy(_position   , prototype->_position   , 3 * sizeof(float));
+	memcpy(_center     , prototype->_center     , 3 * sizeof(float));
+
+	instantiateStates();
+
+	createAbsolutePosition();
+
+	_currentAnimation = selectDefaultAnimation();
+
+	_boundRenderable = new Shader::ShaderRenderable();
+	_boundRenderable->setSurface(SurfaceMan.getSurface("defaultSurface"));
+	_boundRenderable->setMaterial(MaterialMan.getMaterial("defaultWhite"));
+	_boundRenderable->setMesh(MeshMan.getMesh("defaultWireBox"));
+}
+
 Model::~Model() {
 	hide();
 
-	for (AnimationMap::iterator a = _animationMap.begin(); a != _animationMap.end(); ++a)
-		delete a->second;
+	// The animations of an instance belong to its prototype
+	if (!_prototype)
+		for (AnimationMap::iterator a = _animationMap.begin(); a != _animationMap.end(); ++a)
+			delete a->second;
 
 	for (StateList::iterator s = _stateList.begin(); s != _stateList.end(); ++s) {
 		for (NodeList::iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n)
@@ -131,6 +162,14 @@ bool Model::isIn(float x1, float y1, float z1, float x2, float y2, float z2) con
 	return _absoluteBoundBox.isIn(x1, y1, z1, x2, y2, z2);
 }
 
+bool Model::getWorldBound(Common::BoundingBox &bound) const {
+	if ((_type == kModelTypeGUIFront) || _absoluteBoundBox.empty())
+		return false;
+
+	bound = _absoluteBoundBox;
+	return true;
+}
+
 float Model::getWidth() const {
 	return _boundBox.getWidth() * _scale[0];
 }
@@ -299,6 +338,8 @@ void Model::createAbsolutePosition() {
 	_absoluteBoundBox = _boundBox;
 	_absoluteBoundBox.transform(_absolutePosition);
 	_absoluteBoundBox.absolutize();
+
+	worldBoundChanged();
 }
 
 const std::list<Common::UString> &Model::getStates() const {
@@ -452,9 +493,38 @@ void Model::calculateDistance() {
 }
 
 void Model::advanceTime(float dt) {
+	_animatedNodes.clear();
+
 	manageAnimations(dt);
 }
 
+void Model::finishAdvanceTime() {
+	for (AnimatedNodes::const_iterator n = _animatedNodes.begin(); n != _animatedNodes.end(); ++n) {
+		n->node->setPosition(n->position[0], n->position[1], n->position[2]);
+		n->node->setOrientation(n->orientation[0], n->orientation[1], n->orientation[2], n->orientation[3]);
+	}
+
+	_animatedNodes.clear();
+}
+
+void Model::addAnimatedNode(ModelNode &node, float x, float y, float z,
+                            float oX, float oY, float oZ, float oA) {
+
+	_animatedNodes.push_back(AnimatedNode());
+	AnimatedNode &animated = _animatedNodes.back();
+
+	animated.node = &node;
+
+	animated.position[0] = x;
+	animated.position[1] = y;
+	animated.position[2] = z;
+
+	animated.orientation[0] = oX;
+	animated.orientation[1] = oY;
+	animated.orientation[2] = oZ;
+	animated.orientation[3] = oA;
+}
+
 void Model::manageAnimations(float dt) {
 	float lastFrame = _elapsedTime;
 	float nextFrame = _elapsedTime + dt;
@@ -499,6 +569,25 @@ void Model::manageAnimations(float dt) {
 		_currentAnimation->update(this, lastFrame, nextFrame);
 }
 
+bool Model::isInFrustum(const Common::Frustum &frustum) {
+	_cullNodes = false;
+
+	if (!frustum.isIn(_absoluteBoundBox))
+		return false;
+
+	/* The bounding boxes of the nodes are calculated in their default
+	 * positions. While an animation is playing, the nodes move away from
+	 * those, so we can only cull individual nodes of unanimated models. */
+	if (_currentAnimation || !_currentState)
+		return true;
+
+	_nodeFrustum = frustum;
+	_nodeFrustum.transform(_absolutePosition);
+
+	_cullNodes = true;
+	return true;
+}
+
 void Model::render(RenderPass pass) {
 	if (!_currentState || (pass > kRenderPassAll))
 		return;
@@ -522,10 +611,14 @@ void Model::render(RenderPass pass) {
 	     n != _currentState->rootNodes.end(); ++n) {
 
 		glPushMatrix();
-		(*n)->render(pass);
+		(*n)->render(pass, _cullNodes ? &_nodeFrustum : 0);
 		glPopMatrix();
 	}
 
+	// The transparent pass is the last one of a frame
+	if (pass == kRenderPassTransparent)
+		_cullNodes = false;
+
 	// Reset the first texture units
 	TextureMan.reset();
 
@@ -625,6 +718,8 @@ void Model::doDestroy() {
 }
 
 void Model::finalize() {
+	finishTextures();
+
 	_currentState = 0;
 
 	createStateNamesList();
@@ -640,6 +735,75 @@ void Model::finalize() {
 	_currentAnimation = selectDefaultAnimation();
 }
 
+void Model::instantiateStates() {
+	typedef std::map<const ModelNode *, ModelNode *> NodeInstances;
+	typedef std::map<const State *, State *> StateInstances;
+
+	NodeInstances  nodes;
+	StateInstances states;
+
+	for (StateList::const_iterator s = _prototype->_stateList.begin(); s != _prototype->_stateList.end(); ++s) {
+		State *state = new State;
+		state->name = (*s)->name;
+
+		for (NodeList::const_iterator n = (*s)->nodeList.begin(); n != (*s)->nodeList.end(); ++n) {
+			ModelNode *node = new ModelNode(*this, **n);
+
+			state->nodeList.push_back(node);
+			state->nodeMap.insert(std::make_pair(node->getName(), node));
+
+			nodes.insert(std::make_pair(*n, node));
+		}
+
+		_stateList.push_back(state);
+		states.insert(std::make_pair(*s, state));
+	}
+
+	// Recreate the node hierarchy, keeping the order of the children lists
+	for (NodeInstances::const_iterator n = nodes.begin(); n != nodes.end(); ++n) {
+		for (std::list<ModelNode *>::const_iterator c = n->first->_children.begin();
+		     c != n->first->_children.end(); ++c) {
+
+			NodeInstances::const_iterator child = nodes.find(*c);
+			if (child == nodes.end())
+				continue;
+
+			child->second->_parent = n->second;
+			n->second->_children.push_back(child->second);
+		}
+	}
+
+	for (StateList::const_iterator s = _prototype->_stateList.begin(); s != _prototype->_stateList.end(); ++s) {
+		State *state = states.find(*s)->second;
+
+		for (NodeList::const_iterator n = (*s)->rootNodes.begin(); n != (*s)->rootNodes.end(); ++n) {
+			NodeInstances::const_iterator node = nodes.find(*n);
+			if (node != nodes.end())
+				state->rootNodes.push_back(node->second);
+		}
+	}
+
+	for (StateMap::const_iterator s = _prototype->_stateMap.begin(); s != _prototype->_stateMap.end(); ++s) {
+		StateInstances::const_iterator state = states.find(s->second);
+		if (state != states.end())
+			_stateMap.insert(std::make_pair(s->first, state->second));
+	}
+
+	if (_prototype->_currentState) {
+		StateInstances::const_iterator state = states.find(_prototype->_currentState);
+		if (state != states.end())
+			_currentState = state->second;
+	}
+}
+
+void Model::finishTextures() {
+	NodeList nodes;
+	nodes.swap(_pendingTextureNodes);
+
+	for (NodeList::iterator n = nodes.begin(); n != nodes.end(); ++n)
+		(*n)->finishTextures();
+}
+
 void Model::createStateNamesList(std::list<Common::UString> *stateNames) {
 	bool isRoot = false;
 
@@ -690,6 +854,8 @@ void Model::createBound() {
 	_absoluteBoundBox = _boundBox;
 	_absoluteBoundBox.transform(_absolutePosition);
 	_absoluteBoundBox.absolutize();
+
+	worldBoundChanged();
 }
 
 void Model::readValue(Common::SeekableReadStream &stream, uint32 &value) {
@@ -29,9 +29,12 @@
 #include <list>
 #include <map>
 
+#include <boost/shared_ptr.hpp>
+
 #include "src/common/ustring.h"
 #include "src/common/transmatrix.h"
 #include "src/common/boundingbox.h"
+#include "src/common/frustum.h"
 
 #include "src/graphics/types.h"
 #include "src/graphics/glcontainer.h"
@@ -55,6 +58,14 @@ class Animation;
 class Model : public GLContainer, public Renderable {
 public:
 	Model(ModelType type = kModelTypeObject);
+	/** Create an instance of a fully loaded model.
+	 *
+	 *  The instance has its own nodes, with their own positions, orientations
+	 *  and textures, and its own transformation and animation state. The node
+	 *  geometry and the animations are shared with the prototype, which is kept
+	 *  alive for as long as any of its instances exist.
+	 */
+	explicit Model(const boost::shared_ptr<Model> &prototype);
 	~Model();
 
 	ModelType getType() const; ///< Return the model's type.
@@ -81,6 +92,9 @@ public:
 	/** Does the line from x1.y1.z1 to x2.y2.z2 intersect with model's bounding box? */
 	bool isIn(float x1, float y1, float z1, float x2, float y2, float z2) const;
 
+	/** Get the model's bounding box in world coordinates. */
+	bool getWorldBound(Common::BoundingBox &bound) const;
+
 
 	// Positioning
 
@@ -153,8 +167,10 @@ public:
 
 	// Renderable
 	void calculateDistance();
+	bool isInFrustum(const Common::Frustum &frustum);
 	void render(RenderPass pass);
 	void advanceTime(float dt);
+	void finishAdvanceTime();
 
 
 protected:
@@ -184,6 +200,16 @@ protected:
 
 	typedef std::list<DefaultAnimation> DefaultAnimations;
 
+	/** A node's position and orientation, as calculated by an animation. */
+	struct AnimatedNode {
+		ModelNode *node;
+
+		float position[3];
+		float orientation[4];
+	};
+
+	typedef std::vector<AnimatedNode> AnimatedNodes;
+
 
 	ModelType _type; ///< The model's type.
 
@@ -194,6 +220,9 @@ protected:
 	Common::UString _superModelName; ///< Name of the super model.
 	Model *_superModel; ///< The actual super model.
 
+	/** The model this model is an instance of, owning the animations. */
+	boost::shared_ptr<Model> _prototype;
+
 	StateList _stateList;   ///< All states within this model.
 	StateMap  _stateMap;    ///< All states within this model, index by name.
 	State   *_currentState; ///< The current state.
@@ -212,6 +241,9 @@ protected:
 	/** All default animations, sorted from least to most probable. */
 	DefaultAnimations _defaultAnimations;
 
+	/** The node transformations calculated in advanceTime(), to be applied in finishAdvanceTime(). */
+	AnimatedNodes _animatedNodes;
+
 	float _scale      [3]; ///< Model's scale.
 	float _orientation[4]; ///< Model's orientation.
 	float _position   [3]; ///< Model's position.
@@ -253,8 +285,20 @@ private:
 	bool _drawSkeleton;
 	bool _drawSkeletonInvisible;
 
+	/** Cull the nodes against _nodeFrustum while rendering this frame? */
+	bool _cullNodes;
+	/** The view frustum, in model coordinates. */
+	Common::Frustum _nodeFrustum;
+
 	float _elapsedTime; ///< Track animation duration
 
+	/** Nodes with textures still being decoded, to be finished in finalize(). */
+	NodeList _pendingTextureNodes;
+
+	/** Let all nodes evaluate their textures, once they've been decoded. */
+	void finishTextures();
+	/** Create instances of all the prototype's states and nodes. */
+	void instantiateStates();
 	/** Create the list of all state names. */
 	void createStateNamesList(std::list<Common::UString> *stateNames = 0);
 	/** Create the model's bounding box. */
@@ -280,7 +324,12 @@ public:
 	static void readArray(Common::SeekableReadStream &stream,
 	                      uint32 offset, uint32 count, std::vector<T> &values);
 
+	/** Queue a node transformation calculated by an animation. */
+	void addAnimatedNode(ModelNode &node, float x, float y, float z,
+	                     float oX, float oY, float oZ, float oA);
+
 	friend class ModelNode;
+	friend class AnimNode;
 };
 
 } // End of namespace Aurora
@@ -609,9 +609,9 @@ void ModelNode_Jade::createMesh(Model_Jade::ParserContext &ctx) {
 	for (uint t = 0; t < textureCount; t++)
 		vertexDecl.push_back(VertexAttrib(VTCOORD + t , 2, GL_FLOAT));
 
-	_vertexBuffer.setVertexDeclInterleave(vertexCount, vertexDecl);
+	_mesh->vertexBuffer.setVertexDeclInterleave(vertexCount, vertexDecl);
 
-	float *v = reinterpret_cast<float *>(_vertexBuffer.getData());
+	float *v = reinterpret_cast<float *>(_mesh->vertexBuffer.getData());
 	for (uint32 i = 0; i < vertexCount; i++) {
 		// Position
 		*v++ = ctx.vertices[i * 3 + 0];
@@ -625,9 +625,9 @@ void ModelNode_Jade::createMesh(Model_Jade::ParserContext &ctx) {
 		}
 	}
 
-	_indexBuffer.setSize(indexCount, sizeof(uint16), GL_UNSIGNED_SHORT);
+	_mesh->indexBuffer.setSize(indexCount, sizeof(uint16), GL_UNSIGNED_SHORT);
 
-	uint16 *f = reinterpret_cast<uint16 *>(_indexBuffer.getData());
+	uint16 *f = reinterpret_cast<uint16 *>(_mesh->indexBuffer.getData());
 	memcpy(f, &ctx.indices[0], indexCount * sizeof(uint16));
 
 	createBound();
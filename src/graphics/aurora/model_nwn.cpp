@@ -605,7 +605,7 @@ void ModelNode_NWN_Binary::load(Model_NWN::ParserContext &ctx) {
 	}
 
 	// If the node has no own geometry, inherit the geometry from the root state
-	if (!(flags & kNodeFlagHasMesh) || (_render && (_vertexBuffer.getCount() == 0))) {
+	if (!(flags & kNodeFlagHasMesh) || (_render && (_mesh->vertexBuffer.getCount() == 0))) {
 		ModelNode *node = _model->getNode(_name);
 		if (node && (node != this))
 			node->inheritGeometry(*this);
@@ -839,9 +839,9 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 	for (uint t = 0; t < textureCount; t++)
 		vertexDecl.push_back(VertexAttrib(VTCOORD + t, 2, GL_FLOAT));
 
-	_vertexBuffer.setVertexDeclInterleave(facesCount * 3, vertexDecl);
+	_mesh->vertexBuffer.setVertexDeclInterleave(facesCount * 3, vertexDecl);
 
-	float *v = reinterpret_cast<float *>(_vertexBuffer.getData());
+	float *v = reinterpret_cast<float *>(_mesh->vertexBuffer.getData());
 	for (uint32 i = 0; i < facesCount; i++) {
 		const Face &face = faces[i];
 
@@ -885,9 +885,9 @@ void ModelNode_NWN_Binary::readMesh(Model_NWN::ParserContext &ctx) {
 
 	// Create index buffer
 
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
+	_mesh->indexBuffer.setSize(facesCount * 3, sizeof(uint16), GL_UNSIGNED_SHORT);
 
-	uint16 *f = reinterpret_cast<uint16 *>(_indexBuffer.getData());
+	uint16 *f = reinterpret_cast<uint16 *>(_mesh->indexBuffer.getData());
 	for (uint16 i = 0; i < facesCount * 3; i++)
 		*f++ = i;
 
@@ -1276,13 +1276,13 @@ void ModelNode_NWN_ASCII::processMesh(Mesh &mesh) {
 	// Read faces
 
 	uint32 facesCount = mesh.faceCount;
-	_indexBuffer.setSize(facesCount * 3, sizeof(uint32), GL_UNSIGNED_INT);
+	_mesh->indexBuffer.setSize(facesCount * 3, sizeof(uint32), GL_UNSIGNED_INT);
 
 	boost::unordered_set<FaceVert> verts;
 	typedef boost::unordered_set<FaceVert>::iterator verts_set_it;
 
 	uint32 vertexCount = 0;
-	uint32 *f = reinterpret_cast<uint32 *>(_indexBuffer.getData());
+	uint32 *f = reinterpret_cast<uint32 *>(_mesh->indexBuffer.getData());
 	for (uint32 i = 0; i < facesCount; i++) {
 		const uint32 v[3] = {mesh.vIA[i], mesh.vIB[i], mesh.vIC[i]};
 		const uint32 t[3] = {mesh.tIA[i], mesh.tIB[i], mesh.tIC[i]};
@@ -1318,10 +1318,10 @@ void ModelNode_NWN_ASCII::processMesh(Mesh &mesh) {
 	for (uint t = 0; t < textureCount; t++)
 		vertexDecl.push_back(VertexAttrib(VTCOORD + t, 2, GL_FLOAT));
 
-	_vertexBuffer.setVertexDeclInterleave(facesCount * 3, vertexDecl);
+	_mesh->vertexBuffer.setVertexDeclInterleave(facesCount * 3, vertexDecl);
 
 	for (verts_set_it i = verts.begin(); i != verts.end(); ++i) {
-		byte  *vData = reinterpret_cast<byte  *>(_vertexBuffer.getData()) + i->i * _vertexBuffer.getSize();
+		byte  *vData = reinterpret_cast<byte  *>(_mesh->vertexBuffer.getData()) + i->i * _mesh->vertexBuffer.getSize();
 		float *v     = reinterpret_cast<float *>(vData);
 
 		// Position
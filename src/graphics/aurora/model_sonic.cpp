@@ -1075,6 +1075,8 @@ void Model_Sonic::createBound() {
 	_absoluteBoundBox = _boundBox;
 	_absoluteBoundBox.transform(_absolutePosition);
 	_absoluteBoundBox.absolutize();
+
+	worldBoundChanged();
 }
 
 void Model_Sonic::newState(ParserContext &ctx) {
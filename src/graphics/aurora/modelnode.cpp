@@ -28,6 +28,7 @@
 #include "src/common/util.h"
 #include "src/common/maths.h"
 #include "src/common/error.h"
+#include "src/common/frustum.h"
 
 #include "src/graphics/camera.h"
 
@@ -47,8 +48,8 @@ static bool nodeComp(ModelNode *a, ModelNode *b) {
 }
 
 ModelNode::ModelNode(Model &model) :
-	_model(&model), _parent(0), _level(0), _envMapMode(kModeEnvironmentBlendedUnder),
-	_isTransparent(false), _render(false), _hasTransparencyHint(false) {
+	_model(&model), _parent(0), _level(0), _mesh(new Mesh), _envMapMode(kModeEnvironmentBlendedUnder),
+	_isTransparent(false), _render(false), _hasTransparencyHint(false), _texturesPending(false) {
 
 	_position[0] = 0.0f; _position[1] = 0.0f; _position[2] = 0.0f;
 	_rotation[0] = 0.0f; _rotation[1] = 0.0f; _rotation[2] = 0.0f;
@@ -63,8 +64,40 @@ ModelNode::ModelNode(Model &model) :
 	_scale[2] = 1.0f;
 }
 
+ModelNode::ModelNode(Model &model, const ModelNode &node) :
+	_model(&model), _parent(0), _level(node._level), _name(node._name), _mesh(node._mesh),
+	_absolutePosition(node._absolutePosition), _shininess(node._shininess), _textures(node._textures),
+	_envMap(node._envMap), _envMapMode(node._envMapMode), _isTransparent(node._isTransparent),
+	_dangly(node._dangly), _period(node._period), _tightness(node._tightness),
+	_displacement(node._displacement), _showdispl(node._showdispl), _displtype(node._displtype),
+	_constraints(node._constraints), _tilefade(node._tilefade), _render(node._render),
+	_shadow(node._shadow), _beaming(node._beaming), _inheritcolor(node._inheritcolor),
+	_rotatetexture(node._rotatetexture), _alpha(node._alpha),
+	_hasTransparencyHint(node._hasTransparencyHint), _transparencyHint(node._transparencyHint),
+	_texturesPending(false), _boundBox(node._boundBox), _absoluteBoundBox(node._absoluteBoundBox) {
+
+	// Only fully loaded nodes can be instanced
+	assert(!node._texturesPending);
+
+	memcpy(_center     , node._center     , 3 * sizeof(float));
+	memcpy(_position   , node._position   , 3 * sizeof(float));
+	memcpy(_rotation   , node._rotation   , 3 * sizeof(float));
+	memcpy(_orientation, node._orientation, 4 * sizeof(float));
+	memcpy(_scale      , node._scale      , 3 * sizeof(float));
+
+	memcpy(_wirecolor, node._wirecolor, 3 * sizeof(float));
+	memcpy(_ambient  , node._ambient  , 3 * sizeof(float));
+	memcpy(_diffuse  , node._diffuse  , 3 * sizeof(float));
+	memcpy(_specular , node._specular , 3 * sizeof(float));
+	memcpy(_selfIllum, node._selfIllum, 3 * sizeof(float));
+
+	/* The keyframes are left out: animations only ever read them from
+	 * the nodes of the model that holds the animation. */
+}
+
 ModelNode::~ModelNode() {
-	// dtor
+	if (_texturesPending)
+		_model->_pendingTextureNodes.remove(this);
 }
 
 ModelNode *ModelNode::getParent() {
@@ -199,18 +232,25 @@ void ModelNode::inheritOrientation(ModelNode &node) const {
 	node._orientation[3] = _orientation[3];
 }
 
-void ModelNode::inheritGeometry(ModelNode &node) const {
+void ModelNode::inheritGeometry(ModelNode &node) {
+	// The node needs to know our textures' properties right away
+	finishTextures();
+
 	node._textures      = _textures;
 	node._render        = _render;
 	node._isTransparent = _isTransparent;
-	node._vertexBuffer  = _vertexBuffer;
-	node._indexBuffer   = _indexBuffer;
+	node._mesh          = _mesh;
 
 	memcpy(node._center, _center, 3 * sizeof(float));
 	node._boundBox = _boundBox;
 }
 
 void ModelNode::reparent(ModelNode &parent) {
+	if (_texturesPending && (_model != parent._model)) {
+		_model->_pendingTextureNodes.remove(this);
+		parent._model->_pendingTextureNodes.push_back(this);
+	}
+
 	_model = parent._model;
 	_level = parent._level + 1;
 
@@ -279,7 +319,7 @@ void ModelNode::setEnvironmentMap(const Common::UString &environmentMap) {
 	_envMap.clear();
 
 	try {
-		_envMap = TextureMan.get(environmentMap);
+		_envMap = TextureMan.request(environmentMap);
 	} catch (...) {
 	}
 }
@@ -296,6 +336,7 @@ void ModelNode::setTextures(const std::vector<Common::UString> &textures) {
 	//       again when texture loading fails.
 	_render = true;
 	loadTextures(textures);
+	finishTextures();
 
 	unlockFrameIfVisible();
 }
@@ -305,46 +346,83 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 
 	_textures.resize(textures.size());
 
-	bool hasAlpha = true;
-	bool isDecal  = true;
-
-	Common::UString envMap;
-
 	for (size_t t = 0; t != textures.size(); t++) {
 
 		try {
 
 			if (!textures[t].empty() && (textures[t] != "NULL")) {
-				_textures[t] = TextureMan.get(textures[t]);
-				if (_textures[t].empty())
-					continue;
+				_textures[t] = TextureMan.request(textures[t]);
+				if (!_textures[t].empty())
+					hasTexture = true;
+			}
 
-				hasTexture = true;
+		} catch (Common::Exception &e) {
+			Common::printException(e, "WARNING: ");
+		}
 
-				if (!_textures[t].getTexture().hasAlpha())
-					hasAlpha = false;
-				if (_textures[t].getTexture().getTXI().getFeatures().alphaMean == 1.0f)
-					hasAlpha = false;
+	}
 
-				if (!_textures[t].getTexture().getTXI().getFeatures().decal)
-					isDecal = false;
+	// If the node has no actual texture, we just assume
+	// that the geometry shouldn't be rendered.
+	if (!hasTexture)
+		_render = false;
 
-				if (!_textures[t].getTexture().getTXI().getFeatures().bumpyShinyTexture.empty())
-					envMap = _textures[t].getTexture().getTXI().getFeatures().bumpyShinyTexture;
-				if (!_textures[t].getTexture().getTXI().getFeatures().envMapTexture.empty())
-					envMap = _textures[t].getTexture().getTXI().getFeatures().envMapTexture;
-			}
+	/* Looking at the textures' properties means waiting for them to be decoded.
+	 * Leave that for when the whole model has been loaded, so that all of its
+	 * textures can be decoded in parallel in the meantime. */
+	if (!_texturesPending) {
+		_texturesPending = true;
 
-		} catch (Common::Exception &e) {
-			Common::printException(e, "WARNING: ");
+		_model->_pendingTextureNodes.push_back(this);
+	}
+}
+
+void ModelNode::finishTextures() {
+	if (!_texturesPending)
+		return;
+
+	_texturesPending = false;
+	_model->_pendingTextureNodes.remove(this);
+
+	bool hasTexture = false;
+
+	bool hasAlpha = true;
+	bool isDecal  = true;
+
+	Common::UString envMap;
+
+	for (size_t t = 0; t != _textures.size(); t++) {
+		if (_textures[t].empty())
+			continue;
+
+		const Texture &texture = _textures[t].getTexture();
+
+		// Decoding failed
+		if (!texture.hasImage()) {
+			_textures[t].clear();
+			continue;
 		}
 
+		hasTexture = true;
+
+		if (!texture.hasAlpha())
+			hasAlpha = false;
+		if (texture.getTXI().getFeatures().alphaMean == 1.0f)
+			hasAlpha = false;
+
+		if (!texture.getTXI().getFeatures().decal)
+			isDecal = false;
+
+		if (!texture.getTXI().getFeatures().bumpyShinyTexture.empty())
+			envMap = texture.getTXI().getFeatures().bumpyShinyTexture;
+		if (!texture.getTXI().getFeatures().envMapTexture.empty())
+			envMap = texture.getTXI().getFeatures().envMapTexture;
 	}
 
 	envMap.trim();
 	if (!envMap.empty()) {
 		try {
-			_envMap = TextureMan.get(envMap);
+			_envMap = TextureMan.request(envMap);
 		} catch (Common::Exception &e) {
 			Common::printException(e, "WARNING: ");
 		}
@@ -358,8 +436,6 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 		_isTransparent = hasAlpha;
 	}
 
-	// If the node has no actual texture, we just assume
-	// that the geometry shouldn't be rendered.
 	if (!hasTexture)
 		_render = false;
 }
@@ -367,7 +443,7 @@ void ModelNode::loadTextures(const std::vector<Common::UString> &textures) {
 void ModelNode::createBound() {
 	_boundBox.clear();
 
-	const VertexDecl vertexDecl = _vertexBuffer.getVertexDecl();
+	const VertexDecl vertexDecl = _mesh->vertexBuffer.getVertexDecl();
 	for (VertexDecl::const_iterator vA = vertexDecl.begin(); vA != vertexDecl.end(); ++vA) {
 		if ((vA->index != VPOSITION) || (vA->type != GL_FLOAT))
 			continue;
@@ -380,7 +456,7 @@ void ModelNode::createBound() {
 		const float *vY = vertexData + 1;
 		const float *vZ = vertexData + 2;
 
-		for (uint32 v = 0; v < _vertexBuffer.getCount(); v++)
+		for (uint32 v = 0; v < _mesh->vertexBuffer.getCount(); v++)
 			_boundBox.add(vX[v * stride], vY[v * stride], vZ[v * stride]);
 	}
 
@@ -475,7 +551,7 @@ void ModelNode::renderGeometryNormal() {
 	if (_textures.empty())
 		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-	_vertexBuffer.draw(GL_TRIANGLES, _indexBuffer);
+	_mesh->vertexBuffer.draw(GL_TRIANGLES, _mesh->indexBuffer);
 
 	for (size_t t = 0; t < _textures.size(); t++) {
 		TextureMan.activeTexture(t);
@@ -494,14 +570,14 @@ void ModelNode::renderGeometryEnvMappedUnder() {
 	 */
 
 	TextureMan.set(_envMap, TextureManager::kModeEnvironmentMapReflective);
-	_vertexBuffer.draw(GL_TRIANGLES, _indexBuffer);
+	_mesh->vertexBuffer.draw(GL_TRIANGLES, _mesh->indexBuffer);
 
 	for (size_t t = 0; t < _textures.size(); t++) {
 		TextureMan.activeTexture(t);
 		TextureMan.set(_textures[t], TextureManager::kModeDiffuse);
 	}
 
-	_vertexBuffer.draw(GL_TRIANGLES, _indexBuffer);
+	_mesh->vertexBuffer.draw(GL_TRIANGLES, _mesh->indexBuffer);
 
 	for (size_t t = 0; t < _textures.size(); t++) {
 		TextureMan.activeTexture(t);
@@ -526,7 +602,7 @@ void ModelNode::renderGeometryEnvMappedOver() {
 
 		glBlendFunc(GL_ONE, GL_ZERO);
 
-		_vertexBuffer.draw(GL_TRIANGLES, _indexBuffer);
+		_mesh->vertexBuffer.draw(GL_TRIANGLES, _mesh->indexBuffer);
 
 		for (size_t t = 0; t < _textures.size(); t++) {
 			TextureMan.activeTexture(t);
@@ -539,7 +615,7 @@ void ModelNode::renderGeometryEnvMappedOver() {
 		glDisable(GL_ALPHA_TEST);
 		glBlendFunc(GL_ZERO, GL_ONE);
 
-		_vertexBuffer.draw(GL_TRIANGLES, _indexBuffer);
+		_mesh->vertexBuffer.draw(GL_TRIANGLES, _mesh->indexBuffer);
 	}
 
 	TextureMan.activeTexture(0);
@@ -547,7 +623,7 @@ void ModelNode::renderGeometryEnvMappedOver() {
 
 	glBlendFunc(GL_ONE_MINUS_DST_ALPHA, GL_ONE);
 
-	_vertexBuffer.draw(GL_TRIANGLES, _indexBuffer);
+	_mesh->vertexBuffer.draw(GL_TRIANGLES, _mesh->indexBuffer);
 
 	TextureMan.set();
 
@@ -555,7 +631,11 @@ void ModelNode::renderGeometryEnvMappedOver() {
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
-void ModelNode::render(RenderPass pass) {
+void ModelNode::render(RenderPass pass, const Common::Frustum *frustum) {
+	// Skip the node and its children if they're out of view
+	if (frustum && !frustum->isIn(_absoluteBoundBox))
+		return;
+
 	// Apply the node's transformation
 
 	glTranslatef(_position[0], _position[1], _position[2]);
@@ -570,7 +650,7 @@ void ModelNode::render(RenderPass pass) {
 
 	// Render the node's geometry
 
-	bool shouldRender = _render && (_indexBuffer.getCount() > 0);
+	bool shouldRender = _render && (_mesh->indexBuffer.getCount() > 0);
 	if (((pass == kRenderPassOpaque)      &&  _isTransparent) ||
 	    ((pass == kRenderPassTransparent) && !_isTransparent))
 		shouldRender = false;
@@ -582,7 +662,7 @@ void ModelNode::render(RenderPass pass) {
 	// Render the node's children
 	for (std::list<ModelNode *>::iterator c = _children.begin(); c != _children.end(); ++c) {
 		glPushMatrix();
-		(*c)->render(pass);
+		(*c)->render(pass, frustum);
 		glPopMatrix();
 	}
 }
@@ -28,6 +28,8 @@
 #include <list>
 #include <vector>
 
+#include <boost/shared_ptr.hpp>
+
 #include "src/common/ustring.h"
 #include "src/common/transmatrix.h"
 #include "src/common/boundingbox.h"
@@ -39,6 +41,10 @@
 #include "src/graphics/aurora/types.h"
 #include "src/graphics/aurora/texturehandle.h"
 
+namespace Common {
+	class Frustum;
+}
+
 namespace Graphics {
 
 namespace Aurora {
@@ -63,6 +69,11 @@ struct QuaternionKeyFrame {
 class ModelNode {
 public:
 	ModelNode(Model &model);
+	/** Create an instance of a node, to be placed into an instance of its model.
+	 *
+	 *  The instance shares the node's geometry, but not its parent and children.
+	 */
+	ModelNode(Model &model, const ModelNode &node);
 	virtual ~ModelNode();
 
 	/** Get the node's name. */
@@ -118,6 +129,12 @@ protected:
 		kModeEnvironmentBlendedOver   ///< Diffuse textures first, then blend the environment map in.
 	};
 
+	/** The geometry of a node, shared between all instances of a model. */
+	struct Mesh {
+		VertexBuffer vertexBuffer; ///< Node geometry vertex buffer.
+		IndexBuffer indexBuffer;   ///< Node geometry index buffer.
+	};
+
 	Model *_model; ///< The model this node belongs to.
 
 	ModelNode *_parent;               ///< The node's parent.
@@ -127,8 +144,7 @@ protected:
 
 	Common::UString _name; ///< The node's name.
 
-	VertexBuffer _vertexBuffer; ///< Node geometry vertex buffer.
-	IndexBuffer _indexBuffer;   ///< Node geometry index buffer.
+	boost::shared_ptr<Mesh> _mesh; ///< The node's geometry.
 
 	float _center     [3]; ///< The node's center.
 	float _position   [3]; ///< Position of the node.
@@ -181,19 +197,32 @@ protected:
 	bool _hasTransparencyHint;
 	bool _transparencyHint;
 
+	/** Are the textures still being decoded, with their properties not yet looked at? */
+	bool _texturesPending;
+
 	Common::BoundingBox _boundBox;
 	Common::BoundingBox _absoluteBoundBox;
 
 
 	// Loading helpers
+
+	/** Request the textures, leaving them to be decoded in the background. */
 	void loadTextures(const std::vector<Common::UString> &textures);
+	/** Wait for the requested textures and evaluate their properties. */
+	void finishTextures();
+
 	void createBound();
 	void createCenter();
 
 	void createAbsoluteBound();
 	void createAbsoluteBound(Common::BoundingBox parentPosition);
 
-	void render(RenderPass pass);
+	/** Render the node and its children.
+	 *
+	 *  If frustum is given, it's the view frustum in model coordinates,
+	 *  and nodes completely outside of it are skipped.
+	 */
+	void render(RenderPass pass, const Common::Frustum *frustum);
 	void drawSkeleton(const Common::TransformationMatrix &parent, bool showInvisible);
 
 	void lockFrame();
@@ -227,7 +256,7 @@ public:
 
 	void inheritPosition(ModelNode &node) const;
 	void inheritOrientation(ModelNode &node) const;
-	void inheritGeometry(ModelNode &node) const;
+	void inheritGeometry(ModelNode &node);
 
 	void reparent(ModelNode &parent);
 
@@ -22,13 +22,20 @@
  *  A texture as used in the Aurora engines.
  */
 
+#include "src/common/atomic.h"
+
 #include <cassert>
 
+#include <boost/bind.hpp>
+
 #include "src/common/types.h"
 #include "src/common/util.h"
 #include "src/common/strutil.h"
 #include "src/common/error.h"
 #include "src/common/readstream.h"
+#include "src/common/mutex.h"
+#include "src/common/threads.h"
+#include "src/common/threadpool.h"
 
 #include "src/graphics/aurora/texture.h"
 #include "src/graphics/aurora/pltfile.h"
@@ -55,6 +62,47 @@ namespace Graphics {
 
 namespace Aurora {
 
+enum PendingState {
+	kPendingDecoding, ///< Queued or currently being decoded.
+	kPendingDecoded,  ///< Decoded, waiting to be taken over by the texture.
+	kPendingTaken,    ///< Taken over by the texture.
+	kPendingFailed    ///< Decoding failed, the texture stays empty.
+};
+
+/** An image decoded in the background, shared between the texture and the decoding job.
+ *
+ *  The state only ever changes with the mutex locked. It's also atomic, so that
+ *  the main thread can check whether the image has been taken over without
+ *  locking the mutex for every texture it renders.
+ */
+struct Texture::PendingImage {
+	const Common::UString name;
+
+	/** The texture waiting for this image. 0 if it has been deleted in the meantime. */
+	Texture *texture;
+	/** Is the decoding job currently adding the texture to the new texture queue? */
+	bool queueing;
+
+	ImageDecoder *image;
+	TXI *txi;
+	::Aurora::FileType type;
+
+	boost::atomic<int> state;
+
+	Common::Mutex mutex;
+	Common::Condition changed;
+
+	PendingImage(const Common::UString &n, Texture &t) : name(n), texture(&t), queueing(false),
+		image(0), txi(0), type(::Aurora::kFileTypeNone), state(kPendingDecoding), changed(mutex) {
+	}
+
+	~PendingImage() {
+		delete txi;
+		delete image;
+	}
+};
+
+
 Texture::Texture() : _type(::Aurora::kFileTypeNone), _image(0), _txi(0), _width(0), _height(0) {
 }
 
@@ -66,6 +114,16 @@ Texture::Texture(const Common::UString &name, ImageDecoder *image, ::Aurora::Fil
 }
 
 Texture::~Texture() {
+	if (_pending) {
+		Common::StackLock lock(_pending->mutex);
+
+		_pending->texture = 0;
+
+		// Wait for the decoding job to let go of us
+		while (_pending->queueing)
+			_pending->changed.wait();
+	}
+
 	removeFromQueues();
 
 	if (_textureID != 0)
@@ -94,6 +152,50 @@ bool Texture::isDynamic() const {
 	return false;
 }
 
+bool Texture::hasImage() const {
+	// Until the image has been completely taken over, we're just a placeholder
+	if (_pending && (_pending->state.load(boost::memory_order_acquire) != kPendingTaken))
+		return false;
+
+	return _image != 0;
+}
+
+void Texture::waitForImage() {
+	if (!_pending || Common::isMainThread())
+		return;
+
+	{
+		Common::StackLock lock(_pending->mutex);
+
+		while (_pending->state.load(boost::memory_order_relaxed) == kPendingDecoding)
+			_pending->changed.wait();
+	}
+
+	/* Take over the image ourselves instead of waiting for the main thread.
+	 * The main thread might have already dropped us from the new texture queue
+	 * while we were doing that, so make sure the image still gets uploaded. */
+	if (takePendingImage())
+		addToQueue(kQueueNewTexture);
+}
+
+bool Texture::takePendingImage() {
+	if (!_pending || (_pending->state.load(boost::memory_order_acquire) != kPendingDecoded))
+		return false;
+
+	Common::StackLock lock(_pending->mutex);
+
+	if (_pending->state.load(boost::memory_order_relaxed) != kPendingDecoded)
+		return false;
+
+	set(_name, _pending->image, _pending->type, _pending->txi);
+
+	_pending->image = 0;
+	_pending->txi   = 0;
+
+	_pending->state.store(kPendingTaken, boost::memory_order_release);
+	return true;
+}
+
 static const TXI kEmptyTXI;
 const TXI &Texture::getTXI() const {
 	if (_txi)
@@ -155,7 +257,9 @@ void Texture::doDestroy() {
 }
 
 void Texture::doRebuild() {
-	if (!_image)
+	takePendingImage();
+
+	if (!hasImage())
 		// No image
 		return;
 
@@ -375,6 +479,74 @@ Texture *Texture::create(ImageDecoder *image, ::Aurora::FileType type, TXI *txi)
 	return new Texture("", image, type, txi);
 }
 
+Texture *Texture::createAsync(const Common::UString &name, Common::ThreadPool &pool) {
+	Texture *texture = new Texture;
+
+	texture->_name = name;
+	texture->_pending.reset(new PendingImage(name, *texture));
+
+	// Only joins the new texture queue once the image has been decoded
+	texture->addToQueue(kQueueTexture);
+
+	pool.addJob(boost::bind(&Texture::decodePendingImage, texture->_pending));
+
+	return texture;
+}
+
+void Texture::decodePendingImage(boost::shared_ptr<PendingImage> pending) {
+	{
+		Common::StackLock lock(pending->mutex);
+
+		// Nobody is interested in this image anymore
+		if (!pending->texture)
+			return;
+	}
+
+	::Aurora::FileType type = ::Aurora::kFileTypeNone;
+	ImageDecoder *image = 0;
+	TXI *txi = 0;
+
+	try {
+
+		txi   = loadTXI  (pending->name);
+		image = loadImage(pending->name, type, txi);
+
+	} catch (Common::Exception &e) {
+		delete txi;
+		txi = 0;
+
+		e.add("Failed to create texture \"%s\" (%d)", pending->name.c_str(), type);
+		Common::printException(e, "WARNING: ");
+	}
+
+	Texture *texture = 0;
+	{
+		Common::StackLock lock(pending->mutex);
+
+		pending->image = image;
+		pending->txi   = txi;
+		pending->type  = type;
+
+		pending->state.store(image ? kPendingDecoded : kPendingFailed, boost::memory_order_release);
+		pending->changed.broadcast();
+
+		if (!image || !pending->texture)
+			return;
+
+		texture = pending->texture;
+		pending->queueing = true;
+	}
+
+	/* Let the main thread take over the image and upload it. The queue is locked
+	 * while the main thread takes over images, so we can't hold our own mutex here. */
+	texture->addToQueue(kQueueNewTexture);
+
+	Common::StackLock lock(pending->mutex);
+
+	pending->queueing = false;
+	pending->changed.broadcast();
+}
+
 void Texture::set(const Common::UString &name, ImageDecoder *image, ::Aurora::FileType type, TXI *txi) {
 	delete _image;
 	delete _txi;
@@ -25,6 +25,8 @@
 #ifndef GRAPHICS_AURORA_TEXTURE_H
 #define GRAPHICS_AURORA_TEXTURE_H
 
+#include <boost/shared_ptr.hpp>
+
 #include "src/common/ustring.h"
 
 #include "src/graphics/types.h"
@@ -34,6 +36,7 @@
 
 namespace Common {
 	class SeekableReadStream;
+	class ThreadPool;
 }
 
 namespace Graphics {
@@ -56,6 +59,16 @@ public:
 	/** Is this a dynamic texture, or a shared static one? */
 	virtual bool isDynamic() const;
 
+	/** Does this texture have an image yet? */
+	bool hasImage() const;
+
+	/** Wait until the image of a texture created with createAsync() is available.
+	 *
+	 *  Does nothing in the main thread, which will simply keep rendering the
+	 *  placeholder until the image arrives.
+	 */
+	void waitForImage();
+
 	/** Return the TXI. */
 	const TXI &getTXI() const;
 	/** Return the image. */
@@ -78,6 +91,16 @@ public:
 	/** Take over the image and create a texture from it. */
 	static Texture *create(ImageDecoder *image, ::Aurora::FileType type = ::Aurora::kFileTypeNone, TXI *txi = 0);
 
+	/** Create a placeholder texture for this image resource, and decode the image in the background.
+	 *
+	 *  The image and its TXI are loaded and decoded by a job on the thread pool. Once
+	 *  that's done, the main thread takes over the image and uploads it. Until then, the
+	 *  texture has no image and is rendered as untextured.
+	 *
+	 *  PLT images are not supported, since they need their own texture class.
+	 */
+	static Texture *createAsync(const Common::UString &name, Common::ThreadPool &pool);
+
 
 protected:
 	Common::UString    _name; ///< The name of the texture's image's file.
@@ -89,6 +112,11 @@ protected:
 	uint32 _width;
 	uint32 _height;
 
+	struct PendingImage;
+
+	/** The image still being decoded in the background, for textures created with createAsync(). */
+	boost::shared_ptr<PendingImage> _pending;
+
 
 	Texture();
 	Texture(const Common::UString &name, ImageDecoder *image, ::Aurora::FileType type, TXI *txi = 0);
@@ -105,6 +133,9 @@ protected:
 	void doDestroy();
 
 
+	/** Take over the image decoded in the background, if it's ready. */
+	bool takePendingImage();
+
 	void create2DTexture();
 	void createCubeMapTexture();
 
@@ -115,6 +146,8 @@ protected:
 	static ImageDecoder *loadImage(const Common::UString &name, ::Aurora::FileType &type, TXI *txi);
 
 	static Texture *createPLT(const Common::UString &name, Common::SeekableReadStream *imageStream);
+
+	static void decodePendingImage(boost::shared_ptr<PendingImage> pending);
 };
 
 } // End of namespace Aurora
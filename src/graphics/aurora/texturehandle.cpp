@@ -85,7 +85,10 @@ void TextureHandle::clear() {
 Texture &TextureHandle::getTexture() const {
 	assert(!_empty);
 
-	return *_it->second->texture;
+	Texture &texture = *_it->second->texture;
+
+	texture.waitForImage();
+	return texture;
 }
 
 } // End of namespace Aurora
@@ -61,6 +61,7 @@ public:
 
 	void clear();
 
+	/** Return the texture. Outside the main thread, wait for its image to be decoded first. */
 	Texture &getTexture() const;
 
 private:
@@ -25,6 +25,7 @@
 #include "src/common/util.h"
 #include "src/common/error.h"
 #include "src/common/uuid.h"
+#include "src/common/threadpool.h"
 
 #include "src/graphics/aurora/textureman.h"
 #include "src/graphics/aurora/texture.h"
@@ -35,16 +36,22 @@
 
 #include "src/events/requests.h"
 
+#include "src/aurora/resman.h"
+
 DECLARE_SINGLETON(Graphics::Aurora::TextureManager)
 
 namespace Graphics {
 
 namespace Aurora {
 
-TextureManager::TextureManager() : _recordNewTextures(false) {
+TextureManager::TextureManager() : _decodePool(0), _recordNewTextures(false) {
 }
 
 TextureManager::~TextureManager() {
+	/* Stop decoding first, the jobs don't need the textures to be around.
+	 * This drops queued decodes and waits for the running ones to finish. */
+	delete _decodePool;
+
 	clear();
 }
 
@@ -140,6 +147,35 @@ TextureHandle TextureManager::get(Common::UString name) {
 	return TextureHandle(texture);
 }
 
+TextureHandle TextureManager::request(const Common::UString &name) {
+	Common::StackLock lock(_mutex);
+
+	if (_bogusTextures.find(name) != _bogusTextures.end())
+		return TextureHandle();
+
+	TextureMap::iterator texture = _textures.find(name);
+	if (texture == _textures.end()) {
+		/* PLT textures are dynamic and have their own class, and cube maps might be
+		 * spread over several image files. Just load those synchronously. Same for
+		 * missing images, so that the caller gets the exception right away. */
+		if (!ResMan.hasResource(name, ::Aurora::kResourceImage) ||
+		     ResMan.hasResource(name, ::Aurora::kFileTypePLT))
+			return get(name);
+
+		if (!_decodePool)
+			_decodePool = new Common::ThreadPool;
+
+		ManagedTexture *managedTexture = new ManagedTexture(Texture::createAsync(name, *_decodePool));
+
+		texture = _textures.insert(std::make_pair(name, managedTexture)).first;
+	}
+
+	if (_recordNewTextures)
+		_newTextureNames.push_back(name);
+
+	return TextureHandle(texture);
+}
+
 TextureHandle TextureManager::getIfExist(const Common::UString &name) {
 	Common::StackLock lock(_mutex);
 
@@ -234,6 +270,12 @@ void TextureManager::set(const TextureHandle &handle, TextureMode mode) {
 		return;
 	}
 
+	// The image is still being decoded, so render untextured for now
+	if (!handle._it->second->texture->hasImage()) {
+		set();
+		return;
+	}
+
 	TextureID id = handle._it->second->texture->getID();
 	if (id == 0)
 		warning("Empty texture ID for texture \"%s\"", handle._it->first.c_str());
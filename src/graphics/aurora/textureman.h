@@ -35,6 +35,10 @@
 
 #include "src/graphics/aurora/texturehandle.h"
 
+namespace Common {
+	class ThreadPool;
+}
+
 namespace Graphics {
 
 namespace Aurora {
@@ -68,6 +72,16 @@ public:
 	TextureHandle add(Texture *texture, Common::UString name = "");
 	/** Retrieve this named texture, loading it if it's not yet managed. */
 	TextureHandle get(Common::UString name);
+	/** Retrieve this named texture, decoding it in the background if it's not yet managed.
+	 *
+	 *  Instead of loading the texture immediately, a placeholder is created, while
+	 *  the image is loaded and decoded on a pool of worker threads. Until the image
+	 *  has been uploaded by the main thread, the texture is rendered untextured.
+	 *
+	 *  Accessing the texture through TextureHandle::getTexture() outside of the
+	 *  main thread waits for the image to be decoded.
+	 */
+	TextureHandle request(const Common::UString &name);
 	/** Retrieve this named texture, returning an empty handle if it's not managed. */
 	TextureHandle getIfExist(const Common::UString &name);
 
@@ -99,6 +113,8 @@ private:
 
 	Common::Mutex _mutex;
 
+	Common::ThreadPool *_decodePool; ///< The worker threads decoding requested textures.
+
 	bool _recordNewTextures;
 	std::list<Common::UString> _newTextureNames;
 
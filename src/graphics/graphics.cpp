@@ -33,6 +33,7 @@
 #include "src/common/error.h"
 #include "src/common/configman.h"
 #include "src/common/threads.h"
+#include "src/common/threadpool.h"
 #include "src/common/transmatrix.h"
 #include "src/common/vector3.h"
 
@@ -101,6 +102,11 @@ GraphicsManager::GraphicsManager() {
 
 	_frameLock.store(0);
 
+	_worldObjectsDrawn.store(0);
+	_worldObjectsCulled.store(0);
+
+	_animationPool = 0;
+
 	_cursor = 0;
 	_cursorState = kCursorStateStay;
 
@@ -118,6 +124,7 @@ GraphicsManager::GraphicsManager() {
 GraphicsManager::~GraphicsManager() {
 	deinit();
 
+	delete _animationPool;
 	delete _fpsCounter;
 }
 
@@ -198,6 +205,14 @@ uint32 GraphicsManager::getFPS() const {
 	return _fpsCounter->getFPS();
 }
 
+uint32 GraphicsManager::getWorldObjectsDrawn() const {
+	return _worldObjectsDrawn.load(boost::memory_order_relaxed);
+}
+
+uint32 GraphicsManager::getWorldObjectsCulled() const {
+	return _worldObjectsCulled.load(boost::memory_order_relaxed);
+}
+
 void GraphicsManager::initSize(int width, int height, bool fullscreen) {
 	uint32 flags = SDL_WINDOW_OPENGL;
 
@@ -895,26 +910,49 @@ Renderable *GraphicsManager::getWorldObjectAt(float x, float y) const {
 	Renderable *object = 0;
 
 	QueueMan.lockQueue(kQueueVisibleWorldObject);
-	const std::list<Queueable *> &objects = QueueMan.getQueue(kQueueVisibleWorldObject);
+	_pickingMutex.lock();
 
-	for (std::list<Queueable *>::const_iterator o = objects.begin(); o != objects.end(); ++o) {
-		Renderable &r = static_cast<Renderable &>(**o);
+	// Find all objects whose bounding boxes might intersect with the line
+	std::vector<void *> candidates;
+	_pickingTree.findIntersecting(x1, y1, z1, x2, y2, z2, candidates);
 
-		if (!r.isClickable())
+	for (std::vector<void *>::const_iterator c = candidates.begin(); c != candidates.end(); ++c) {
+		Renderable &r = *static_cast<Renderable *>(*c);
+
+		if (!r.isClickable() || !r.isVisible())
 			// Object isn't clickable, don't check
 			continue;
 
-		// If the line intersects with the object, return it
-		if (r.isIn(x1, y1, z1, x2, y2, z2)) {
-			object = &r;
-			break;
-		}
+		// Of all objects the line intersects with, return the closest one
+		if (r.isIn(x1, y1, z1, x2, y2, z2))
+			if (!object || (r.getDistance() < object->getDistance()))
+				object = &r;
 	}
 
+	_pickingMutex.unlock();
 	QueueMan.unlockQueue(kQueueVisibleWorldObject);
+
 	return object;
 }
 
+uint32 GraphicsManager::addPickable(Renderable &renderable, const Common::BoundingBox &bound) {
+	Common::StackLock lock(_pickingMutex);
+
+	return _pickingTree.insert(bound, &renderable);
+}
+
+void GraphicsManager::updatePickable(uint32 id, const Common::BoundingBox &bound) {
+	Common::StackLock lock(_pickingMutex);
+
+	_pickingTree.update(id, bound);
+}
+
+void GraphicsManager::removePickable(uint32 id) {
+	Common::StackLock lock(_pickingMutex);
+
+	_pickingTree.remove(id);
+}
+
 Renderable *GraphicsManager::getObjectAt(float x, float y) {
 	Renderable *object = 0;
 
@@ -1026,29 +1064,49 @@ bool GraphicsManager::renderWorld() {
 	float elapsedTime = (now - _lastSampled) / 1000.0f;
 	_lastSampled = now;
 
+	_worldObjects.clear();
+	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
+	     o != objects.rend(); ++o)
+		_worldObjects.push_back(static_cast<Renderable *>(*o));
+
 	// If game paused, skip the advanceTime loop below
 
 	// Advance time for animation queues
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
-		static_cast<Renderable *>(*o)->advanceTime(elapsedTime);
+	advanceWorldObjects(elapsedTime);
+
+	// Cull the objects against the view frustum
+	_frustum.setMatrix(_projection * _modelview);
+
+	uint32 culled = 0;
+
+	_visibleWorldObjects.clear();
+	for (std::vector<Renderable *>::const_iterator o = _worldObjects.begin();
+	     o != _worldObjects.end(); ++o) {
+
+		if ((*o)->isInFrustum(_frustum))
+			_visibleWorldObjects.push_back(*o);
+		else
+			culled++;
 	}
 
+	_worldObjectsDrawn.store(_visibleWorldObjects.size(), boost::memory_order_relaxed);
+	_worldObjectsCulled.store(culled, boost::memory_order_relaxed);
+
 	// Draw opaque objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
+	for (std::vector<Renderable *>::const_iterator o = _visibleWorldObjects.begin();
+	     o != _visibleWorldObjects.end(); ++o) {
 
 		glPushMatrix();
-		static_cast<Renderable *>(*o)->render(kRenderPassOpaque);
+		(*o)->render(kRenderPassOpaque);
 		glPopMatrix();
 	}
 
 	// Draw transparent objects
-	for (std::list<Queueable *>::const_reverse_iterator o = objects.rbegin();
-	     o != objects.rend(); ++o) {
+	for (std::vector<Renderable *>::const_iterator o = _visibleWorldObjects.begin();
+	     o != _visibleWorldObjects.end(); ++o) {
 
 		glPushMatrix();
-		static_cast<Renderable *>(*o)->render(kRenderPassTransparent);
+		(*o)->render(kRenderPassTransparent);
 		glPopMatrix();
 	}
 
@@ -1056,6 +1114,44 @@ bool GraphicsManager::renderWorld() {
 	return true;
 }
 
+/** Advance the time of a range of world objects. Run on the animation worker threads. */
+static void advanceTime(Renderable **objects, size_t count, float dt) {
+	for (size_t i = 0; i < count; i++)
+		objects[i]->advanceTime(dt);
+}
+
+void GraphicsManager::advanceWorldObjects(float dt) {
+	// Below this many objects, spreading the work isn't worth it
+	static const size_t kMinParallelObjects = 16;
+
+	const size_t count = _worldObjects.size();
+	if (count == 0)
+		return;
+
+	/* Calculating the new animation frames doesn't touch OpenGL or anything
+	 * shared between objects, so we spread it over several worker threads.
+	 * Applying the results then happens here, one object after the other. */
+
+	if ((count >= kMinParallelObjects) && (Common::ThreadPool::getCPUCount() > 1)) {
+		if (!_animationPool)
+			_animationPool = new Common::ThreadPool;
+
+		// Give each thread a few jobs, so that they're spread evenly
+		const size_t jobCount  = 4 * _animationPool->getThreadCount();
+		const size_t chunkSize = (count + jobCount - 1) / jobCount;
+
+		for (size_t i = 0; i < count; i += chunkSize)
+			_animationPool->addJob(boost::bind(&advanceTime, &_worldObjects[i], MIN(chunkSize, count - i), dt));
+
+		_animationPool->wait();
+
+	} else
+		advanceTime(&_worldObjects[0], count, dt);
+
+	for (std::vector<Renderable *>::const_iterator o = _worldObjects.begin(); o != _worldObjects.end(); ++o)
+		(*o)->finishAdvanceTime();
+}
+
 bool GraphicsManager::renderGUIFront() {
 	if (QueueMan.isQueueEmpty(kQueueVisibleGUIFrontObject))
 		return false;
@@ -36,9 +36,16 @@
 #include "src/common/singleton.h"
 #include "src/common/mutex.h"
 #include "src/common/transmatrix.h"
+#include "src/common/frustum.h"
+#include "src/common/aabbtree.h"
 #include "src/common/vector3.h"
 #include "src/common/ustring.h"
 
+namespace Common {
+	class BoundingBox;
+	class ThreadPool;
+}
+
 namespace Graphics {
 
 class FPSCounter;
@@ -102,6 +109,11 @@ public:
 	/** How many frames per second to we render at the moments? */
 	uint32 getFPS() const;
 
+	/** How many world objects were drawn in the last frame? */
+	uint32 getWorldObjectsDrawn() const;
+	/** How many world objects were culled, i.e. not drawn because they were out of view, in the last frame? */
+	uint32 getWorldObjectsCulled() const;
+
 	/** Set the window's title. */
 	void setWindowTitle(const Common::UString &title = "");
 
@@ -142,6 +154,16 @@ public:
 	/** Recalculate all object distances to the camera and resort the objebts. */
 	void recalculateObjectDistances();
 
+	/** Add a visible world object with this bounding box to the picking tree.
+	 *
+	 *  @return The ID of the object within the picking tree.
+	 */
+	uint32 addPickable(Renderable &renderable, const Common::BoundingBox &bound);
+	/** The bounding box of the object with this ID in the picking tree changed. */
+	void updatePickable(uint32 id, const Common::BoundingBox &bound);
+	/** Remove the object with this ID from the picking tree. */
+	void removePickable(uint32 id);
+
 	/** Lock the frame mutex. */
 	void lockFrame();
 	/** Unlock the frame mutex. */
@@ -224,6 +246,25 @@ private:
 	Common::TransformationMatrix _modelview;     ///< Our base modelview matrix (i.e camera view).
 	Common::TransformationMatrix _modelviewInv;  ///< The inverse of our modelview matrix.
 
+	Common::Frustum _frustum; ///< The view frustum of the current frame, in world coordinates.
+
+	/** All visible world objects in the current frame, from back to front. */
+	std::vector<Renderable *> _worldObjects;
+
+	/** Worker threads advancing the animations of the world objects. */
+	Common::ThreadPool *_animationPool;
+
+	/** The world objects within the view frustum in the current frame. */
+	std::vector<Renderable *> _visibleWorldObjects;
+
+	boost::atomic<uint32> _worldObjectsDrawn;  ///< Number of world objects drawn in the last frame.
+	boost::atomic<uint32> _worldObjectsCulled; ///< Number of world objects culled in the last frame.
+
+	/** The bounding boxes of all visible world objects, to find the objects under the cursor. */
+	Common::AABBTree _pickingTree;
+	/** A mutex protecting the picking tree. */
+	mutable Common::Mutex _pickingMutex;
+
 	boost::atomic<uint32> _frameLock;
 	boost::atomic<bool>   _frameEndSignal;
 
@@ -272,6 +313,9 @@ private:
 
 	void buildNewTextures();
 
+	/** Advance the time of all world objects in _worldObjects. */
+	void advanceWorldObjects(float dt);
+
 	void beginScene();
 	bool playVideo();
 	bool renderWorld();
@@ -26,7 +26,6 @@
 
 #include "src/common/util.h"
 #include "src/common/error.h"
-#include "src/common/memreadstream.h"
 
 #include "src/graphics/graphics.h"
 
@@ -229,16 +228,12 @@ void ImageDecoder::decompress(MipMap &out, const MipMap &in, PixelFormatRaw form
 	out.size   = out.width * out.height * 4;
 	out.data   = new byte[out.size];
 
-	Common::MemoryReadStream *stream = new Common::MemoryReadStream(in.data, in.size);
-
 	if      (format == kPixelFormatDXT1)
-		decompressDXT1(out.data, *stream, out.width, out.height, out.width * 4);
+		decompressDXT1(out.data, in.data, in.size, out.width, out.height, out.width * 4);
 	else if (format == kPixelFormatDXT3)
-		decompressDXT3(out.data, *stream, out.width, out.height, out.width * 4);
+		decompressDXT3(out.data, in.data, in.size, out.width, out.height, out.width * 4);
 	else if (format == kPixelFormatDXT5)
-		decompressDXT5(out.data, *stream, out.width, out.height, out.width * 4);
-
-	delete stream;
+		decompressDXT5(out.data, in.data, in.size, out.width, out.height, out.width * 4);
 }
 
 void ImageDecoder::decompress() {
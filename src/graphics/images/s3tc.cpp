@@ -22,173 +22,204 @@
  *  Manual S3TC DXTn decompression methods.
  */
 
+#include <cstring>
+
 #include "src/common/util.h"
-#include "src/common/readstream.h"
+#include "src/common/error.h"
+#include "src/common/endianness.h"
 
 #include "src/graphics/images/s3tc.h"
 
+/* All DXTn variants are decoded straight out of the compressed buffer, using
+ * integer arithmetic only. The interpolation formulas below produce exactly
+ * the same values as the original floating point weights (1/3 and 2/3 as
+ * 0.333333f and 0.666666f, truncated), so the decompressed images are
+ * bit-identical to the ones created by the old stream-based decoder.
+ *
+ * The same goes for the placement of the pixels within an image: the block
+ * layout for images smaller than a block, as well as the DXT3 alpha row
+ * order, are kept as they were. Blocks crossing the image edges are clipped.
+ */
+
 namespace Graphics {
 
-static uint32 convert565To8888(uint16 color) {
-	return ((color & 0x1F) << 11) | ((color & 0x7E0) << 13) | ((color & 0xF800) << 16) | 0xFF;
+static const uint32 kDXT1BlockSize = 8;
+static const uint32 kDXT3BlockSize = 16;
+static const uint32 kDXT5BlockSize = 16;
+
+/** Make sure the source buffer is large enough for all blocks of the image. */
+static void checkSize(uint32 width, uint32 height, size_t srcSize, uint32 blockSize) {
+	const size_t blocks = (size_t) ((width + 3) / 4) * ((height + 3) / 4);
+
+	if ((blocks * blockSize) > srcSize)
+		throw Common::Exception(Common::kReadError);
 }
 
-static uint32 interpolate32(double weight, uint32 color_0, uint32 color_1) {
-	byte r[3], g[3], b[3], a[3];
-	r[0] = color_0 >> 24;
-	r[1] = color_1 >> 24;
-	r[2] = (byte)((1.0f - weight) * (double)r[0] + weight * (double)r[1]);
-	g[0] = (color_0 >> 16) & 0xFF;
-	g[1] = (color_1 >> 16) & 0xFF;
-	g[2] = (byte)((1.0f - weight) * (double)g[0] + weight * (double)g[1]);
-	b[0] = (color_0 >> 8) & 0xFF;
-	b[1] = (color_1 >> 8) & 0xFF;
-	b[2] = (byte)((1.0f - weight) * (double)b[0] + weight * (double)b[1]);
-	a[0] = color_0 & 0xFF;
-	a[1] = color_1 & 0xFF;
-	a[2] = (byte)((1.0f - weight) * (double)a[0] + weight * (double)a[1]);
-	return r[2] << 24 | g[2] << 16 | b[2] << 8 | a[2];
+/** Expand a RGB565 color into 8-bit RGB components. */
+static inline void convert565To888(byte *color, uint16 c) {
+	color[0] = (c >> 8) & 0xF8;
+	color[1] = (c >> 3) & 0xFC;
+	color[2] = (c << 3) & 0xF8;
 }
 
-struct DXT1Texel {
-	uint16 color_0;
-	uint16 color_1;
-	uint32 pixels;
+/** Interpolate 1/3 of the way from a to b. */
+static inline byte interpolateThird(byte a, byte b) {
+	return (2 * a + b - (b > a)) / 3;
+}
+
+/** Interpolate 2/3 of the way from a to b. */
+static inline byte interpolateTwoThirds(byte a, byte b) {
+	return (a + 2 * b - (b > a)) / 3;
+}
+
+/** Create the 4-entry RGBA color palette of a DXTn color block.
+ *
+ *  @param palette The palette to fill.
+ *  @param block The color block (2 RGB565 colors, followed by the indices).
+ *  @param alpha The alpha value of the two base colors.
+ *  @param punchThrough Use the DXT1 1-bit alpha mode if color_0 <= color_1?
+ */
+static inline void createPalette(byte palette[4][4], const byte *block, byte alpha, bool punchThrough) {
+	const uint16 color0 = READ_LE_UINT16(block + 0);
+	const uint16 color1 = READ_LE_UINT16(block + 2);
+
+	convert565To888(palette[0], color0);
+	convert565To888(palette[1], color1);
+
+	palette[0][3] = alpha;
+	palette[1][3] = alpha;
+
+	if (!punchThrough || (color0 > color1)) {
+		for (int i = 0; i < 4; i++) {
+			palette[2][i] = interpolateThird(palette[0][i], palette[1][i]);
+			palette[3][i] = interpolateTwoThirds(palette[0][i], palette[1][i]);
+		}
+	} else {
+		for (int i = 0; i < 4; i++) {
+			palette[2][i] = (palette[0][i] + palette[1][i]) >> 1;
+			palette[3][i] = 0;
+		}
+	}
+}
+
+/** The visible part of a 4x4 block within the destination image. */
+struct BlockArea {
+	uint32 width;  ///< Number of block columns to decode.
+	uint32 height; ///< Number of block rows to decode.
+
+	byte *rows[4]; ///< Destination of each block row, or 0 if it's outside the image.
+	uint32 columns; ///< Number of block columns inside the image.
+
+	BlockArea(byte *dest, uint32 tx, int32 ty, uint32 imageWidth, uint32 imageHeight, uint32 pitch) {
+		width  = MIN<uint32>(imageWidth , 4);
+		height = MIN<uint32>(imageHeight, 4);
+
+		columns = MIN<uint32>(width, imageWidth - tx);
+
+		for (uint32 y = 0; y < 4; y++) {
+			const int32 row = (int32)imageHeight - 1 - (ty - (int32)height + (int32)y);
+
+			rows[y] = 0;
+			if ((y < height) && (row >= 0) && (row < (int32)imageHeight))
+				rows[y] = dest + row * pitch + tx * 4;
+		}
+	}
 };
 
-#define READ_DXT1_TEXEL(x) \
-	x.color_0 = src.readUint16LE(); \
-	x.color_1 = src.readUint16LE(); \
-	x.pixels = src.readUint32BE()
+void decompressDXT1(byte *dest, const byte *src, size_t srcSize, uint32 width, uint32 height, uint32 pitch) {
+	checkSize(width, height, srcSize, kDXT1BlockSize);
 
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
 	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT1Texel tex;
-			READ_DXT1_TEXEL(tex);
-			uint32 blended[4];
-
-			blended[0] = convert565To8888(tex.color_0);
-			blended[1] = convert565To8888(tex.color_1);
-
-			if (tex.color_0 > tex.color_1) {
-				blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-				blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-			} else {
-				blended[2] = interpolate32(0.5f, blended[0], blended[1]);
-				blended[3] = 0;
-			}
+		for (uint32 tx = 0; tx < width; tx += 4, src += kDXT1BlockSize) {
+			byte palette[4][4];
+			createPalette(palette, src, 0xFF, true);
 
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
+			const BlockArea area(dest, tx, ty, width, height, pitch);
 
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3]);
-					cpx >>= 2;
-				}
+			uint32 cpx = READ_BE_UINT32(src + 4);
+			for (uint32 y = 0; y < area.height; y++, cpx >>= 2 * area.width) {
+				if (!area.rows[y])
+					continue;
+
+				for (uint32 x = 0; x < area.columns; x++)
+					std::memcpy(area.rows[y] + x * 4, palette[(cpx >> (2 * x)) & 3], 4);
 			}
 		}
 	}
 }
 
-struct DXT23Texel : public DXT1Texel {
-	uint16 alpha[4];
-};
-
-#define READ_DXT3_TEXEL(x) \
-	x.alpha[0] = src.readUint16LE(); \
-	x.alpha[1] = src.readUint16LE(); \
-	x.alpha[2] = src.readUint16LE(); \
-	x.alpha[3] = src.readUint16LE(); \
-	READ_DXT1_TEXEL(x)
+void decompressDXT3(byte *dest, const byte *src, size_t srcSize, uint32 width, uint32 height, uint32 pitch) {
+	checkSize(width, height, srcSize, kDXT3BlockSize);
 
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
 	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			DXT23Texel tex;
-			uint32 blended[4];
-			READ_DXT3_TEXEL(tex);
-
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
-
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
-
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					uint32 alpha = (tex.alpha[y] >> (x * 4)) & 0xF;
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3] | alpha << 4);
-					cpx >>= 2;
+		for (uint32 tx = 0; tx < width; tx += 4, src += kDXT3BlockSize) {
+			byte palette[4][4];
+			createPalette(palette, src + 8, 0x00, false);
+
+			const BlockArea area(dest, tx, ty, width, height, pitch);
+
+			uint32 cpx = READ_BE_UINT32(src + 12);
+			for (uint32 y = 0; y < area.height; y++, cpx >>= 2 * area.width) {
+				if (!area.rows[y])
+					continue;
+
+				const uint16 alpha = READ_LE_UINT16(src + 2 * y);
+
+				for (uint32 x = 0; x < area.columns; x++) {
+					byte *pixel = area.rows[y] + x * 4;
+
+					std::memcpy(pixel, palette[(cpx >> (2 * x)) & 3], 4);
+					pixel[3] = ((alpha >> (x * 4)) & 0xF) << 4;
 				}
 			}
 		}
 	}
 }
 
-struct DXT45Texel : public DXT1Texel {
-	byte alpha_0;
-	byte alpha_1;
-	uint64 alphabl;
-};
+/** Create the 8-entry alpha palette of a DXT5 alpha block. */
+static inline void createAlphaPalette(byte palette[8], byte alpha0, byte alpha1) {
+	palette[0] = alpha0;
+	palette[1] = alpha1;
+
+	if (alpha0 > alpha1) {
+		for (int i = 1; i < 7; i++)
+			palette[i + 1] = ((7 - i) * alpha0 + i * alpha1 + 3) / 7;
+	} else {
+		for (int i = 1; i < 5; i++)
+			palette[i + 1] = ((5 - i) * alpha0 + i * alpha1 + 2) / 5;
 
-static uint64 readUint48LE(Common::SeekableReadStream &src) {
-	uint64 output = src.readUint32LE();
-	return output | ((uint64)src.readUint16LE() << 32);
+		palette[6] = 0;
+		palette[7] = 255;
+	}
 }
 
-#define READ_DXT5_TEXEL(x) \
-	x.alpha_0 = src.readByte(); \
-	x.alpha_1 = src.readByte(); \
-	x.alphabl = readUint48LE(src); \
-	READ_DXT1_TEXEL(x)
+void decompressDXT5(byte *dest, const byte *src, size_t srcSize, uint32 width, uint32 height, uint32 pitch) {
+	checkSize(width, height, srcSize, kDXT5BlockSize);
 
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch) {
 	for (int32 ty = height; ty > 0; ty -= 4) {
-		for (uint32 tx = 0; tx < width; tx += 4) {
-			uint32 blended[4];
-			byte alphab[8];
-			DXT45Texel tex;
-			READ_DXT5_TEXEL(tex);
-
-			alphab[0] = tex.alpha_0;
-			alphab[1] = tex.alpha_1;
-
-			if (tex.alpha_0 > tex.alpha_1) {
-				alphab[2] = (byte)((6.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[3] = (byte)((5.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[4] = (byte)((4.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[5] = (byte)((3.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[6] = (byte)((2.0f * (double)alphab[0] + 5.0f * (double)alphab[1] + 3.0f) / 7.0f);
-				alphab[7] = (byte)((1.0f * (double)alphab[0] + 6.0f * (double)alphab[1] + 3.0f) / 7.0f);
-			} else {
-				alphab[2] = (byte)((4.0f * (double)alphab[0] + 1.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[3] = (byte)((3.0f * (double)alphab[0] + 2.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[4] = (byte)((2.0f * (double)alphab[0] + 3.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[5] = (byte)((1.0f * (double)alphab[0] + 4.0f * (double)alphab[1] + 2.0f) / 5.0f);
-				alphab[6] = 0;
-				alphab[7] = 255;
-			}
+		for (uint32 tx = 0; tx < width; tx += 4, src += kDXT5BlockSize) {
+			byte alphaPalette[8];
+			createAlphaPalette(alphaPalette, src[0], src[1]);
+
+			const uint64 alphaBits = READ_LE_UINT32(src + 2) | ((uint64) READ_LE_UINT16(src + 6) << 32);
+
+			byte palette[4][4];
+			createPalette(palette, src + 8, 0x00, false);
+
+			const BlockArea area(dest, tx, ty, width, height, pitch);
+
+			uint32 cpx = READ_BE_UINT32(src + 12);
+			for (uint32 y = 0; y < area.height; y++, cpx >>= 2 * area.width) {
+				if (!area.rows[y])
+					continue;
 
-			blended[0] = convert565To8888(tex.color_0) & 0xFFFFFF00;
-			blended[1] = convert565To8888(tex.color_1) & 0xFFFFFF00;
-			blended[2] = interpolate32(0.333333f, blended[0], blended[1]);
-			blended[3] = interpolate32(0.666666f, blended[0], blended[1]);
+				const uint32 alphaRow = (uint32) (alphaBits >> (12 * (3 - y)));
 
-			uint32 cpx = tex.pixels;
-			uint32 blockWidth = MIN<uint32>(width, 4);
-			uint32 blockHeight = MIN<uint32>(height, 4);
+				for (uint32 x = 0; x < area.columns; x++) {
+					byte *pixel = area.rows[y] + x * 4;
 
-			for (byte y = 0; y < blockHeight; ++y) {
-				for (byte x = 0; x < blockWidth; ++x) {
-					uint32 alpha = alphab[(tex.alphabl >> (3 * (4 * (3 - y) + x))) & 7];
-					WRITE_BE_UINT32(dest + (height - 1 - (ty - blockHeight + y)) * pitch + (tx + x) * 4, blended[cpx & 3] | alpha);
-					cpx >>= 2;
+					std::memcpy(pixel, palette[(cpx >> (2 * x)) & 3], 4);
+					pixel[3] = alphaPalette[(alphaRow >> (3 * x)) & 7];
 				}
 			}
 		}
@@ -27,15 +27,22 @@
 
 #include "src/common/types.h"
 
-namespace Common {
-	class SeekableReadStream;
-}
-
 namespace Graphics {
 
-void decompressDXT1(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT3(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
-void decompressDXT5(byte *dest, Common::SeekableReadStream &src, uint32 width, uint32 height, uint32 pitch);
+/** Decompress a DXT1 image into RGBA pixels.
+ *
+ *  @param dest The RGBA destination image.
+ *  @param src The compressed blocks.
+ *  @param srcSize The size of the compressed data in bytes.
+ *  @param width The width of the image in pixels.
+ *  @param height The height of the image in pixels.
+ *  @param pitch The size of one destination image row in bytes.
+ */
+void decompressDXT1(byte *dest, const byte *src, size_t srcSize, uint32 width, uint32 height, uint32 pitch);
+/** Decompress a DXT3 image into RGBA pixels. @see decompressDXT1. */
+void decompressDXT3(byte *dest, const byte *src, size_t srcSize, uint32 width, uint32 height, uint32 pitch);
+/** Decompress a DXT5 image into RGBA pixels. @see decompressDXT1. */
+void decompressDXT5(byte *dest, const byte *src, size_t srcSize, uint32 width, uint32 height, uint32 pitch);
 
 } // End of namespace Graphics
 
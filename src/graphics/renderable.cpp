@@ -24,6 +24,8 @@
 
 #include "src/common/system.h"
 #include "src/common/error.h"
+#include "src/common/boundingbox.h"
+#include "src/common/aabbtree.h"
 
 #include "src/graphics/renderable.h"
 #include "src/graphics/types.h"
@@ -31,7 +33,9 @@
 
 namespace Graphics {
 
-Renderable::Renderable(RenderableType type) : _clickable(false), _distance(0.0f) {
+Renderable::Renderable(RenderableType type) : _clickable(false), _distance(0.0f),
+	_pickingID(Common::AABBTree::kInvalidID) {
+
 	switch (type) {
 		case kRenderableTypeVideo:
 			_queueExists  = kQueueVideo;
@@ -75,6 +79,13 @@ bool Renderable::operator<(const Queueable &q) const {
 void Renderable::advanceTime(float UNUSED(dt)) {
 }
 
+void Renderable::finishAdvanceTime() {
+}
+
+bool Renderable::isInFrustum(const Common::Frustum &UNUSED(frustum)) {
+	return true;
+}
+
 double Renderable::getDistance() const {
 	return _distance;
 }
@@ -114,12 +125,40 @@ void Renderable::show() {
 	sortQueue(_queueVisible);
 
 	unlockQueue(_queueVisible);
+
+	worldBoundChanged();
 }
 
 void Renderable::hide() {
+	// Remove from the picking tree first, so that a visible object is always still alive
+	if (_pickingID != Common::AABBTree::kInvalidID) {
+		GfxMan.removePickable(_pickingID);
+		_pickingID = Common::AABBTree::kInvalidID;
+	}
+
 	removeFromQueue(_queueVisible);
 }
 
+void Renderable::worldBoundChanged() {
+	if ((_queueVisible != kQueueVisibleWorldObject) || !isVisible())
+		return;
+
+	Common::BoundingBox bound;
+	if (!getWorldBound(bound)) {
+		if (_pickingID != Common::AABBTree::kInvalidID) {
+			GfxMan.removePickable(_pickingID);
+			_pickingID = Common::AABBTree::kInvalidID;
+		}
+
+		return;
+	}
+
+	if (_pickingID == Common::AABBTree::kInvalidID)
+		_pickingID = GfxMan.addPickable(*this, bound);
+	else
+		GfxMan.updatePickable(_pickingID, bound);
+}
+
 bool Renderable::isIn(float UNUSED(x), float UNUSED(y)) const {
 	return false;
 }
@@ -134,6 +173,10 @@ bool Renderable::isIn(float UNUSED(x1), float UNUSED(y1), float UNUSED(z1),
 	return false;
 }
 
+bool Renderable::getWorldBound(Common::BoundingBox &UNUSED(bound)) const {
+	return false;
+}
+
 void Renderable::lockFrame() {
 	GfxMan.lockFrame();
 }
@@ -30,6 +30,11 @@
 #include "src/graphics/types.h"
 #include "src/graphics/queueable.h"
 
+namespace Common {
+	class Frustum;
+	class BoundingBox;
+}
+
 namespace Graphics {
 
 /** An object that can be displayed by the graphics manager. */
@@ -43,8 +48,29 @@ public:
 	/** Calculate the object's distance. */
 	virtual void calculateDistance() = 0;
 
-	/** Advance time (used by renderables with animations). */
+	/** Advance time (used by renderables with animations).
+	 *
+	 *  This is called on worker threads, for several objects at the same
+	 *  time. It must not touch OpenGL, lock the frame, or modify anything
+	 *  the object shares with other objects. Changes like that have to wait
+	 *  for finishAdvanceTime().
+	 */
 	virtual void advanceTime(float dt);
+	/** Apply the results of the last advanceTime() call.
+	 *
+	 *  This is called on the rendering thread, for one object after the
+	 *  other, once advanceTime() has finished for all objects.
+	 */
+	virtual void finishAdvanceTime();
+
+	/** Check the object against the view frustum, before rendering it.
+	 *
+	 *  Returns false if the object is completely outside the frustum and
+	 *  doesn't need to be rendered at all this frame. An object may also
+	 *  remember the frustum to cull parts of itself in the following render()
+	 *  calls. By default, an object is always considered to be visible.
+	 */
+	virtual bool isInFrustum(const Common::Frustum &frustum);
 
 	/** Render the object. */
 	virtual void render(RenderPass pass) = 0;
@@ -77,6 +103,13 @@ public:
 	/** Does the line from x1.y1.z1 to x2.y2.z2 intersect with the object? */
 	virtual bool isIn(float x1, float y1, float z1, float x2, float y2, float z2) const;
 
+	/** Get the bounding box of the object in world coordinates.
+	 *
+	 *  This is used to quickly find the world objects a line might intersect
+	 *  with. An object that returns false here is never found by a line.
+	 */
+	virtual bool getWorldBound(Common::BoundingBox &bound) const;
+
 protected:
 	QueueType _queueExists;
 	QueueType _queueVisible;
@@ -88,8 +121,13 @@ protected:
 
 	double _distance; ///< The distance of the object from the viewer.
 
+	uint32 _pickingID; ///< The ID of the object in the GraphicsManager's picking tree.
+
 	void resort();
 
+	/** The object's world bounding box changed. */
+	void worldBoundChanged();
+
 	void lockFrame();
 	void unlockFrame();
 
@@ -86,12 +86,22 @@
 // BASIS, AND BROWN UNIVERSITY HAS NO OBLIGATION TO PROVIDE MAINTENANCE,
 // SUPPORT, UPDATES, ENHANCEMENTS, OR MODIFICATIONS.
 
+#include <cassert>
+
+#include <SDL_cpuinfo.h>
+
 #include "src/common/error.h"
 #include "src/common/singleton.h"
 #include "src/common/util.h"
 
 #include "src/graphics/yuv_to_rgb.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+	#define XOREOS_YUV_SSE2 1
+
+	#include <emmintrin.h>
+#endif
+
 DECLARE_SINGLETON(Graphics::YUVToRGBManager)
 
 namespace Graphics {
@@ -159,7 +169,8 @@ YUVToRGBLookup::YUVToRGBLookup(YUVToRGBManager::LuminanceScale scale) {
 }
 
 YUVToRGBManager::YUVToRGBManager() {
-	_lookup = 0;
+	_lookup[kScaleFull] = new YUVToRGBLookup(kScaleFull);
+	_lookup[kScaleITU ] = new YUVToRGBLookup(kScaleITU);
 
 	int16 *Cr_r_tab = &_colorTab[0 * 256];
 	int16 *Cr_g_tab = &_colorTab[1 * 256];
@@ -178,21 +189,145 @@ YUVToRGBManager::YUVToRGBManager() {
 		Cb_g_tab[i] = (int16) (-(0.114 / 0.331) * CB);
 		Cb_b_tab[i] = (int16) ( (0.587 / 0.331) * CB) + 2 * 768 + 256;
 	}
+
+#ifdef XOREOS_YUV_SSE2
+	_sse2 = SDL_HasSSE2();
+#else
+	_sse2 = false;
+#endif
 }
 
 YUVToRGBManager::~YUVToRGBManager() {
-	delete _lookup;
+	delete _lookup[kScaleFull];
+	delete _lookup[kScaleITU];
+}
+
+const YUVToRGBLookup *YUVToRGBManager::getLookup(LuminanceScale scale) const {
+	assert((scale == kScaleFull) || (scale == kScaleITU));
+
+	return _lookup[scale];
+}
+
+#ifdef XOREOS_YUV_SSE2
+
+/** Apply the sign of the original value (all bits set for negative, clear for positive). */
+static inline __m128i applySignSSE2(__m128i x, __m128i sign) {
+	return _mm_sub_epi16(_mm_xor_si128(x, sign), sign);
+}
+
+/** Calculate the chroma offsets for 8 pairs of chroma values.
+ *
+ *  These are exactly the values in the color tables, without the table
+ *  offsets: the products are done with the absolute chroma values in
+ *  fixed point, which truncates towards 0 like the float to int16 casts.
+ */
+static inline void chromaSSE2(const byte *uSrc, const byte *vSrc, __m128i &r, __m128i &g, __m128i &b) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+
+	const __m128i cr = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) vSrc), zero), bias);
+	const __m128i cb = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) uSrc), zero), bias);
+
+	const __m128i crSign = _mm_srai_epi16(cr, 15);
+	const __m128i cbSign = _mm_srai_epi16(cb, 15);
+
+	const __m128i crAbs = applySignSSE2(cr, crSign);
+	const __m128i cbAbs = applySignSSE2(cb, cbSign);
+
+	// 0.419 / 0.299, 0.299 / 0.419, 0.114 / 0.331 and 0.587 / 0.331 in 1.16 and 0.16 fixed point
+	const __m128i crR = _mm_mulhi_epu16(_mm_slli_epi16(crAbs, 1), _mm_set1_epi16((int16) 45876));
+	const __m128i crG = _mm_mulhi_epu16(crAbs                   , _mm_set1_epi16((int16) 46735));
+	const __m128i cbG = _mm_mulhi_epu16(cbAbs                   , _mm_set1_epi16((int16) 22562));
+	const __m128i cbB = _mm_mulhi_epu16(_mm_slli_epi16(cbAbs, 1), _mm_set1_epi16((int16) 58109));
+
+	r = applySignSSE2(crR, crSign);
+	b = applySignSSE2(cbB, cbSign);
+	g = _mm_sub_epi16(_mm_sub_epi16(zero, applySignSSE2(crG, crSign)), applySignSSE2(cbG, cbSign));
 }
 
-const YUVToRGBLookup *YUVToRGBManager::getLookup(LuminanceScale scale) {
-	if (_lookup && _lookup->getScale() == scale)
-		return _lookup;
+/** Scale 16 color values to [0, 255], exactly like the lookup tables do. */
+static inline __m128i scaleSSE2(bool itu, __m128i lo, __m128i hi) {
+	if (itu) {
+		// (clamp(x, 16, 235) - 16) * 255 / 219, with 255 / 219 in 1.16 fixed point
+		const __m128i min   = _mm_set1_epi16(16);
+		const __m128i max   = _mm_set1_epi16(235);
+		const __m128i scale = _mm_set1_epi16((int16) 38155);
 
-	delete _lookup;
-	_lookup = new YUVToRGBLookup(scale);
-	return _lookup;
+		lo = _mm_sub_epi16(_mm_min_epi16(_mm_max_epi16(lo, min), max), min);
+		hi = _mm_sub_epi16(_mm_min_epi16(_mm_max_epi16(hi, min), max), min);
+
+		lo = _mm_mulhi_epu16(_mm_slli_epi16(lo, 1), scale);
+		hi = _mm_mulhi_epu16(_mm_slli_epi16(hi, 1), scale);
+	}
+
+	// The saturation clamps the full scale to [0, 255]
+	return _mm_packus_epi16(lo, hi);
 }
 
+/** Convert 16 pixels of one row and write them as BGRA. */
+static inline void convertRowSSE2(bool itu, byte *dst, const byte *ySrc, const byte *aSrc,
+                                  __m128i rLo, __m128i rHi, __m128i gLo, __m128i gHi, __m128i bLo, __m128i bHi) {
+
+	const __m128i zero = _mm_setzero_si128();
+
+	const __m128i y   = _mm_loadu_si128((const __m128i *) ySrc);
+	const __m128i yLo = _mm_unpacklo_epi8(y, zero);
+	const __m128i yHi = _mm_unpackhi_epi8(y, zero);
+
+	const __m128i r = scaleSSE2(itu, _mm_add_epi16(yLo, rLo), _mm_add_epi16(yHi, rHi));
+	const __m128i g = scaleSSE2(itu, _mm_add_epi16(yLo, gLo), _mm_add_epi16(yHi, gHi));
+	const __m128i b = scaleSSE2(itu, _mm_add_epi16(yLo, bLo), _mm_add_epi16(yHi, bHi));
+
+	const __m128i a = aSrc ? _mm_loadu_si128((const __m128i *) aSrc) : _mm_set1_epi8((char) 0xFF);
+
+	const __m128i bgLo = _mm_unpacklo_epi8(b, g);
+	const __m128i bgHi = _mm_unpackhi_epi8(b, g);
+	const __m128i raLo = _mm_unpacklo_epi8(r, a);
+	const __m128i raHi = _mm_unpackhi_epi8(r, a);
+
+	_mm_storeu_si128((__m128i *) (dst +  0), _mm_unpacklo_epi16(bgLo, raLo));
+	_mm_storeu_si128((__m128i *) (dst + 16), _mm_unpackhi_epi16(bgLo, raLo));
+	_mm_storeu_si128((__m128i *) (dst + 32), _mm_unpacklo_epi16(bgHi, raHi));
+	_mm_storeu_si128((__m128i *) (dst + 48), _mm_unpackhi_epi16(bgHi, raHi));
+}
+
+/** Convert two rows of a YUV420 image, 16 pixels at a time, with SSE2.
+ *
+ *  @param  itu       Are the luminance values in the ITU-R BT.601 range?
+ *  @param  dstTop    The destination for the pixels of the top source row.
+ *  @param  dstBottom The destination for the pixels of the bottom source row.
+ *  @param  yTop      The top row of the y component.
+ *  @param  yBottom   The bottom row of the y component.
+ *  @param  aTop      The top row of the a component, or 0 for opaque pixels.
+ *  @param  aBottom   The bottom row of the a component, or 0 for opaque pixels.
+ *  @param  uSrc      The row of the u component.
+ *  @param  vSrc      The row of the v component.
+ *  @param  count     The number of chroma values to convert. Must be divisible by 8.
+ */
+static void convert420RowsSSE2(bool itu, byte *dstTop, byte *dstBottom,
+                               const byte *yTop, const byte *yBottom, const byte *aTop, const byte *aBottom,
+                               const byte *uSrc, const byte *vSrc, int count) {
+
+	for (int i = 0; i < count; i += 8) {
+		__m128i r, g, b;
+		chromaSSE2(uSrc + i, vSrc + i, r, g, b);
+
+		// Each chroma value applies to two neighbouring pixels
+		const __m128i rLo = _mm_unpacklo_epi16(r, r), rHi = _mm_unpackhi_epi16(r, r);
+		const __m128i gLo = _mm_unpacklo_epi16(g, g), gHi = _mm_unpackhi_epi16(g, g);
+		const __m128i bLo = _mm_unpacklo_epi16(b, b), bHi = _mm_unpackhi_epi16(b, b);
+
+		const int offset = i * 2;
+
+		convertRowSSE2(itu, dstTop    + offset * 4, yTop    + offset, aTop    ? aTop    + offset : 0,
+		               rLo, rHi, gLo, gHi, bLo, bHi);
+		convertRowSSE2(itu, dstBottom + offset * 4, yBottom + offset, aBottom ? aBottom + offset : 0,
+		               rLo, rHi, gLo, gHi, bLo, bHi);
+	}
+}
+
+#endif // XOREOS_YUV_SSE2
+
 #define PUT_PIXEL(s, a, d) \
 	L = &rgbToPix[(s)]; \
 	*((d)) = L[cb_b]; \
@@ -210,7 +345,25 @@ void YUVToRGBManager::convert420(LuminanceScale scale, byte *dst, int dstPitch,
 	dst += dstPitch * (yHeight - 2);
 
 	for (int h = 0; h < halfHeight; h++) {
-		for (int w = 0; w < halfWidth; w++) {
+		int w = 0;
+
+#ifdef XOREOS_YUV_SSE2
+		if (_sse2) {
+			w = halfWidth & ~7;
+
+			convert420RowsSSE2(scale == kScaleITU, dst + dstPitch, dst,
+			                   ySrc, ySrc + yPitch, aSrc, aSrc + yPitch, uSrc, vSrc, w);
+
+			ySrc += w * 2;
+			aSrc += w * 2;
+			uSrc += w;
+			vSrc += w;
+			dst  += w * 8;
+		}
+#endif
+
+		// Convert the remaining pixels one chroma value at a time
+		for (; w < halfWidth; w++) {
 			const byte *L;
 
 			int16 cr_r  = _colorTab[*vSrc + 0 * 256];
@@ -249,7 +402,24 @@ void YUVToRGBManager::convert420(LuminanceScale scale, byte *dst, int dstPitch,
 	dst += dstPitch * (yHeight - 2);
 
 	for (int h = 0; h < halfHeight; h++) {
-		for (int w = 0; w < halfWidth; w++) {
+		int w = 0;
+
+#ifdef XOREOS_YUV_SSE2
+		if (_sse2) {
+			w = halfWidth & ~7;
+
+			convert420RowsSSE2(scale == kScaleITU, dst + dstPitch, dst,
+			                   ySrc, ySrc + yPitch, 0, 0, uSrc, vSrc, w);
+
+			ySrc += w * 2;
+			uSrc += w;
+			vSrc += w;
+			dst  += w * 8;
+		}
+#endif
+
+		// Convert the remaining pixels one chroma value at a time
+		for (; w < halfWidth; w++) {
 			const byte *L;
 
 			int16 cr_r  = _colorTab[*vSrc + 0 * 256];
@@ -78,10 +78,14 @@ private:
 	YUVToRGBManager();
 	~YUVToRGBManager();
 
-	const YUVToRGBLookup *getLookup(LuminanceScale scale);
+	const YUVToRGBLookup *getLookup(LuminanceScale scale) const;
 
-	YUVToRGBLookup *_lookup;
+	/** The lookup tables for both luminance scales, so that several threads can convert at once. */
+	YUVToRGBLookup *_lookup[2];
 	int16 _colorTab[4 * 256]; // 2048 bytes
+
+	/** Can we convert 16 pixels at once with SSE2? */
+	bool _sse2;
 };
 
 } // End of namespace Graphics
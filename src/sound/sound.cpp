@@ -25,6 +25,8 @@
 #include <cassert>
 #include <cstring>
 
+#include <boost/bind.hpp>
+
 #include "src/sound/sound.h"
 #include "src/sound/audiostream.h"
 #include "src/sound/decoders/asf.h"
@@ -37,9 +39,15 @@
 #include "src/common/strutil.h"
 #include "src/common/error.h"
 #include "src/common/configman.h"
+#include "src/common/threadpool.h"
 
 #include "src/events/events.h"
 
+// The loopback device is an OpenAL Soft extension
+#ifndef MACOSX
+	#include <AL/alext.h>
+#endif
+
 DECLARE_SINGLETON(Sound::SoundManager)
 
 /** Control how many buffers per sound OpenAL will create.
@@ -55,9 +63,23 @@ static const size_t kOpenALBufferCount = 5;
  */
 static const size_t kOpenALBufferSize = 32768;
 
+/** Number of unused decode buffers kept around for later channels. */
+static const size_t kDecodeBufferPoolSize = 64;
+
+/** Sampling rate the loopback device mixes at. */
+static const int kLoopbackRate = 44100;
+/** Maximum number of sample frames the loopback device renders in one go. */
+static const size_t kLoopbackFrames = 4096;
+
+#ifdef ALC_SOFT_loopback
+static LPALCRENDERSAMPLESSOFT alcRenderSamples = 0;
+#endif
+
 namespace Sound {
 
-SoundManager::SoundManager() : _ready(false), _hasSound(false), _hasMultiChannel(false), _format51(0) {
+SoundManager::SoundManager() : _ready(false), _hasSound(false), _hasMultiChannel(false), _format51(0),
+	_dev(0), _ctx(0), _loopback(false), _loopbackTime(0), _decodePool(0), _decodeDone(_decodeMutex),
+	_buffersDecoded(0), _underruns(0) {
 }
 
 void SoundManager::init() {
@@ -69,6 +91,7 @@ void SoundManager::init() {
 
 	_curID = 1;
 
+	_dev = 0;
 	_ctx = 0;
 
 	_hasSound = false;
@@ -76,14 +99,11 @@ void SoundManager::init() {
 	_hasMultiChannel = false;
 	_format51        = 0;
 
-	try {
-		_dev = alcOpenDevice(0);
-		if (!_dev)
-			throw Common::Exception("Could not open OpenAL device");
+	_buffersDecoded = 0;
+	_underruns      = 0;
 
-		_ctx = alcCreateContext(_dev, 0);
-		if (!_ctx)
-			throw Common::Exception("Could not create OpenAL context: 0x%X", (uint) alGetError());
+	try {
+		openDevice();
 
 		alcMakeContextCurrent(_ctx);
 
@@ -94,12 +114,23 @@ void SoundManager::init() {
 		_hasMultiChannel = alIsExtensionPresent("AL_EXT_MCFORMATS") != 0;
 		_format51        = alGetEnumValue("AL_FORMAT_51CHN16");
 
+		try {
+			_decodePool = new Common::ThreadPool;
+		} catch (Common::Exception &e) {
+			e.add("Failed to create the sound decoding threads. Decoding on the sound thread");
+
+			Common::printException(e, "WARNING: ");
+		}
+
 		if (!createThread())
 			throw Common::Exception("Failed to create sound thread: %s", SDL_GetError());
 
 		_hasSound = true;
 
 	} catch (Common::Exception &e) {
+		delete _decodePool;
+		_decodePool = 0;
+
 		e.add("Failed to initialize OpenAL. Disabling sound output!");
 
 		Common::printException(e, "WARNING: ");
@@ -125,9 +156,23 @@ void SoundManager::deinit() {
 	if (!destroyThread())
 		warning("SoundManager::deinit(): Sound thread had to be killed");
 
+	// Let the running decode jobs finish before we free their channels
+	if (_decodePool)
+		_decodePool->wait();
+
 	for (size_t i = 0; i < kChannelCount; i++)
 		freeChannel(i);
 
+	delete _decodePool;
+	_decodePool = 0;
+
+	for (std::vector<byte *>::iterator b = _freeDecodeBuffers.begin(); b != _freeDecodeBuffers.end(); ++b)
+		delete[] *b;
+	_freeDecodeBuffers.clear();
+
+	if (_hasSound && _loopback)
+		status("Sound loopback: %u buffers decoded ahead, %u underruns", _buffersDecoded, _underruns);
+
 	if (_hasSound) {
 		alcMakeContextCurrent(0);
 		alcDestroyContext(_ctx);
@@ -141,6 +186,87 @@ bool SoundManager::ready() const {
 	return _ready;
 }
 
+void SoundManager::openDevice() {
+	_loopback = ConfigMan.getBool("soundloopback", false);
+
+	if (!_loopback) {
+		_dev = alcOpenDevice(0);
+		if (!_dev)
+			throw Common::Exception("Could not open OpenAL device");
+
+		_ctx = alcCreateContext(_dev, 0);
+		if (!_ctx)
+			throw Common::Exception("Could not create OpenAL context: 0x%X", (uint) alGetError());
+
+		return;
+	}
+
+#ifdef ALC_SOFT_loopback
+	if (!alcIsExtensionPresent(0, "ALC_SOFT_loopback"))
+		throw Common::Exception("OpenAL loopback devices are not supported");
+
+	LPALCLOOPBACKOPENDEVICESOFT alcLoopbackOpenDevice =
+		(LPALCLOOPBACKOPENDEVICESOFT) alcGetProcAddress(0, "alcLoopbackOpenDeviceSOFT");
+	alcRenderSamples = (LPALCRENDERSAMPLESSOFT) alcGetProcAddress(0, "alcRenderSamplesSOFT");
+
+	if (!alcLoopbackOpenDevice || !alcRenderSamples)
+		throw Common::Exception("OpenAL loopback devices are not supported");
+
+	_dev = alcLoopbackOpenDevice(0);
+	if (!_dev)
+		throw Common::Exception("Could not open OpenAL loopback device");
+
+	// A loopback device gets its output format from the context attributes
+	const ALCint attributes[] = {
+		ALC_FORMAT_CHANNELS_SOFT, ALC_STEREO_SOFT,
+		ALC_FORMAT_TYPE_SOFT    , ALC_SHORT_SOFT,
+		ALC_FREQUENCY           , kLoopbackRate,
+		0
+	};
+
+	_ctx = alcCreateContext(_dev, attributes);
+	if (!_ctx)
+		throw Common::Exception("Could not create OpenAL loopback context: 0x%X", (uint) alGetError());
+
+	_loopbackTime = EventMan.getTimestamp();
+
+	status("Mixing sound into an OpenAL loopback device. There will be no audible output");
+#else
+	throw Common::Exception("OpenAL loopback devices are not supported");
+#endif
+}
+
+void SoundManager::renderLoopback() {
+#ifdef ALC_SOFT_loopback
+	const uint32 now = EventMan.getTimestamp();
+
+	size_t frames = ((uint64) (now - _loopbackTime) * kLoopbackRate) / 1000;
+	_loopbackTime = now;
+
+	_loopbackBuffer.resize(kLoopbackFrames * 2);
+
+	// Mix everything that would have been played since the last time, discarding the output
+	while (frames > 0) {
+		const size_t count = MIN(frames, kLoopbackFrames);
+
+		alcRenderSamples(_dev, &_loopbackBuffer[0], (ALCsizei) count);
+		frames -= count;
+	}
+#endif
+}
+
+uint32 SoundManager::getBuffersDecoded() const {
+	Common::StackLock lock(_decodeMutex);
+
+	return _buffersDecoded;
+}
+
+uint32 SoundManager::getUnderruns() const {
+	Common::StackLock lock(_decodeMutex);
+
+	return _underruns;
+}
+
 void SoundManager::triggerUpdate() {
 	checkReady();
 
@@ -169,7 +295,7 @@ bool SoundManager::isPlaying(const ChannelHandle &handle) {
 	return isPlaying(handle.channel);
 }
 
-bool SoundManager::isPlaying(size_t channel) const {
+bool SoundManager::isPlaying(size_t channel) {
 	if ((channel >= kChannelCount) || !_channels[channel])
 		return false;
 
@@ -184,7 +310,7 @@ bool SoundManager::isPlaying(size_t channel) const {
 	alGetSourcei(_channels[channel]->source, AL_SOURCE_STATE, &val);
 
 	if (val != AL_PLAYING) {
-		if (!_channels[channel]->stream || _channels[channel]->stream->endOfStream()) {
+		if (!_channels[channel]->stream || isDrained(*_channels[channel])) {
 			ALint buffersQueued, buffersProcessed;
 			alGetSourcei(_channels[channel]->source, AL_BUFFERS_QUEUED,    &buffersQueued);
 			alGetSourcei(_channels[channel]->source, AL_BUFFERS_PROCESSED, &buffersProcessed);
@@ -196,6 +322,20 @@ bool SoundManager::isPlaying(size_t channel) const {
 		if (_channels[channel]->state != AL_PLAYING)
 			return true;
 
+		if (val == AL_STOPPED) {
+			// The source played everything queued before new data arrived
+
+			ALint buffersQueued;
+			alGetSourcei(_channels[channel]->source, AL_BUFFERS_QUEUED, &buffersQueued);
+
+			// Wait for the decoders to catch up
+			if (buffersQueued == 0)
+				return true;
+
+			Common::StackLock lock(_decodeMutex);
+			_underruns++;
+		}
+
 		alSourcePlay(_channels[channel]->source);
 	}
 
@@ -303,6 +443,13 @@ ChannelHandle SoundManager::playAudioStream(AudioStream *audStream, SoundType ty
 	channel.type            = type;
 	channel.typeIt          = _types[channel.type].list.end();
 	channel.gain            = 1.0f;
+	channel.format          = 0;
+	channel.rate            = 0;
+	channel.decodedStart    = 0;
+	channel.decodedCount    = 0;
+	channel.decoding        = false;
+	channel.decodeEnd       = false;
+	channel.freed           = false;
 
 	try {
 
@@ -312,6 +459,13 @@ ChannelHandle SoundManager::playAudioStream(AudioStream *audStream, SoundType ty
 		ALenum error = AL_NO_ERROR;
 
 		if (_hasSound) {
+			channel.format = getFormat(channel.stream->getChannels());
+			channel.rate   = channel.stream->getRate();
+
+			// Nothing to decode if OpenAL can't play it anyway
+			if (channel.format == 0)
+				channel.decodeEnd = true;
+
 			// Create the source
 			alGenSources(1, &channel.source);
 			if ((error = alGetError()) != AL_NO_ERROR)
@@ -325,7 +479,7 @@ ChannelHandle SoundManager::playAudioStream(AudioStream *audStream, SoundType ty
 				if ((error = alGetError()) != AL_NO_ERROR)
 					throw Common::Exception("OpenAL error while generating buffers: %X", error);
 
-				if (fillBuffer(buffer, channel.stream)) {
+				if (fillBuffer(buffer, channel)) {
 					// If we could fill the buffer with data, queue it
 
 					alSourceQueueBuffers(channel.source, 1, &buffer);
@@ -507,54 +661,57 @@ void SoundManager::setTypeGain(SoundType type, float gain) {
 	}
 }
 
-bool SoundManager::fillBuffer(ALuint alBuffer, AudioStream *stream) const {
-	if (!stream)
-		throw Common::Exception("No stream");
-
-	if (!_hasSound)
-		return true;
-
-	if (stream->endOfData())
-		return false;
-
-	ALenum format;
-
-	const int channelCount = stream->getChannels();
+ALenum SoundManager::getFormat(int channelCount) const {
 	if        (channelCount == 1) {
-		format = AL_FORMAT_MONO16;
+		return AL_FORMAT_MONO16;
 	} else if (channelCount == 2) {
-		format = AL_FORMAT_STEREO16;
+		return AL_FORMAT_STEREO16;
 	} else if (channelCount == 6) {
 		if (!_hasMultiChannel) {
-			warning("SoundManager::fillBuffer(): TODO: !_hasMultiChannel");
-			return false;
+			warning("SoundManager::getFormat(): TODO: !_hasMultiChannel");
+			return 0;
 		}
 
-		format = _format51;
+		return _format51;
+	}
+
+	warning("SoundManager::getFormat(): Unsupported channel count %d", channelCount);
+	return 0;
+}
+
+bool SoundManager::fillBuffer(ALuint alBuffer, Channel &channel) {
+	if (!channel.stream)
+		throw Common::Exception("No stream");
 
-	} else {
-		warning("SoundManager::fillBuffer(): Unsupported channel count %d", channelCount);
+	if ((channel.format == 0) || channel.stream->endOfData())
 		return false;
-	}
 
 	// Read in the required amount of samples
-	size_t numSamples = kOpenALBufferSize / 2;
+	DecodedBuffer decoded;
+
+	decoded.data = getDecodeBuffer();
 
-	byte *buffer = new byte[kOpenALBufferSize];
-	memset(buffer, 0, kOpenALBufferSize);
+	const size_t numSamples =
+		channel.stream->readBuffer(reinterpret_cast<int16 *>(decoded.data), kOpenALBufferSize / 2);
 
-	numSamples = stream->readBuffer(reinterpret_cast<int16 *>(buffer), numSamples);
 	if (numSamples == AudioStream::kSizeInvalid) {
-		delete[] buffer;
+		releaseDecodeBuffer(decoded.data);
 
 		warning("Failed reading from stream while filling buffer");
 		return false;
 	}
 
-	const ALsizei bufferSize = (ALsizei) (numSamples * 2);
-	alBufferData(alBuffer, format, buffer, bufferSize, stream->getRate());
+	decoded.size = numSamples * 2;
 
-	delete[] buffer;
+	const bool filled = fillBuffer(alBuffer, channel, decoded);
+
+	releaseDecodeBuffer(decoded.data);
+
+	return filled;
+}
+
+bool SoundManager::fillBuffer(ALuint alBuffer, const Channel &channel, const DecodedBuffer &decoded) {
+	alBufferData(alBuffer, channel.format, decoded.data, (ALsizei) decoded.size, channel.rate);
 
 	ALenum error = alGetError();
 	if (error != AL_NO_ERROR) {
@@ -573,7 +730,8 @@ void SoundManager::bufferData(size_t channel) {
 }
 
 void SoundManager::bufferData(Channel &channel) {
-	if (!channel.stream || channel.stream->endOfData())
+	// The stream itself belongs to the decoder pool now, we only look at the decoded buffers
+	if (!channel.stream)
 		return;
 
 	if (!_hasSound)
@@ -592,16 +750,150 @@ void SoundManager::bufferData(Channel &channel) {
 		channel.freeBuffers.push_back(alBuffer);
 	}
 
-	// Buffer as long as we still have data and free buffers
+	// Buffer as long as we still have decoded data and free buffers
 	std::list<ALuint>::iterator buffer = channel.freeBuffers.begin();
 	while (buffer != channel.freeBuffers.end()) {
-		if (!fillBuffer(*buffer, channel.stream))
+		DecodedBuffer decoded;
+
+		{
+			Common::StackLock lock(_decodeMutex);
+
+			if (channel.decodedCount == 0)
+				break;
+
+			decoded = channel.decoded[channel.decodedStart];
+
+			channel.decodedStart = (channel.decodedStart + 1) % kDecodeAheadCount;
+			channel.decodedCount--;
+		}
+
+		const bool filled = fillBuffer(*buffer, channel, decoded);
+
+		releaseDecodeBuffer(decoded.data);
+
+		if (!filled)
 			break;
 
 		alSourceQueueBuffers(channel.source, 1, &*buffer);
 
 		buffer = channel.freeBuffers.erase(buffer);
 	}
+
+	// Refill the ring we just took from
+	scheduleDecode(channel);
+}
+
+void SoundManager::scheduleDecode(Channel &channel) {
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		if (channel.decoding || channel.decodeEnd || (channel.decodedCount >= kDecodeAheadCount))
+			return;
+
+		channel.decoding = true;
+	}
+
+	if (_decodePool)
+		_decodePool->addJob(boost::bind(&SoundManager::decodeChannel, this, &channel));
+	else
+		decodeChannel(&channel);
+}
+
+void SoundManager::decodeChannel(Channel *channel) {
+	bool decoded = false, failed = false;
+
+	while (true) {
+		{
+			Common::StackLock lock(_decodeMutex);
+
+			if (channel->freed || (channel->decodedCount >= kDecodeAheadCount))
+				break;
+		}
+
+		if (channel->stream->endOfData())
+			break;
+
+		byte *data = getDecodeBuffer();
+
+		const size_t numSamples =
+			channel->stream->readBuffer(reinterpret_cast<int16 *>(data), kOpenALBufferSize / 2);
+
+		if ((numSamples == AudioStream::kSizeInvalid) || (numSamples == 0)) {
+			releaseDecodeBuffer(data);
+
+			if (numSamples == AudioStream::kSizeInvalid) {
+				warning("Failed reading from stream while decoding ahead");
+				failed = true;
+			}
+
+			break;
+		}
+
+		Common::StackLock lock(_decodeMutex);
+
+		DecodedBuffer &slot = channel->decoded[(channel->decodedStart + channel->decodedCount) % kDecodeAheadCount];
+
+		slot.data = data;
+		slot.size = numSamples * 2;
+
+		channel->decodedCount++;
+		_buffersDecoded++;
+
+		decoded = true;
+	}
+
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		if (!channel->freed && (failed || channel->stream->endOfStream()))
+			channel->decodeEnd = true;
+
+		channel->decoding = false;
+
+		// Someone might be waiting to free this channel
+		if (channel->freed) {
+			_decodeDone.broadcast();
+			return;
+		}
+	}
+
+	// Let the sound thread hand the new data to OpenAL right away
+	if (decoded)
+		_needUpdate.signal();
+}
+
+bool SoundManager::isDrained(Channel &channel) {
+	Common::StackLock lock(_decodeMutex);
+
+	return channel.decodeEnd && (channel.decodedCount == 0);
+}
+
+byte *SoundManager::getDecodeBuffer() {
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		if (!_freeDecodeBuffers.empty()) {
+			byte *buffer = _freeDecodeBuffers.back();
+			_freeDecodeBuffers.pop_back();
+
+			return buffer;
+		}
+	}
+
+	return new byte[kOpenALBufferSize];
+}
+
+void SoundManager::releaseDecodeBuffer(byte *buffer) {
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		if (_freeDecodeBuffers.size() < kDecodeBufferPoolSize) {
+			_freeDecodeBuffers.push_back(buffer);
+			return;
+		}
+	}
+
+	delete[] buffer;
 }
 
 void SoundManager::checkReady() {
@@ -616,14 +908,12 @@ void SoundManager::update() {
 		if (!_channels[i])
 			continue;
 
-		// Free the channel if it is no longer playing
-		if (!isPlaying(i)) {
-			freeChannel(i);
-			continue;
-		}
-
 		// Try to buffer some more data
 		bufferData(i);
+
+		// Free the channel if it is no longer playing
+		if (!isPlaying(i))
+			freeChannel(i);
 	}
 }
 
@@ -688,10 +978,6 @@ void SoundManager::freeChannel(size_t channel) {
 		// Nothing to do
 		return;
 
-	// Discard the stream, if requested
-	if (c->disposeAfterUse)
-		delete c->stream;
-
 	if (_hasSound) {
 		// Delete the channel's OpenAL source
 		if (c->source)
@@ -706,13 +992,39 @@ void SoundManager::freeChannel(size_t channel) {
 	if (c->typeIt != _types[c->type].list.end())
 		_types[c->type].list.erase(c->typeIt);
 
-	// And finally delete the channel itself
-	delete c;
 	_channels[channel] = 0;
+
+	{
+		Common::StackLock lock(_decodeMutex);
+
+		/* Stop a running decode job and wait for it. The stream might not
+		 * be ours, and its owner may delete it as soon as we return. */
+		c->freed = true;
+		while (c->decoding)
+			_decodeDone.wait();
+	}
+
+	destroyChannel(c);
+}
+
+void SoundManager::destroyChannel(Channel *channel) {
+	// Discard the stream, if requested
+	if (channel->disposeAfterUse)
+		delete channel->stream;
+
+	// Give the decoded buffers nobody will play back to the pool
+	for (size_t i = 0; i < channel->decodedCount; i++)
+		releaseDecodeBuffer(channel->decoded[(channel->decodedStart + i) % kDecodeAheadCount].data);
+
+	// And finally delete the channel itself
+	delete channel;
 }
 
 void SoundManager::threadMethod() {
 	while (!_killThread) {
+		if (_loopback)
+			renderLoopback();
+
 		update();
 		_needUpdate.wait(100);
 	}
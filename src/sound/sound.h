@@ -36,6 +36,7 @@
 #endif
 
 #include <list>
+#include <vector>
 
 #include "src/common/types.h"
 #include "src/common/singleton.h"
@@ -46,6 +47,7 @@
 
 namespace Common {
 	class SeekableReadStream;
+	class ThreadPool;
 }
 
 namespace Sound {
@@ -153,12 +155,29 @@ public:
 	/** Set the gain/volume of all channels of a specific type. */
 	void setTypeGain(SoundType type, float gain);
 
+
+	// Statistics
+
+	/** Return the number of buffers decoded ahead since the sound subsystem was initialized. */
+	uint32 getBuffersDecoded() const;
+	/** Return the number of times a playing channel ran out of queued data. */
+	uint32 getUnderruns() const;
+
 private:
 	static const size_t kChannelCount = 65535; ///< Maximal number of channels.
 
+	/** Number of buffers each channel may decode ahead of the OpenAL queue. */
+	static const size_t kDecodeAheadCount = 4;
+
 	struct Channel;
 	typedef std::list<Channel *> TypeList;
 
+	/** A buffer of decoded sound data, waiting to be handed to OpenAL. */
+	struct DecodedBuffer {
+		byte  *data; ///< The decoded samples, taken from the buffer pool.
+		size_t size; ///< The number of valid bytes in data.
+	};
+
 	/** A sound type. */
 	struct Type {
 		float    gain; ///< The sound type's current gain.
@@ -183,6 +202,23 @@ private:
 		TypeList::iterator typeIt; ///< Iterator into the type list.
 
 		float gain; ///< The channel's gain.
+
+		ALenum  format; ///< The OpenAL format of the stream's samples, or 0 if unsupported.
+		ALsizei rate;   ///< The sampling rate of the stream.
+
+		/** Ring of buffers decoded ahead by the decoder pool.
+		 *
+		 *  The ring, and the flags following it, are guarded by the
+		 *  SoundManager's _decodeMutex. While a decode job is running,
+		 *  only that job may read from the channel's stream.
+		 */
+		DecodedBuffer decoded[kDecodeAheadCount];
+		size_t decodedStart; ///< Index of the oldest decoded buffer in the ring.
+		size_t decodedCount; ///< Number of decoded buffers in the ring.
+
+		bool decoding;  ///< Is a decode job currently running for this channel?
+		bool decodeEnd; ///< Has the stream been decoded completely?
+		bool freed;     ///< Has the channel been freed? Tells a running decode job to stop.
 	};
 
 	bool _ready; ///< Was the sound subsystem successfully initialized?
@@ -205,6 +241,24 @@ private:
 	ALCdevice *_dev;
 	ALCcontext *_ctx;
 
+	/** Are we mixing into a loopback device instead of a real output? */
+	bool _loopback;
+	uint32 _loopbackTime; ///< Timestamp up to which the loopback device has rendered.
+	std::vector<int16> _loopbackBuffer; ///< Scratch memory for the loopback device's output.
+
+	/** The worker threads decoding the channels' streams ahead. */
+	Common::ThreadPool *_decodePool;
+
+	/** Guards the decode rings of all channels, the buffer pool and the statistics. */
+	mutable Common::Mutex _decodeMutex;
+	/** Signals that a decode job for a freed channel has stopped. */
+	Common::Condition _decodeDone;
+
+	std::vector<byte *> _freeDecodeBuffers; ///< Pool of unused decode buffers.
+
+	uint32 _buffersDecoded; ///< Number of buffers decoded ahead so far.
+	uint32 _underruns;      ///< Number of times a playing channel ran dry.
+
 	/** Check that the SoundManager was properly initialized. */
 	void checkReady();
 
@@ -219,8 +273,28 @@ private:
 	/** Buffer more sound from the channel to the OpenAL buffers. */
 	void bufferData(size_t channel);
 
+	/** Queue a decode job for the channel, if its ring has room and none is running. */
+	void scheduleDecode(Channel &channel);
+	/** Decode the channel's stream until its ring is full. Run by the decoder pool. */
+	void decodeChannel(Channel *channel);
+	/** Has the channel's stream been completely decoded and handed to OpenAL? */
+	bool isDrained(Channel &channel);
+
+	/** Take a decode buffer out of the pool, allocating a new one if necessary. */
+	byte *getDecodeBuffer();
+	/** Give a decode buffer back to the pool. */
+	void releaseDecodeBuffer(byte *buffer);
+
+	/** Delete the channel's stream, its decoded buffers and the channel itself. */
+	void destroyChannel(Channel *channel);
+
+	/** Open the default OpenAL device, or a loopback device if requested, and create a context. */
+	void openDevice();
+	/** Let the loopback device mix the sound that would have been played by now. */
+	void renderLoopback();
+
 	/** Is that channel currently playing a sound? */
-	bool isPlaying(size_t channel) const;
+	bool isPlaying(size_t channel);
 
 	/** Pause/Unpause a channel. */
 	void pauseChannel(Channel *channel, bool pause);
@@ -237,8 +311,13 @@ private:
 
 	static AudioStream *makeAudioStream(Common::SeekableReadStream *stream);
 
-	/** Fill the buffer with data from the audio stream. */
-	bool fillBuffer(ALuint alBuffer, AudioStream *stream) const;
+	/** Return the OpenAL format for this many interleaved channels, or 0 if unsupported. */
+	ALenum getFormat(int channelCount) const;
+
+	/** Fill the buffer with data decoded directly from the channel's audio stream. */
+	bool fillBuffer(ALuint alBuffer, Channel &channel);
+	/** Upload decoded data into an OpenAL buffer. */
+	bool fillBuffer(ALuint alBuffer, const Channel &channel, const DecodedBuffer &decoded);
 };
 
 } // End of namespace Sound
@@ -24,7 +24,6 @@
 
 #include "src/common/error.h"
 #include "src/common/util.h"
-#include "src/common/ustring.h"
 #include "src/common/readstream.h"
 
 #include "src/video/decoder.h"
@@ -44,7 +43,7 @@ namespace Video {
 
 namespace Aurora {
 
-VideoPlayer::VideoPlayer(const Common::UString &video) : _video(0) {
+VideoPlayer::VideoPlayer(const Common::UString &video) : _name(video), _video(0) {
 	load(video);
 }
 
@@ -113,6 +112,17 @@ void VideoPlayer::play() {
 	_video->abort();
 }
 
+void VideoPlayer::benchmark() {
+	const uint32 start = EventMan.getTimestamp();
+
+	const uint32 frames = _video->decodeAll();
+
+	const uint32 time = EventMan.getTimestamp() - start;
+
+	status("Decoded %u frames of \"%s\" in %ums (%.2f fps)", frames, _name.c_str(), time,
+	       (time > 0) ? ((frames * 1000.0) / time) : 0.0);
+}
+
 } // End of namespace Aurora
 
 } // End of namespace Video
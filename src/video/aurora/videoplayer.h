@@ -25,9 +25,7 @@
 #ifndef VIDEO_AURORA_VIDEOPLAYER_H
 #define VIDEO_AURORA_VIDEOPLAYER_H
 
-namespace Common {
-	class UString;
-}
+#include "src/common/ustring.h"
 
 namespace Video {
 
@@ -43,7 +41,12 @@ public:
 
 	void play();
 
+	/** Decode the whole video as fast as possible, without showing it, and report the speed. */
+	void benchmark();
+
 private:
+	Common::UString _name;
+
 	VideoDecoder *_video;
 
 	void load(const Common::UString &name);
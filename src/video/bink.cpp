@@ -29,14 +29,18 @@
 #include <cmath>
 #include <cstring>
 
+#include <boost/bind.hpp>
+
 #include "src/common/util.h"
 #include "src/common/error.h"
 #include "src/common/maths.h"
 #include "src/common/readstream.h"
+#include "src/common/memreadstream.h"
 #include "src/common/bitstream.h"
 #include "src/common/huffman.h"
 #include "src/common/rdft.h"
 #include "src/common/dct.h"
+#include "src/common/threadpool.h"
 
 #include "src/graphics/util.h"
 #include "src/graphics/yuv_to_rgb.h"
@@ -63,6 +67,54 @@ static const uint16 kAudioFlagStereo = 0x2000;
 // Number of bits used to store first DC value in bundle
 static const uint32 kDCStartBits = 11;
 
+// Ways the 32-bit value in front of a BIKi plane might encode the plane's end
+static const uint8 kPlaneEndAfterValue = 1 << 0; // Size in bytes, counted after the value
+static const uint8 kPlaneEndFromValue  = 1 << 1; // Size in bytes, counted from the value
+static const uint8 kPlaneEndFromStart  = 1 << 2; // Offset in bytes from the start of the packet
+
+static const uint8 kPlaneEndAll = kPlaneEndAfterValue | kPlaneEndFromValue | kPlaneEndFromStart;
+
+/** Return the ways to interpret a plane's end value that fit where the plane actually ended. */
+static uint8 getPlaneEndModes(size_t valuePos, uint32 value, size_t end) {
+	const size_t size = ((size_t) value) * 8;
+
+	uint8 modes = 0;
+
+	if ((valuePos + 32 + size) == end)
+		modes |= kPlaneEndAfterValue;
+	if ((valuePos + size) == end)
+		modes |= kPlaneEndFromValue;
+	if (size == end)
+		modes |= kPlaneEndFromStart;
+
+	return modes;
+}
+
+/** Guess where a plane ends, using the first of these ways to interpret its end value.
+ *
+ *  Returns the way used, or 0 if there's none to use yet.
+ */
+static uint8 guessPlaneEnd(uint8 modes, size_t valuePos, uint32 value, size_t &end) {
+	// As long as all are possible, we haven't seen a single plane yet
+	if ((modes == 0) || (modes == kPlaneEndAll))
+		return 0;
+
+	const size_t size = ((size_t) value) * 8;
+
+	if (modes & kPlaneEndAfterValue) {
+		end = valuePos + 32 + size;
+		return kPlaneEndAfterValue;
+	}
+
+	if (modes & kPlaneEndFromValue) {
+		end = valuePos + size;
+		return kPlaneEndFromValue;
+	}
+
+	end = size;
+	return kPlaneEndFromStart;
+}
+
 namespace Video {
 
 Bink::VideoFrame::VideoFrame() : bits(0) {
@@ -73,6 +125,23 @@ Bink::VideoFrame::~VideoFrame() {
 }
 
 
+Bink::PlaneRun::PlaneRun(const byte *d, size_t s, size_t st, PlaneState &planeState) :
+	data(d), size(s), start(st), end(st), planeCount(0), planesDone(0),
+	state(&planeState), failed(false) {
+
+}
+
+void Bink::PlaneRun::addPlane(int planeIdx, bool value) {
+	assert(planeCount < 4);
+
+	planes  [planeCount] = planeIdx;
+	hasValue[planeCount] = value;
+	planeEnds[planeCount] = start;
+
+	planeCount++;
+}
+
+
 Bink::AudioTrack::AudioTrack() : bits(0), bands(0), rdft(0), dct(0) {
 }
 
@@ -87,30 +156,37 @@ Bink::AudioTrack::~AudioTrack() {
 
 
 Bink::Bink(Common::SeekableReadStream *bink) : _bink(bink), _disableAudio(false),
-	_curFrame(0), _audioTrack(0) {
+	_curFrame(0), _audioTrack(0), _planePool(0),
+	_alphaEndModes(kPlaneEndAll), _lumaEndModes(kPlaneEndAll) {
 
 	assert(_bink);
 
 	for (int i = 0; i < 16; i++)
 		_huffman[i] = 0;
 
-	for (int i = 0; i < kSourceMAX; i++) {
-		_bundles[i].countLength = 0;
+	for (int s = 0; s < kPlaneJobMAX; s++) {
+		PlaneState &state = _planeStates[s];
 
-		_bundles[i].huffman.index = 0;
-		for (int j = 0; j < 16; j++)
-			_bundles[i].huffman.symbols[j] = j;
+		for (int i = 0; i < kSourceMAX; i++) {
+			state.bundles[i].countLength = 0;
 
-		_bundles[i].data     = 0;
-		_bundles[i].dataEnd  = 0;
-		_bundles[i].curDec   = 0;
-		_bundles[i].curPtr   = 0;
-	}
+			state.bundles[i].huffman.index = 0;
+			for (int j = 0; j < 16; j++)
+				state.bundles[i].huffman.symbols[j] = j;
 
-	for (int i = 0; i < 16; i++) {
-		_colHighHuffman[i].index = 0;
-		for (int j = 0; j < 16; j++)
-			_colHighHuffman[i].symbols[j] = j;
+			state.bundles[i].data     = 0;
+			state.bundles[i].dataEnd  = 0;
+			state.bundles[i].curDec   = 0;
+			state.bundles[i].curPtr   = 0;
+		}
+
+		for (int i = 0; i < 16; i++) {
+			state.colHighHuffman[i].index = 0;
+			for (int j = 0; j < 16; j++)
+				state.colHighHuffman[i].symbols[j] = j;
+		}
+
+		state.colLastVal = 0;
 	}
 
 	for (int i = 0; i < 4; i++) {
@@ -141,6 +217,9 @@ void Bink::clear() {
 		_oldPlanes[i] = 0;
 	}
 
+	delete _planePool;
+	_planePool = 0;
+
 	deinitBundles();
 
 	for (int i = 0; i < 16; i++) {
@@ -179,11 +258,25 @@ void Bink::processData() {
 	if (getTimeToNextFrame() > 0)
 		return;
 
-	if (_curFrame >= _frames.size()) {
+	uint32 time;
+	if (!decodeNextFrame(*_surface, time)) {
 		finish();
 		return;
 	}
 
+	_needCopy = true;
+}
+
+bool Bink::canDecodeAhead() const {
+	return true;
+}
+
+bool Bink::decodeNextFrame(Graphics::Surface &surface, uint32 &time) {
+	if (_curFrame >= _frames.size())
+		return false;
+
+	time = ((uint64) (_curFrame * 1000 * ((uint64) _fpsDen))) / _fpsNum;
+
 	VideoFrame &frame = _frames[_curFrame];
 
 	_bink->seek(frame.offset);
@@ -211,7 +304,7 @@ void Bink::processData() {
 				audio.sampleCount = _bink->readUint32LE() / (2 * audio.channels);
 
 				audio.bits =
-					new Common::BitStream32LELSB(new Common::SeekableSubReadStream(_bink,
+					new Common::BitReader32LELSB(new Common::SeekableSubReadStream(_bink,
 					    audioPacketStart + 4, audioPacketEnd), true);
 
 				audioPacket(audio);
@@ -226,21 +319,19 @@ void Bink::processData() {
 		}
 	}
 
-	size_t videoPacketStart = _bink->pos();
-	size_t videoPacketEnd   = _bink->pos() + frameSize;
+	Common::MemoryReadStream *videoPacketData = _bink->readStream(frameSize);
 
-	frame.bits =
-		new Common::BitStream32LELSB(new Common::SeekableSubReadStream(_bink,
-		    videoPacketStart, videoPacketEnd), true);
-
-	videoPacket(frame);
+	try {
+		videoPacket(videoPacketData->getData(), videoPacketData->size(), surface);
+	} catch (...) {
+		delete videoPacketData;
+		throw;
+	}
 
-	delete frame.bits;
-	frame.bits = 0;
-
-	_needCopy = true;
+	delete videoPacketData;
 
 	_curFrame++;
+	return true;
 }
 
 void Bink::audioPacket(AudioTrack &audio) {
@@ -266,41 +357,202 @@ void Bink::audioPacket(AudioTrack &audio) {
 	}
 }
 
-void Bink::videoPacket(VideoFrame &video) {
-	assert(video.bits);
+void Bink::videoPacket(const byte *data, size_t size, Graphics::Surface &surface) {
+	assert(_curPlanes[0] && _curPlanes[1] && _curPlanes[2] && _curPlanes[3]);
 
-	if (_hasAlpha) {
-		if (_id == kBIKiID)
-			video.bits->skip(32);
+	if (!decodePlanesConcurrently(data, size)) {
+		// Decode all the planes one after the other
+
+		PlaneRun run(data, size, 0, _planeStates[kPlaneJobColor]);
 
-		decodePlane(video, 3, false);
+		if (_hasAlpha)
+			run.addPlane(3, _id == kBIKiID);
+
+		for (int i = 0; i < 3; i++)
+			run.addPlane(((i == 0) || !_swapPlanes) ? i : (i ^ 3), (i == 0) && (_id == kBIKiID));
+
+		decodePlanes(run);
+		checkPlaneEnds(run);
 	}
 
-	if (_id == kBIKiID)
-		video.bits->skip(32);
+	// Convert the YUVA data we have to BGRA, spread over several threads if we can
+	if (Common::ThreadPool::getCPUCount() > 1) {
+		if (!_planePool)
+			_planePool = new Common::ThreadPool;
 
-	for (int i = 0; i < 3; i++) {
-		int planeIdx = ((i == 0) || !_swapPlanes) ? i : (i ^ 3);
+		// The converter isn't created thread-safely, so make sure it exists before the jobs run
+		Graphics::YUVToRGBManager::instance();
 
-		decodePlane(video, planeIdx, i != 0);
+		// Each job converts an even number of rows, since two rows share their chroma values
+		const uint32 jobCount  = 2 * _planePool->getThreadCount();
+		const uint32 chunkSize = (((_height + jobCount - 1) / jobCount) + 1) & ~1;
 
-		if (video.bits->pos() >= video.bits->size())
-			break;
-	}
+		for (uint32 row = 0; row < _height; row += chunkSize)
+			_planePool->addJob(boost::bind(&Bink::convertRows, this, &surface, row, MIN(chunkSize, _height - row)));
 
-	// Convert the YUVA data we have to BGRA
-	assert(_surface && _curPlanes[0] && _curPlanes[1] && _curPlanes[2] && _curPlanes[3]);
-	YUVToRGBMan.convert420(Graphics::YUVToRGBManager::kScaleITU,
-			_surface->getData(), _surface->getWidth() * 4,
-			_curPlanes[0], _curPlanes[1], _curPlanes[2], _curPlanes[3],
-			_width, _height, _width, _width >> 1);
+		_planePool->wait();
+
+	} else
+		convertRows(&surface, 0, _height);
 
 	// And swap the planes with the reference planes
 	for (int i = 0; i < 4; i++)
 		SWAP(_curPlanes[i], _oldPlanes[i]);
 }
 
-void Bink::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
+bool Bink::decodePlanesConcurrently(const byte *data, size_t size) {
+	// Only BIKi videos mark where their planes end
+	if ((_id != kBIKiID) || (Common::ThreadPool::getCPUCount() <= 1))
+		return false;
+
+	const size_t sizeBits = (size & ~((size_t) 3)) * 8;
+	if (sizeBits < 32)
+		return false;
+
+	// Find the start of the luma plane
+	uint8  alphaMode = 0;
+	size_t lumaStart = 0;
+	if (_hasAlpha) {
+		alphaMode = guessPlaneEnd(_alphaEndModes, 0, READ_LE_UINT32(data), lumaStart);
+		if ((alphaMode == 0) || (lumaStart & 0x1F) || ((lumaStart + 32) >= sizeBits))
+			return false;
+	}
+
+	// Find the start of the chroma planes
+	size_t chromaStart = 0;
+	uint8  lumaMode    = guessPlaneEnd(_lumaEndModes, lumaStart,
+	                                   READ_LE_UINT32(data + (lumaStart >> 3)), chromaStart);
+	if ((chromaStart & 0x1F) || (chromaStart <= lumaStart) || (chromaStart >= sizeBits))
+		lumaMode = 0;
+
+	// Nothing to do at the same time
+	if ((alphaMode == 0) && (lumaMode == 0))
+		return false;
+
+	PlaneRun *runs[kPlaneJobMAX] = { 0, 0, 0 };
+
+	if (alphaMode != 0) {
+		runs[kPlaneJobAlpha] = new PlaneRun(data, size, 0, _planeStates[kPlaneJobAlpha]);
+		runs[kPlaneJobAlpha]->addPlane(3, true);
+	}
+
+	runs[kPlaneJobColor] = new PlaneRun(data, size, lumaStart, _planeStates[kPlaneJobColor]);
+	runs[kPlaneJobColor]->addPlane(0, true);
+
+	if (lumaMode != 0) {
+		runs[kPlaneJobChroma] = new PlaneRun(data, size, chromaStart, _planeStates[kPlaneJobChroma]);
+
+		runs[kPlaneJobChroma]->addPlane(_swapPlanes ? 2 : 1, false);
+		runs[kPlaneJobChroma]->addPlane(_swapPlanes ? 1 : 2, false);
+	} else {
+		runs[kPlaneJobColor]->addPlane(_swapPlanes ? 2 : 1, false);
+		runs[kPlaneJobColor]->addPlane(_swapPlanes ? 1 : 2, false);
+	}
+
+	if (!_planePool)
+		_planePool = new Common::ThreadPool;
+
+	for (int i = 0; i < kPlaneJobMAX; i++) {
+		if (!runs[i] || (i == kPlaneJobColor))
+			continue;
+
+		if (!_planeStates[i].bundles[0].data)
+			initBundles(_planeStates[i]);
+
+		_planePool->addJob(boost::bind(&Bink::decodePlanesJob, this, runs[i]));
+	}
+
+	decodePlanesJob(runs[kPlaneJobColor]);
+
+	_planePool->wait();
+
+	// Check that the planes ended where we guessed they would
+
+	bool success = true;
+	for (int i = 0; i < kPlaneJobMAX; i++)
+		if (runs[i] && runs[i]->failed)
+			success = false;
+
+	if (runs[kPlaneJobAlpha] && (runs[kPlaneJobAlpha]->end != lumaStart)) {
+		_alphaEndModes &= ~alphaMode;
+		success = false;
+	}
+
+	if (runs[kPlaneJobChroma] && (runs[kPlaneJobColor]->end != chromaStart)) {
+		_lumaEndModes &= ~lumaMode;
+		success = false;
+	}
+
+	for (int i = 0; i < kPlaneJobMAX; i++)
+		delete runs[i];
+
+	/* If we guessed wrong, the caller decodes the planes again, one after the other.
+	 * Every block of a plane is written anew, so the wrong data doesn't linger. */
+	return success;
+}
+
+void Bink::decodePlanes(PlaneRun &run) {
+	const size_t startByte = run.start >> 3;
+
+	VideoFrame video;
+	video.bits = new Common::BitReader32LELSB(run.data + startByte, run.size - startByte);
+
+	for (int i = 0; i < run.planeCount; i++) {
+		if (run.hasValue[i])
+			video.bits->skip(32);
+
+		const int planeIdx = run.planes[i];
+
+		decodePlane(video, *run.state, planeIdx, (planeIdx == 1) || (planeIdx == 2));
+
+		run.planeEnds[i] = run.start + video.bits->pos();
+		run.planesDone   = i + 1;
+
+		// The color planes stop once the packet is used up
+		if ((planeIdx != 3) && (video.bits->pos() >= video.bits->size()))
+			break;
+	}
+
+	run.end = run.start + video.bits->pos();
+}
+
+void Bink::decodePlanesJob(PlaneRun *run) {
+	try {
+		decodePlanes(*run);
+	} catch (...) {
+		run->failed = true;
+	}
+}
+
+void Bink::checkPlaneEnds(const PlaneRun &run) {
+	for (int i = 0; i < run.planesDone; i++) {
+		if (!run.hasValue[i])
+			continue;
+
+		const size_t valuePos = (i == 0) ? run.start : run.planeEnds[i - 1];
+		const uint8  modes    = getPlaneEndModes(valuePos, READ_LE_UINT32(run.data + (valuePos >> 3)), run.planeEnds[i]);
+
+		if (run.planes[i] == 3)
+			_alphaEndModes &= modes;
+		else
+			_lumaEndModes  &= modes;
+	}
+}
+
+void Bink::convertRows(Graphics::Surface *surface, uint32 row, uint32 count) {
+	// The image is stored upside down in the surface
+	const int pitch = surface->getWidth() * 4;
+
+	YUVToRGBMan.convert420(Graphics::YUVToRGBManager::kScaleITU,
+			surface->getData() + pitch * (_height - row - count), pitch,
+			_curPlanes[0] +  row       *  _width,
+			_curPlanes[1] + (row >> 1) * (_width >> 1),
+			_curPlanes[2] + (row >> 1) * (_width >> 1),
+			_curPlanes[3] +  row       *  _width,
+			_width, count, _width, _width >> 1);
+}
+
+void Bink::decodePlane(VideoFrame &video, PlaneState &state, int planeIdx, bool isChroma) {
 
 	uint32 blockWidth  = isChroma ? ((_width  + 15) >> 4) : ((_width  + 7) >> 3);
 	uint32 blockHeight = isChroma ? ((_height + 15) >> 4) : ((_height + 7) >> 3);
@@ -310,6 +562,7 @@ void Bink::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
 	DecodeContext ctx;
 
 	ctx.video     = &video;
+	ctx.state     = &state;
 	ctx.planeIdx  = planeIdx;
 	ctx.destStart = _curPlanes[planeIdx];
 	ctx.destEnd   = _curPlanes[planeIdx] + width * height;
@@ -327,27 +580,27 @@ void Bink::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
 	}
 
 	for (int i = 0; i < kSourceMAX; i++) {
-		_bundles[i].countLength = _bundles[i].countLengths[isChroma ? 1 : 0];
+		state.bundles[i].countLength = state.bundles[i].countLengths[isChroma ? 1 : 0];
 
-		readBundle(video, (Source) i);
+		readBundle(video, state, (Source) i);
 	}
 
 	for (ctx.blockY = 0; ctx.blockY < blockHeight; ctx.blockY++) {
-		readBlockTypes  (video, _bundles[kSourceBlockTypes]);
-		readBlockTypes  (video, _bundles[kSourceSubBlockTypes]);
-		readColors      (video, _bundles[kSourceColors]);
-		readPatterns    (video, _bundles[kSourcePattern]);
-		readMotionValues(video, _bundles[kSourceXOff]);
-		readMotionValues(video, _bundles[kSourceYOff]);
-		readDCS         (video, _bundles[kSourceIntraDC], kDCStartBits, false);
-		readDCS         (video, _bundles[kSourceInterDC], kDCStartBits, true);
-		readRuns        (video, _bundles[kSourceRun]);
+		readBlockTypes  (video, state.bundles[kSourceBlockTypes]);
+		readBlockTypes  (video, state.bundles[kSourceSubBlockTypes]);
+		readColors      (video, state);
+		readPatterns    (video, state.bundles[kSourcePattern]);
+		readMotionValues(video, state.bundles[kSourceXOff]);
+		readMotionValues(video, state.bundles[kSourceYOff]);
+		readDCS         (video, state.bundles[kSourceIntraDC], kDCStartBits, false);
+		readDCS         (video, state.bundles[kSourceInterDC], kDCStartBits, true);
+		readRuns        (video, state.bundles[kSourceRun]);
 
 		ctx.dest = ctx.destStart + 8 * ctx.blockY * ctx.pitch;
 		ctx.prev = ctx.prevStart + 8 * ctx.blockY * ctx.pitch;
 
 		for (ctx.blockX = 0; ctx.blockX < blockWidth; ctx.blockX++, ctx.dest += 8, ctx.prev += 8) {
-			BlockType blockType = (BlockType) getBundleValue(kSourceBlockTypes);
+			BlockType blockType = (BlockType) getBundleValue(ctx, kSourceBlockTypes);
 
 			// 16x16 block type on odd line means part of the already decoded block, so skip it
 			if ((ctx.blockY & 1) && (blockType == kBlockScaled)) {
@@ -411,19 +664,19 @@ void Bink::decodePlane(VideoFrame &video, int planeIdx, bool isChroma) {
 
 }
 
-void Bink::readBundle(VideoFrame &video, Source source) {
+void Bink::readBundle(VideoFrame &video, PlaneState &state, Source source) {
 	if (source == kSourceColors) {
 		for (int i = 0; i < 16; i++)
-			readHuffman(video, _colHighHuffman[i]);
+			readHuffman(video, state.colHighHuffman[i]);
 
-		_colLastVal = 0;
+		state.colLastVal = 0;
 	}
 
 	if ((source != kSourceIntraDC) && (source != kSourceInterDC))
-		readHuffman(video, _bundles[source].huffman);
+		readHuffman(video, state.bundles[source].huffman);
 
-	_bundles[source].curDec = _bundles[source].data;
-	_bundles[source].curPtr = _bundles[source].data;
+	state.bundles[source].curDec = state.bundles[source].data;
+	state.bundles[source].curPtr = state.bundles[source].data;
 }
 
 void Bink::readHuffman(VideoFrame &video, Huffman &huffman) {
@@ -451,7 +704,8 @@ void Bink::readHuffman(VideoFrame &video, Huffman &huffman) {
 			hasSymbol[huffman.symbols[i]] = 1;
 		}
 
-		for (int i = 0; i < 16; i++)
+		// Broken data might select a symbol twice, so take care not to overrun
+		for (int i = 0; (i < 16) && (length < 15); i++)
 			if (hasSymbol[i] == 0)
 				huffman.symbols[++length] = i;
 
@@ -674,13 +928,20 @@ void Bink::initAudioTrack(AudioTrack &audio) {
 }
 
 void Bink::initBundles() {
+	// The states for decoding planes concurrently are only created when needed
+	initBundles(_planeStates[kPlaneJobColor]);
+}
+
+void Bink::initBundles(PlaneState &state) {
+	Bundle *bundles = state.bundles;
+
 	uint32 bw     = (_width  + 7) >> 3;
 	uint32 bh     = (_height + 7) >> 3;
 	uint32 blocks = bw * bh;
 
 	for (int i = 0; i < kSourceMAX; i++) {
-		_bundles[i].data    = new byte[blocks * 64];
-		_bundles[i].dataEnd = _bundles[i].data + blocks * 64;
+		bundles[i].data    = new byte[blocks * 64];
+		bundles[i].dataEnd = bundles[i].data + blocks * 64;
 	}
 
 	uint32 cbw[2] = { (_width + 7) >> 3, (_width  + 15) >> 4 };
@@ -690,22 +951,24 @@ void Bink::initBundles() {
 	for (int i = 0; i < 2; i++) {
 		int width = MAX<uint32>(cw[i], 8);
 
-		_bundles[kSourceBlockTypes   ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
-		_bundles[kSourceSubBlockTypes].countLengths[i] = Common::intLog2((width  >> 4)    + 511) + 1;
-		_bundles[kSourceColors       ].countLengths[i] = Common::intLog2((width  >> 3)*64 + 511) + 1;
-		_bundles[kSourceIntraDC      ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
-		_bundles[kSourceInterDC      ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
-		_bundles[kSourceXOff         ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
-		_bundles[kSourceYOff         ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
-		_bundles[kSourcePattern      ].countLengths[i] = Common::intLog2((cbw[i] << 3)    + 511) + 1;
-		_bundles[kSourceRun          ].countLengths[i] = Common::intLog2((width  >> 3)*48 + 511) + 1;
+		bundles[kSourceBlockTypes   ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
+		bundles[kSourceSubBlockTypes].countLengths[i] = Common::intLog2((width  >> 4)    + 511) + 1;
+		bundles[kSourceColors       ].countLengths[i] = Common::intLog2((width  >> 3)*64 + 511) + 1;
+		bundles[kSourceIntraDC      ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
+		bundles[kSourceInterDC      ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
+		bundles[kSourceXOff         ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
+		bundles[kSourceYOff         ].countLengths[i] = Common::intLog2((width  >> 3)    + 511) + 1;
+		bundles[kSourcePattern      ].countLengths[i] = Common::intLog2((cbw[i] << 3)    + 511) + 1;
+		bundles[kSourceRun          ].countLengths[i] = Common::intLog2((width  >> 3)*48 + 511) + 1;
 	}
 }
 
 void Bink::deinitBundles() {
-	for (int i = 0; i < kSourceMAX; i++) {
-		delete[] _bundles[i].data;
-		_bundles[i].data = 0;
+	for (int s = 0; s < kPlaneJobMAX; s++) {
+		for (int i = 0; i < kSourceMAX; i++) {
+			delete[] _planeStates[s].bundles[i].data;
+			_planeStates[s].bundles[i].data = 0;
+		}
 	}
 }
 
@@ -718,16 +981,18 @@ byte Bink::getHuffmanSymbol(VideoFrame &video, Huffman &huffman) {
 	return huffman.symbols[_huffman[huffman.index]->getSymbol(*video.bits)];
 }
 
-int32 Bink::getBundleValue(Source source) {
+int32 Bink::getBundleValue(DecodeContext &ctx, Source source) {
+	Bundle &bundle = ctx.state->bundles[source];
+
 	if ((source < kSourceXOff) || (source == kSourceRun))
-		return *_bundles[source].curPtr++;
+		return *bundle.curPtr++;
 
 	if ((source == kSourceXOff) || (source == kSourceYOff))
-		return (int8) *_bundles[source].curPtr++;
+		return (int8) *bundle.curPtr++;
 
-	int16 ret = *reinterpret_cast<int16 *>(_bundles[source].curPtr);
+	int16 ret = *reinterpret_cast<int16 *>(bundle.curPtr);
 
-	_bundles[source].curPtr += 2;
+	bundle.curPtr += 2;
 
 	return ret;
 }
@@ -764,7 +1029,7 @@ void Bink::blockScaledRun(DecodeContext &ctx) {
 
 	int i = 0;
 	do {
-		int run = getBundleValue(kSourceRun) + 1;
+		int run = getBundleValue(ctx, kSourceRun) + 1;
 
 		i += run;
 		if (i > 64)
@@ -772,7 +1037,7 @@ void Bink::blockScaledRun(DecodeContext &ctx) {
 
 		if (ctx.video->bits->getBit()) {
 
-			byte v = getBundleValue(kSourceColors);
+			byte v = getBundleValue(ctx, kSourceColors);
 			for (int j = 0; j < run; j++, scan++)
 				ctx.dest[ctx.coordScaledMap1[*scan]] =
 				ctx.dest[ctx.coordScaledMap2[*scan]] =
@@ -784,7 +1049,7 @@ void Bink::blockScaledRun(DecodeContext &ctx) {
 				ctx.dest[ctx.coordScaledMap1[*scan]] =
 				ctx.dest[ctx.coordScaledMap2[*scan]] =
 				ctx.dest[ctx.coordScaledMap3[*scan]] =
-				ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(kSourceColors);
+				ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(ctx, kSourceColors);
 
 	} while (i < 63);
 
@@ -792,14 +1057,14 @@ void Bink::blockScaledRun(DecodeContext &ctx) {
 		ctx.dest[ctx.coordScaledMap1[*scan]] =
 		ctx.dest[ctx.coordScaledMap2[*scan]] =
 		ctx.dest[ctx.coordScaledMap3[*scan]] =
-		ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(kSourceColors);
+		ctx.dest[ctx.coordScaledMap4[*scan]] = getBundleValue(ctx, kSourceColors);
 }
 
 void Bink::blockScaledIntra(DecodeContext &ctx) {
 	int16 block[64];
 	memset(block, 0, 64 * sizeof(int16));
 
-	block[0] = getBundleValue(kSourceIntraDC);
+	block[0] = getBundleValue(ctx, kSourceIntraDC);
 
 	readDCTCoeffs(*ctx.video, block, true);
 
@@ -817,7 +1082,7 @@ void Bink::blockScaledIntra(DecodeContext &ctx) {
 }
 
 void Bink::blockScaledFill(DecodeContext &ctx) {
-	byte v = getBundleValue(kSourceColors);
+	byte v = getBundleValue(ctx, kSourceColors);
 
 	byte *dest = ctx.dest;
 	for (int i = 0; i < 16; i++, dest += ctx.pitch)
@@ -828,12 +1093,12 @@ void Bink::blockScaledPattern(DecodeContext &ctx) {
 	byte col[2];
 
 	for (int i = 0; i < 2; i++)
-		col[i] = getBundleValue(kSourceColors);
+		col[i] = getBundleValue(ctx, kSourceColors);
 
 	byte *dest1 = ctx.dest;
 	byte *dest2 = ctx.dest + ctx.pitch;
 	for (int j = 0; j < 8; j++, dest1 += (ctx.pitch << 1) - 16, dest2 += (ctx.pitch << 1) - 16) {
-		byte v = getBundleValue(kSourcePattern);
+		byte v = getBundleValue(ctx, kSourcePattern);
 
 		for (int i = 0; i < 8; i++, dest1 += 2, dest2 += 2, v >>= 1)
 			dest1[0] = dest1[1] = dest2[0] = dest2[1] = col[v & 1];
@@ -846,17 +1111,17 @@ void Bink::blockScaledRaw(DecodeContext &ctx) {
 	byte *dest1 = ctx.dest;
 	byte *dest2 = ctx.dest + ctx.pitch;
 	for (int j = 0; j < 8; j++, dest1 += (ctx.pitch << 1) - 16, dest2 += (ctx.pitch << 1) - 16) {
-		memcpy(row, _bundles[kSourceColors].curPtr, 8);
+		memcpy(row, ctx.state->bundles[kSourceColors].curPtr, 8);
 
 		for (int i = 0; i < 8; i++, dest1 += 2, dest2 += 2)
 			dest1[0] = dest1[1] = dest2[0] = dest2[1] = row[i];
 
-		_bundles[kSourceColors].curPtr += 8;
+		ctx.state->bundles[kSourceColors].curPtr += 8;
 	}
 }
 
 void Bink::blockScaled(DecodeContext &ctx) {
-	BlockType blockType = (BlockType) getBundleValue(kSourceSubBlockTypes);
+	BlockType blockType = (BlockType) getBundleValue(ctx, kSourceSubBlockTypes);
 
 	switch (blockType) {
 		case kBlockRun:
@@ -889,8 +1154,8 @@ void Bink::blockScaled(DecodeContext &ctx) {
 }
 
 void Bink::blockMotion(DecodeContext &ctx) {
-	int8 xOff = getBundleValue(kSourceXOff);
-	int8 yOff = getBundleValue(kSourceYOff);
+	int8 xOff = getBundleValue(ctx, kSourceXOff);
+	int8 yOff = getBundleValue(ctx, kSourceYOff);
 
 	byte *dest = ctx.dest;
 	byte *prev = ctx.prev + yOff * ((int32) ctx.pitch) + xOff;
@@ -906,7 +1171,7 @@ void Bink::blockRun(DecodeContext &ctx) {
 
 	int i = 0;
 	do {
-		int run = getBundleValue(kSourceRun) + 1;
+		int run = getBundleValue(ctx, kSourceRun) + 1;
 
 		i += run;
 		if (i > 64)
@@ -914,18 +1179,18 @@ void Bink::blockRun(DecodeContext &ctx) {
 
 		if (ctx.video->bits->getBit()) {
 
-			byte v = getBundleValue(kSourceColors);
+			byte v = getBundleValue(ctx, kSourceColors);
 			for (int j = 0; j < run; j++)
 				ctx.dest[ctx.coordMap[*scan++]] = v;
 
 		} else
 			for (int j = 0; j < run; j++)
-				ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(kSourceColors);
+				ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(ctx, kSourceColors);
 
 	} while (i < 63);
 
 	if (i == 63)
-		ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(kSourceColors);
+		ctx.dest[ctx.coordMap[*scan++]] = getBundleValue(ctx, kSourceColors);
 }
 
 void Bink::blockResidue(DecodeContext &ctx) {
@@ -949,7 +1214,7 @@ void Bink::blockIntra(DecodeContext &ctx) {
 	int16 block[64];
 	memset(block, 0, 64 * sizeof(int16));
 
-	block[0] = getBundleValue(kSourceIntraDC);
+	block[0] = getBundleValue(ctx, kSourceIntraDC);
 
 	readDCTCoeffs(*ctx.video, block, true);
 
@@ -957,7 +1222,7 @@ void Bink::blockIntra(DecodeContext &ctx) {
 }
 
 void Bink::blockFill(DecodeContext &ctx) {
-	byte v = getBundleValue(kSourceColors);
+	byte v = getBundleValue(ctx, kSourceColors);
 
 	byte *dest = ctx.dest;
 	for (int i = 0; i < 8; i++, dest += ctx.pitch)
@@ -970,7 +1235,7 @@ void Bink::blockInter(DecodeContext &ctx) {
 	int16 block[64];
 	memset(block, 0, 64 * sizeof(int16));
 
-	block[0] = getBundleValue(kSourceInterDC);
+	block[0] = getBundleValue(ctx, kSourceInterDC);
 
 	readDCTCoeffs(*ctx.video, block, false);
 
@@ -981,11 +1246,11 @@ void Bink::blockPattern(DecodeContext &ctx) {
 	byte col[2];
 
 	for (int i = 0; i < 2; i++)
-		col[i] = getBundleValue(kSourceColors);
+		col[i] = getBundleValue(ctx, kSourceColors);
 
 	byte *dest = ctx.dest;
 	for (int i = 0; i < 8; i++, dest += ctx.pitch - 8) {
-		byte v = getBundleValue(kSourcePattern);
+		byte v = getBundleValue(ctx, kSourcePattern);
 
 		for (int j = 0; j < 8; j++, v >>= 1)
 			*dest++ = col[v & 1];
@@ -994,11 +1259,11 @@ void Bink::blockPattern(DecodeContext &ctx) {
 
 void Bink::blockRaw(DecodeContext &ctx) {
 	byte *dest = ctx.dest;
-	byte *data = _bundles[kSourceColors].curPtr;
+	byte *data = ctx.state->bundles[kSourceColors].curPtr;
 	for (int i = 0; i < 8; i++, dest += ctx.pitch, data += 8)
 		memcpy(dest, data, 8);
 
-	_bundles[kSourceColors].curPtr += 64;
+	ctx.state->bundles[kSourceColors].curPtr += 64;
 }
 
 void Bink::readRuns(VideoFrame &video, Bundle &bundle) {
@@ -1086,6 +1351,8 @@ void Bink::readBlockTypes(VideoFrame &video, Bundle &bundle) {
 			*bundle.curDec++ = v;
 		} else {
 			int run = rleLens[v - 12];
+			if ((decEnd - bundle.curDec) < run)
+				throw Common::Exception("Block type run went out of bounds");
 
 			memset(bundle.curDec, last, run);
 
@@ -1113,7 +1380,9 @@ void Bink::readPatterns(VideoFrame &video, Bundle &bundle) {
 }
 
 
-void Bink::readColors(VideoFrame &video, Bundle &bundle) {
+void Bink::readColors(VideoFrame &video, PlaneState &state) {
+	Bundle &bundle = state.bundles[kSourceColors];
+
 	uint32 n = readBundleCount(video, bundle);
 	if (n == 0)
 		return;
@@ -1123,11 +1392,11 @@ void Bink::readColors(VideoFrame &video, Bundle &bundle) {
 		throw Common::Exception("Too many color values");
 
 	if (video.bits->getBit()) {
-		_colLastVal = getHuffmanSymbol(video, _colHighHuffman[_colLastVal]);
+		state.colLastVal = getHuffmanSymbol(video, state.colHighHuffman[state.colLastVal]);
 
 		byte v;
 		v = getHuffmanSymbol(video, bundle.huffman);
-		v = (_colLastVal << 4) | v;
+		v = (state.colLastVal << 4) | v;
 
 		if (_id != kBIKiID) {
 			int sign = ((int8) v) >> 7;
@@ -1142,11 +1411,11 @@ void Bink::readColors(VideoFrame &video, Bundle &bundle) {
 	}
 
 	while (bundle.curDec < decEnd) {
-		_colLastVal = getHuffmanSymbol(video, _colHighHuffman[_colLastVal]);
+		state.colLastVal = getHuffmanSymbol(video, state.colHighHuffman[state.colLastVal]);
 
 		byte v;
 		v = getHuffmanSymbol(video, bundle.huffman);
-		v = (_colLastVal << 4) | v;
+		v = (state.colLastVal << 4) | v;
 
 		if (_id != kBIKiID) {
 			int sign = ((int8) v) >> 7;
@@ -31,13 +31,14 @@
 #include <vector>
 
 #include "src/common/types.h"
+#include "src/common/bitstream.h"
 
 #include "src/video/decoder.h"
 
 namespace Common {
 	class SeekableReadStream;
-	class BitStream;
 	class Huffman;
+	class ThreadPool;
 
 	class RDFT;
 	class DCT;
@@ -57,6 +58,9 @@ protected:
 	void startVideo();
 	void processData();
 
+	bool canDecodeAhead() const;
+	bool decodeNextFrame(Graphics::Surface &surface, uint32 &time);
+
 private:
 	static const int kAudioChannelsMax  = 2;
 	static const int kAudioBlockSizeMax = (kAudioChannelsMax << 11);
@@ -110,6 +114,57 @@ private:
 		byte *curPtr; ///< Pointer to the data that wasn't yet read.
 	};
 
+	/** The state of decoding a plane, kept from one row of blocks to the next. */
+	struct PlaneState {
+		Bundle bundles[kSourceMAX]; ///< Bundles for decoding all data types.
+
+		/** Huffman codebooks to use for decoding high nibbles in color data types. */
+		Huffman colHighHuffman[16];
+		/** Value of the last decoded high nibble in color data types. */
+		int colLastVal;
+	};
+
+	/** The parts of a video packet that can be decoded independently.
+	 *
+	 *  In BIKi videos, the alpha plane and the luma plane are each preceded
+	 *  by a 32-bit value that marks where the plane ends. We learn how to
+	 *  interpret those values from the packets we decode in one go. Once we
+	 *  know, we decode the alpha plane, the luma plane and the two chroma
+	 *  planes at the same time, and check that the guess was right.
+	 */
+	enum PlaneJob {
+		kPlaneJobColor  = 0, ///< The luma plane, or all planes when decoding in one go.
+		kPlaneJobAlpha     , ///< The alpha plane.
+		kPlaneJobChroma    , ///< The two chroma planes.
+
+		kPlaneJobMAX
+	};
+
+	/** A run of planes to be decoded one after the other, starting somewhere in a video packet. */
+	struct PlaneRun {
+		const byte *data; ///< The video packet.
+		size_t size;      ///< The size of the video packet in bytes.
+
+		size_t start; ///< Offset of the run within the packet, in bits.
+		size_t end;   ///< Offset of where the run ended, in bits.
+
+		int  planes[4];   ///< The indices of the planes to decode.
+		bool hasValue[4]; ///< Is this plane preceded by a 32-bit end value?
+		int  planeCount;  ///< The number of planes to decode.
+		int  planesDone;  ///< The number of planes actually decoded.
+
+		size_t planeEnds[4]; ///< Offsets of where each plane ended, in bits.
+
+		PlaneState *state; ///< The decoding state to use.
+
+		bool failed; ///< Did decoding the planes fail?
+
+		PlaneRun(const byte *d, size_t s, size_t st, PlaneState &planeState);
+
+		/** Add a plane to the end of the run. */
+		void addPlane(int planeIdx, bool value);
+	};
+
 	enum AudioCodec {
 		kAudioCodecDCT,
 		kAudioCodecRDFT
@@ -129,7 +184,7 @@ private:
 
 		uint32 sampleCount;
 
-		Common::BitStream *bits;
+		Common::BitReader32LELSB *bits;
 
 		bool first;
 
@@ -162,7 +217,7 @@ private:
 		uint32 offset;
 		uint32 size;
 
-		Common::BitStream *bits;
+		Common::BitReader32LELSB *bits;
 
 		VideoFrame();
 		~VideoFrame();
@@ -171,6 +226,7 @@ private:
 	/** A decoder state. */
 	struct DecodeContext {
 		VideoFrame *video;
+		PlaneState *state;
 
 		uint32 planeIdx;
 
@@ -218,12 +274,14 @@ private:
 
 	Common::Huffman *_huffman[16]; ///< The 16 Huffman codebooks used in Bink decoding.
 
-	Bundle _bundles[kSourceMAX]; ///< Bundles for decoding all data types.
+	/** The plane decoding states, one for each part we might decode concurrently. */
+	PlaneState _planeStates[kPlaneJobMAX];
+
+	/** The worker threads decoding planes and converting them to BGRA. */
+	Common::ThreadPool *_planePool;
 
-	/** Huffman codebooks to use for decoding high nibbles in color data types. */
-	Huffman _colHighHuffman[16];
-	/** Value of the last decoded high nibble in color data types. */
-	int _colLastVal;
+	uint8 _alphaEndModes; ///< The ways to interpret the alpha plane's end value that fit the data.
+	uint8 _lumaEndModes;  ///< The ways to interpret the luma plane's end value that fit the data.
 
 	byte *_curPlanes[4]; ///< The 4 color planes, YUVA, current frame.
 	byte *_oldPlanes[4]; ///< The 4 color planes, YUVA, last frame.
@@ -234,6 +292,8 @@ private:
 
 	/** Initialize the bundles. */
 	void initBundles();
+	/** Initialize the bundles of this plane decoding state. */
+	void initBundles(PlaneState &state);
 	/** Deinitialize the bundles. */
 	void deinitBundles();
 
@@ -243,13 +303,25 @@ private:
 	/** Decode an audio packet. */
 	void audioPacket(AudioTrack &audio);
 	/** Decode a video packet. */
-	void videoPacket(VideoFrame &video);
+	void videoPacket(const byte *data, size_t size, Graphics::Surface &surface);
+
+	/** Decode the planes of a video packet concurrently, if we can. */
+	bool decodePlanesConcurrently(const byte *data, size_t size);
+	/** Decode a run of planes. */
+	void decodePlanes(PlaneRun &run);
+	/** Decode a run of planes, remembering any failure instead of throwing. */
+	void decodePlanesJob(PlaneRun *run);
+	/** Remove the ways to interpret the planes' end values that don't fit this decoded packet. */
+	void checkPlaneEnds(const PlaneRun &run);
 
 	/** Decode a plane. */
-	void decodePlane(VideoFrame &video, int planeIdx, bool isChroma);
+	void decodePlane(VideoFrame &video, PlaneState &state, int planeIdx, bool isChroma);
+
+	/** Convert these rows of the decoded planes to BGRA. */
+	void convertRows(Graphics::Surface *surface, uint32 row, uint32 count);
 
 	/** Read/Initialize a bundle for decoding a plane. */
-	void readBundle(VideoFrame &video, Source source);
+	void readBundle(VideoFrame &video, PlaneState &state, Source source);
 
 	/** Read the symbols for a Huffman code. */
 	void readHuffman(VideoFrame &video, Huffman &huffman);
@@ -260,7 +332,7 @@ private:
 	byte getHuffmanSymbol(VideoFrame &video, Huffman &huffman);
 
 	/** Get a direct value out of a bundle. */
-	int32 getBundleValue(Source source);
+	int32 getBundleValue(DecodeContext &ctx, Source source);
 	/** Read a count value out of a bundle. */
 	uint32 readBundleCount(VideoFrame &video, Bundle &bundle);
 
@@ -287,7 +359,7 @@ private:
 	void readMotionValues(VideoFrame &video, Bundle &bundle);
 	void readBlockTypes  (VideoFrame &video, Bundle &bundle);
 	void readPatterns    (VideoFrame &video, Bundle &bundle);
-	void readColors      (VideoFrame &video, Bundle &bundle);
+	void readColors      (VideoFrame &video, PlaneState &state);
 	void readDCS         (VideoFrame &video, Bundle &bundle, int startBits, bool hasSign);
 	void readDCTCoeffs   (VideoFrame &video, int16 *block, bool isIntra);
 	void readResidue     (VideoFrame &video, int16 *block, int masksCount);
@@ -26,11 +26,11 @@
 #define VIDEO_CODECS_XMVWMV2_H
 
 #include "src/common/types.h"
+#include "src/common/bitstream.h"
 
 #include "src/video/codecs/codec.h"
 
 namespace Common {
-	class BitStream;
 	class Huffman;
 }
 
@@ -104,7 +104,7 @@ private:
 
 	/** Context for decoding a frame. */
 	struct DecodeContext {
-		Common::BitStream &bits;
+		Common::BitReader32LEMSB &bits;
 
 		int32 qScale;
 		int32 dcStepSize;
@@ -133,7 +133,7 @@ private:
 		BlockContext block[6];
 
 
-		DecodeContext(Common::BitStream &b);
+		DecodeContext(Common::BitReader32LEMSB &b);
 
 		/** Set the quantizer scale and calculate the DC step size and default predictor. */
 		void setQScale(int32 qS);
@@ -227,7 +227,7 @@ private:
 	void decodeIBlock(DecodeContext &ctx, BlockContext &block);
 
 	/** Decode a "tri-state". */
-	static uint8 getTrit(Common::BitStream &bits);
+	static uint8 getTrit(Common::BitReader32LEMSB &bits);
 
 	// IDCT
 
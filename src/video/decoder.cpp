@@ -25,7 +25,9 @@
 #include <cassert>
 
 #include "src/common/error.h"
+#include "src/common/util.h"
 #include "src/common/memreadstream.h"
+#include "src/common/thread.h"
 #include "src/common/threads.h"
 
 #include "src/graphics/graphics.h"
@@ -38,14 +40,42 @@
 #include "src/sound/audiostream.h"
 #include "src/sound/decoders/pcm.h"
 
+#include "src/events/events.h"
+
 namespace Video {
 
+/** A thread decoding the frames of a video ahead of their time. */
+class VideoDecoder::FrameProducer : public Common::Thread {
+public:
+	FrameProducer(VideoDecoder &decoder) : _decoder(&decoder) {
+	}
+
+	~FrameProducer() {
+		destroyThread();
+	}
+
+private:
+	VideoDecoder *_decoder;
+
+	void threadMethod() {
+		while (!_killThread && _decoder->produceFrame())
+			;
+	}
+};
+
+
 VideoDecoder::VideoDecoder() : Renderable(Graphics::kRenderableTypeVideo),
 	_started(false), _finished(false), _needCopy(false),
 	_width(0), _height(0), _surface(0), _texture(0),
 	_textureWidth(0.0f), _textureHeight(0.0f), _scale(kScaleNone),
-	_sound(0), _soundRate(0), _soundFlags(0) {
-
+	_sound(0), _soundRate(0), _soundFlags(0), _producer(0),
+	_frameQueueStart(0), _frameQueueCount(0), _producerStop(false), _producerDone(false),
+	_producerStart(0), _frameFreed(_frameMutex) {
+
+	for (size_t i = 0; i < kFrameQueueSize; i++) {
+		_frameQueue[i].surface = 0;
+		_frameQueue[i].time    = 0;
+	}
 }
 
 VideoDecoder::~VideoDecoder() {
@@ -62,6 +92,8 @@ VideoDecoder::~VideoDecoder() {
 void VideoDecoder::deinit() {
 	hide();
 
+	stopProducer();
+
 	GLContainer::removeFromQueue(Graphics::kQueueGLContainer);
 }
 
@@ -81,13 +113,15 @@ void VideoDecoder::initVideo(uint32 width, uint32 height) {
 	_surface = new Graphics::Surface(realWidth, realHeight);
 
 	_surface->fill(0, 0, 0, 0);
-
-	rebuild();
 }
 
 void VideoDecoder::initSound(uint16 rate, int channels, bool is16) {
 	deinitSound();
 
+	// Without a sound subsystem, the video plays silently
+	if (!SoundMan.ready())
+		return;
+
 	_soundRate  = rate;
 	_soundFlags = 0;
 
@@ -189,13 +223,17 @@ void VideoDecoder::copyData() {
 	if (_texture == 0)
 		throw Common::Exception("No texture while trying to copy");
 
-	glBindTexture(GL_TEXTURE_2D, _texture);
-	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, _surface->getWidth(), _surface->getHeight(),
-	                GL_BGRA, GL_UNSIGNED_BYTE, _surface->getData());
+	copySurface(*_surface);
 
 	_needCopy = false;
 }
 
+void VideoDecoder::copySurface(const Graphics::Surface &surface) {
+	glBindTexture(GL_TEXTURE_2D, _texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, surface.getWidth(), surface.getHeight(),
+	                GL_BGRA, GL_UNSIGNED_BYTE, surface.getData());
+}
+
 void VideoDecoder::setScale(Scale scale) {
 	_scale = scale;
 }
@@ -205,6 +243,11 @@ bool VideoDecoder::isPlaying() const {
 }
 
 void VideoDecoder::update() {
+	if (_producer) {
+		updateQueued();
+		return;
+	}
+
 	if (getTimeToNextFrame() > 0)
 		return;
 
@@ -212,6 +255,140 @@ void VideoDecoder::update() {
 	copyData();
 }
 
+bool VideoDecoder::canDecodeAhead() const {
+	return false;
+}
+
+bool VideoDecoder::decodeNextFrame(Graphics::Surface &UNUSED(surface), uint32 &UNUSED(time)) {
+	return false;
+}
+
+void VideoDecoder::startProducer() {
+	if (_producer || !_surface)
+		return;
+
+	for (size_t i = 0; i < kFrameQueueSize; i++) {
+		_frameQueue[i].surface = new Graphics::Surface(_surface->getWidth(), _surface->getHeight());
+		_frameQueue[i].time    = 0;
+	}
+
+	_frameQueueStart = 0;
+	_frameQueueCount = 0;
+
+	_producerStop = false;
+	_producerDone = false;
+
+	_producerStart = EventMan.getTimestamp();
+
+	_producer = new FrameProducer(*this);
+
+	if (!_producer->createThread()) {
+		warning("Failed to create the video decoding thread. Decoding on the render thread");
+
+		stopProducer();
+	}
+}
+
+void VideoDecoder::stopProducer() {
+	if (!_producer)
+		return;
+
+	{
+		Common::StackLock lock(_frameMutex);
+
+		_producerStop = true;
+		_frameFreed.signal();
+	}
+
+	// Waits for the thread to finish
+	delete _producer;
+	_producer = 0;
+
+	for (size_t i = 0; i < kFrameQueueSize; i++) {
+		delete _frameQueue[i].surface;
+		_frameQueue[i].surface = 0;
+	}
+
+	_frameQueueCount = 0;
+}
+
+bool VideoDecoder::produceFrame() {
+	QueuedFrame *frame = 0;
+
+	{
+		Common::StackLock lock(_frameMutex);
+
+		while (!_producerStop && (_frameQueueCount >= kFrameQueueSize))
+			_frameFreed.wait();
+
+		if (_producerStop)
+			return false;
+
+		// Only the decoding thread adds frames, so nobody else touches this one until we queued it
+		frame = &_frameQueue[(_frameQueueStart + _frameQueueCount) % kFrameQueueSize];
+	}
+
+	bool decoded = false;
+	try {
+		decoded = decodeNextFrame(*frame->surface, frame->time);
+	} catch (Common::Exception &e) {
+		Common::printException(e, "WARNING: ");
+	}
+
+	Common::StackLock lock(_frameMutex);
+
+	if (!decoded) {
+		_producerDone = true;
+		return false;
+	}
+
+	_frameQueueCount++;
+	return true;
+}
+
+void VideoDecoder::popFrame() {
+	_frameQueueStart = (_frameQueueStart + 1) % kFrameQueueSize;
+	_frameQueueCount--;
+
+	_frameFreed.signal();
+}
+
+void VideoDecoder::updateQueued() {
+	const uint32 curTime = EventMan.getTimestamp() - _producerStart;
+
+	const QueuedFrame *frame = 0;
+	bool done = false;
+
+	{
+		Common::StackLock lock(_frameMutex);
+
+		// Drop frames we're already too late for
+		while ((_frameQueueCount > 1) &&
+		       (_frameQueue[(_frameQueueStart + 1) % kFrameQueueSize].time <= curTime))
+			popFrame();
+
+		if (_frameQueueCount > 0) {
+			if (_frameQueue[_frameQueueStart].time <= curTime)
+				frame = &_frameQueue[_frameQueueStart];
+		} else
+			done = _producerDone;
+	}
+
+	if (done) {
+		finish();
+		return;
+	}
+
+	if (!frame)
+		return;
+
+	// The frame stays in the queue while we copy it, so the decoding thread won't overwrite it
+	copySurface(*frame->surface);
+
+	Common::StackLock lock(_frameMutex);
+	popFrame();
+}
+
 void VideoDecoder::getQuadDimensions(float &width, float &height) const {
 	width  = _width;
 	height = _height;
@@ -286,13 +463,42 @@ void VideoDecoder::finish() {
 void VideoDecoder::start() {
 	startVideo();
 
+	// We only need a texture once we actually show the video
+	if (_texture == 0)
+		rebuild();
+
+	if (canDecodeAhead())
+		startProducer();
+
 	show();
 }
 
 void VideoDecoder::abort() {
 	hide();
 
+	stopProducer();
+
 	finish();
 }
 
+uint32 VideoDecoder::decodeAll() {
+	// Nobody is going to listen to the sound
+	deinitSound();
+
+	uint32 frames = 0;
+
+	while (!_finished) {
+		_needCopy = false;
+
+		processData();
+
+		if (_needCopy)
+			frames++;
+	}
+
+	_needCopy = false;
+
+	return frames;
+}
+
 } // End of namespace Video
@@ -26,6 +26,7 @@
 #define VIDEO_DECODER_H
 
 #include "src/common/types.h"
+#include "src/common/mutex.h"
 
 #include "src/graphics/types.h"
 #include "src/graphics/glcontainer.h"
@@ -68,6 +69,16 @@ public:
 	/** Abort the playing of the video. */
 	void abort();
 
+	/** Decode all remaining frames as fast as possible, without showing them.
+	 *
+	 *  This needs neither a GL context nor working sound output, and ignores
+	 *  the frames' timing. It's meant for measuring the decoding speed, and
+	 *  can't be combined with start().
+	 *
+	 *  @return The number of frames decoded.
+	 */
+	uint32 decodeAll();
+
 	/** Return the time, in milliseconds, to the next frame. */
 	virtual uint32 getTimeToNextFrame() const = 0;
 
@@ -112,6 +123,26 @@ protected:
 	/** Process the video's image and sound data further. */
 	virtual void processData() = 0;
 
+	/** Can this decoder decode frames ahead, on a separate thread?
+	 *
+	 *  If so, processData() is not used while the video is playing. Instead,
+	 *  decodeNextFrame() is called from a decoding thread, and the render
+	 *  thread only uploads the finished frames.
+	 *
+	 *  Such a decoder has to call deinit() at the start of its destructor.
+	 */
+	virtual bool canDecodeAhead() const;
+
+	/** Decode the next frame into this surface.
+	 *
+	 *  Only called if canDecodeAhead() returns true, on the decoding thread.
+	 *
+	 *  @param  surface The surface to write the frame to. It has the same dimensions as _surface.
+	 *  @param  time    The time, in milliseconds after the start, the frame should be shown.
+	 *  @return false if there are no more frames.
+	 */
+	virtual bool decodeNextFrame(Graphics::Surface &surface, uint32 &time);
+
 	void finish();
 
 	void deinit();
@@ -121,6 +152,17 @@ protected:
 	void doDestroy();
 
 private:
+	/** Number of frames to decode ahead. */
+	static const size_t kFrameQueueSize = 3;
+
+	class FrameProducer;
+
+	/** A frame decoded ahead, waiting to be shown. */
+	struct QueuedFrame {
+		Graphics::Surface *surface; ///< The frame's image.
+		uint32 time;                ///< When to show the frame, in milliseconds after the start.
+	};
+
 	Graphics::TextureID _texture;
 
 	float _textureWidth;
@@ -133,12 +175,43 @@ private:
 	uint16                     _soundRate;
 	byte                       _soundFlags;
 
+	FrameProducer *_producer; ///< The thread decoding frames ahead.
+
+	QueuedFrame _frameQueue[kFrameQueueSize]; ///< Ring of frames decoded ahead.
+	size_t      _frameQueueStart;             ///< Index of the next frame to show.
+	size_t      _frameQueueCount;             ///< Number of frames waiting to be shown.
+
+	bool   _producerStop;  ///< Should the decoding thread stop?
+	bool   _producerDone;  ///< Has the decoding thread decoded the last frame?
+	uint32 _producerStart; ///< Timestamp of when the decoding thread was started.
+
+	Common::Mutex     _frameMutex; ///< Guards the frame queue and the decoding thread's state.
+	Common::Condition _frameFreed; ///< Signals that a frame was taken out of the queue.
+
 
 	/** Update the video, if necessary. */
 	void update();
 
 	/** Copy the video image data to the texture. */
 	void copyData();
+	/** Copy the image data of a surface with the video's dimensions to the texture. */
+	void copySurface(const Graphics::Surface &surface);
+
+	/** Start a thread decoding frames ahead. */
+	void startProducer();
+	/** Stop the decoding thread and throw away the frames it decoded. */
+	void stopProducer();
+
+	/** Decode the next frame into the queue, waiting for room if necessary.
+	 *
+	 *  Called from the decoding thread. Returns false once it should stop.
+	 */
+	bool produceFrame();
+
+	/** Show the decoded frame that's due now, if any. */
+	void updateQueued();
+	/** Remove the oldest frame from the queue. The queue has to be locked. */
+	void popFrame();
 
 	/** Get the dimensions of the quad to draw the texture on. */
 	void getQuadDimensions(float &width, float &height) const;
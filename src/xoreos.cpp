@@ -237,9 +237,15 @@ void initConfig() {
 	ConfigMan.setDouble(Common::kConfigRealmDefault, "volume_voice", 1.0);
 	ConfigMan.setDouble(Common::kConfigRealmDefault, "volume_video", 1.0);
 
+	ConfigMan.setBool  (Common::kConfigRealmDefault, "soundloopback", false);
+
 	ConfigMan.setBool(Common::kConfigRealmDefault, "showfps", false);
 
-	ConfigMan.setBool(Common::kConfigRealmDefault, "skipvideos", false);
+	ConfigMan.setBool(Common::kConfigRealmDefault, "skipvideos"     , false);
+	ConfigMan.setBool(Common::kConfigRealmDefault, "benchmarkvideos", false);
+
+	ConfigMan.setInt (Common::kConfigRealmDefault, "indexthreads", 0);
+	ConfigMan.setBool(Common::kConfigRealmDefault, "indexcache"  , false);
 
 	ConfigMan.setBool(Common::kConfigRealmDefault, "saveconf", true);
 